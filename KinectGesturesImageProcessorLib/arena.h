@@ -0,0 +1,51 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stdlib.h>
+
+typedef unsigned char byte;
+
+//Bump allocator over one aligned block. The owner carves its buffers twice with the same code:
+//first with base == NULL to measure the size, then again after arenaAllocate to get the real pointers.
+
+#define ARENA_ALIGNMENT 64		//cache line, also enough for any SIMD load
+
+typedef struct Arena
+{
+	byte* base;
+	size_t used;
+} Arena;
+
+inline void* arenaTake(Arena* arena, size_t bytes)
+{
+	void* ptr = arena->base == NULL ? NULL : arena->base + arena->used;
+	arena->used += (bytes + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+	return ptr;
+}
+
+#define arenaNew(arena, type, count) ((type*)arenaTake((arena), (size_t)(count) * sizeof(type)))
+
+//allocate the measured size and rewind, returns NULL when out of memory
+inline byte* arenaAllocate(Arena* arena)
+{
+	size_t size = arena->used > 0 ? arena->used : ARENA_ALIGNMENT;
+#ifdef _MSC_VER
+	arena->base = (byte*)_aligned_malloc(size, ARENA_ALIGNMENT);
+#else
+	void* ptr = NULL;
+	arena->base = posix_memalign(&ptr, ARENA_ALIGNMENT, size) == 0 ? (byte*)ptr : NULL;
+#endif
+	arena->used = 0;
+	return arena->base;
+}
+
+inline void arenaFree(byte* base)
+{
+#ifdef _MSC_VER
+	_aligned_free(base);
+#else
+	free(base);
+#endif
+}
+
+#endif
@@ -0,0 +1,273 @@
+#include "backgroundModel.h"
+#include "arena.h"
+#include <memory.h>
+#include <math.h>
+
+#define MAX_VALID_DEPTH ((1 << (16 - BACKGROUND_SHIFT)) - 1)		//anything deeper doesn't fit Q14.2
+
+//van der Corput sequence, a well spread dither in [0, 2^15) for consecutive frames
+static int nextDither(BackgroundModel* model)
+{
+	unsigned int index = ++model->ditherIndex;
+	int dither = 0;
+	for (int bit = 0; bit < BACKGROUND_WEIGHT_BITS; bit++)
+	{
+		dither = (dither << 1) | ((index >> bit) & 1);
+	}
+	return dither;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//update kernels. The scalar version is the reference, the SSE2 version gives identical results.
+
+static inline int computeNoise(int deviation, int noiseFactor, int minNoise)
+{
+	int noise = (deviation * noiseFactor + 128) >> 8;
+	noise = noise > minNoise ? noise : minNoise;
+	return noise < 255 ? noise : 255;
+}
+
+static void updateRowScalar(BackgroundModel* model, const ushort* src, ushort* mean, byte* deviation, byte* noise, int count,
+							int weight, int dither, bool adapt)
+{
+	for (int j = 0; j < count; j++)
+	{
+		int depth = src[j];
+		if (depth == 0 || depth > MAX_VALID_DEPTH)
+		{
+			continue;
+		}
+
+		int depth4 = depth << BACKGROUND_SHIFT;
+		if (mean[j] == 0)	//never seen before
+		{
+			mean[j] = (ushort)depth4;
+			deviation[j] = 0;
+		}
+		else
+		{
+			int above = depth4 > mean[j] ? depth4 - mean[j] : 0;
+			int below = mean[j] > depth4 ? mean[j] - depth4 : 0;
+			int absDelta = above + below;
+			if (adapt && absDelta > noise[j])
+			{
+				continue;	//foreground
+			}
+
+			int delta = (above < 32767 ? above : 32767) - (below < 32767 ? below : 32767);
+			mean[j] = (ushort)(mean[j] + ((delta * weight + dither) >> BACKGROUND_WEIGHT_BITS));
+
+			int absDelta8 = absDelta < 255 ? absDelta : 255;
+			deviation[j] = (byte)(deviation[j] + (((absDelta8 - deviation[j]) * weight + dither) >> BACKGROUND_WEIGHT_BITS));
+		}
+
+		if (adapt)
+		{
+			noise[j] = (byte)computeNoise(deviation[j], model->noiseFactor, model->minNoise);
+		}
+	}
+}
+
+#ifdef SIMD_X86
+//(a * weight + dither) >> 15 on 8 signed 16 bit lanes, the pairs (a, 1) x (weight, dither) through madd
+SIMD_TARGET_SSE2 static inline __m128i weightedStep(__m128i a, __m128i weightDither)
+{
+	const __m128i one = _mm_set1_epi16(1);
+	__m128i lo = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a, one), weightDither), BACKGROUND_WEIGHT_BITS);
+	__m128i hi = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a, one), weightDither), BACKGROUND_WEIGHT_BITS);
+	return _mm_packs_epi32(lo, hi);
+}
+
+SIMD_TARGET_SSE2 static inline __m128i selectLanes(__m128i mask, __m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+SIMD_TARGET_SSE2 static void updateRowSSE2(BackgroundModel* model, const ushort* src, ushort* mean, byte* deviation, byte* noise, int count,
+										   int weight, int dither, bool adapt)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i weightDither = _mm_set1_epi32((dither << 16) | weight);
+	const __m128i factorRound = _mm_set1_epi32((128 << 16) | model->noiseFactor);
+	const __m128i minNoise = _mm_set1_epi16((short)model->minNoise);
+	const __m128i max16 = _mm_set1_epi16(32767);
+	const __m128i max8 = _mm_set1_epi16(255);
+
+	int j = 0;
+	for (; j + 8 <= count; j += 8)
+	{
+		__m128i depth = _mm_loadu_si128((const __m128i*)(src + j));
+		__m128i meanV = _mm_loadu_si128((const __m128i*)(mean + j));
+		__m128i devV = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(deviation + j)), zero);
+		__m128i noiseV = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(noise + j)), zero);
+
+		__m128i valid = _mm_andnot_si128(_mm_cmpeq_epi16(depth, zero), _mm_cmpeq_epi16(_mm_srli_epi16(depth, 16 - BACKGROUND_SHIFT), zero));
+		__m128i fresh = _mm_and_si128(valid, _mm_cmpeq_epi16(meanV, zero));
+		__m128i depth4 = _mm_slli_epi16(depth, BACKGROUND_SHIFT);
+
+		__m128i above = _mm_subs_epu16(depth4, meanV);
+		__m128i below = _mm_subs_epu16(meanV, depth4);
+		__m128i absDelta = _mm_or_si128(above, below);		//one of them is 0
+
+		__m128i update = _mm_andnot_si128(fresh, valid);
+		if (adapt)
+		{
+			update = _mm_and_si128(update, _mm_cmpeq_epi16(_mm_subs_epu16(absDelta, noiseV), zero));
+		}
+
+		//min(x, 32767) as x - max(x - 32767, 0), SSE2 has no unsigned 16 bit min
+		__m128i delta = _mm_sub_epi16(_mm_sub_epi16(above, _mm_subs_epu16(above, max16)), _mm_sub_epi16(below, _mm_subs_epu16(below, max16)));
+		__m128i newMean = _mm_add_epi16(meanV, weightedStep(delta, weightDither));
+
+		__m128i absDelta8 = _mm_sub_epi16(absDelta, _mm_subs_epu16(absDelta, max8));
+		__m128i newDev = _mm_add_epi16(devV, weightedStep(_mm_sub_epi16(absDelta8, devV), weightDither));
+
+		meanV = selectLanes(fresh, depth4, selectLanes(update, newMean, meanV));
+		devV = selectLanes(fresh, zero, selectLanes(update, newDev, devV));
+		_mm_storeu_si128((__m128i*)(mean + j), meanV);
+		_mm_storel_epi64((__m128i*)(deviation + j), _mm_packus_epi16(devV, zero));
+
+		if (adapt)
+		{
+			__m128i lo = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(devV, _mm_set1_epi16(1)), factorRound), 8);
+			__m128i hi = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(devV, _mm_set1_epi16(1)), factorRound), 8);
+			__m128i newNoise = _mm_max_epi16(_mm_packs_epi32(lo, hi), minNoise);
+			noiseV = selectLanes(_mm_or_si128(fresh, update), newNoise, noiseV);
+			_mm_storel_epi64((__m128i*)(noise + j), _mm_packus_epi16(noiseV, zero));
+		}
+	}
+
+	updateRowScalar(model, src + j, mean + j, deviation + j, noise + j, count - j, weight, dither, adapt);
+}
+#endif
+
+static void updateModel(BackgroundModel* model, const ushort* srcDepthPtr, int weight, bool adapt)
+{
+	int dither = nextDither(model);
+	for (int i = 0; i < model->height; i++)
+	{
+		int offset = i * model->depthStride;
+#ifdef SIMD_X86
+		if (model->simdLevel >= SimdSSE2)
+		{
+			updateRowSSE2(model, srcDepthPtr + offset, model->mean + offset, model->deviation + offset, model->noise + offset, model->width, weight, dither, adapt);
+			continue;
+		}
+#endif
+		updateRowScalar(model, srcDepthPtr + offset, model->mean + offset, model->deviation + offset, model->noise + offset, model->width, weight, dither, adapt);
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//exports
+
+static void carveModel(BackgroundModel* model, Arena* arena)
+{
+	int size = model->depthStride * model->height;
+	model->mean = arenaNew(arena, ushort, size);
+	model->deviation = arenaNew(arena, byte, size);
+	model->noise = arenaNew(arena, byte, size);
+}
+
+DLL_EXPORT void* backgroundModelCreate(int width, int height, int depthStride)
+{
+	BackgroundModel* model = new BackgroundModel();
+	model->width = width;
+	model->height = height;
+	model->depthStride = depthStride;
+	model->simdLevel = simdDetect();
+	model->ditherIndex = 0;
+	model->noiseFactor = 3 << 8;
+	model->minNoise = 0;
+
+	Arena arena = { NULL, 0 };
+	carveModel(model, &arena);	//measure
+	model->arena = arenaAllocate(&arena);
+	if (model->arena == NULL)
+	{
+		delete model;
+		return NULL;
+	}
+	carveModel(model, &arena);
+
+	backgroundModelReset(model);
+	return model;
+}
+
+proc_m backgroundModelDestroy(void* model)
+{
+	BackgroundModel* background = (BackgroundModel*)model;
+	if (background == NULL)
+	{
+		return 0;
+	}
+
+	arenaFree(background->arena);
+	delete background;
+	return 0;
+}
+
+proc_m backgroundModelReset(void* model)
+{
+	BackgroundModel* background = (BackgroundModel*)model;
+	int size = background->depthStride * background->height;
+
+	background->frameNum = 0;
+	memset(background->mean, 0, size * sizeof(ushort));
+	memset(background->deviation, 0, size * sizeof(byte));
+	memset(background->noise, 0, size * sizeof(byte));
+	return 0;
+}
+
+proc_m backgroundModelCalibrate(void* model, ushort* srcDepthPtr)
+{
+	BackgroundModel* background = (BackgroundModel*)model;
+
+	//1 / n in Q15, one divide per frame. The first frame only initializes, so the weight never exceeds 1/2.
+	int n = ++background->frameNum;
+	int weight = n > 1 ? ((1 << BACKGROUND_WEIGHT_BITS) + n / 2) / n : 1 << (BACKGROUND_WEIGHT_BITS - 1);
+
+	updateModel(background, srcDepthPtr, weight, false);
+	return 0;
+}
+
+proc_m backgroundModelAdapt(void* model, ushort* srcDepthPtr, int rateShift)
+{
+	if (rateShift < 1 || rateShift > BACKGROUND_WEIGHT_BITS)
+	{
+		return -1;
+	}
+
+	updateModel((BackgroundModel*)model, srcDepthPtr, 1 << (BACKGROUND_WEIGHT_BITS - rateShift), true);
+	return 0;
+}
+
+proc_m backgroundModelSetNoise(void* model, double noiseFactor, double minNoise)
+{
+	BackgroundModel* background = (BackgroundModel*)model;
+
+	//the factor goes through 16 bit lanes, 127 is more than anyone needs
+	noiseFactor = noiseFactor < 0 ? 0 : (noiseFactor > 127 ? 127 : noiseFactor);
+	minNoise = minNoise < 0 ? 0 : (minNoise > 63.75 ? 63.75 : minNoise);
+	background->noiseFactor = (int)(noiseFactor * 256 + 0.5);
+	background->minNoise = (int)ceil(minNoise * (1 << BACKGROUND_SHIFT));	//the same rounding as a constant threshold in touchPipelineWork
+
+	for (int i = 0; i < background->height; i++)
+	{
+		int offset = i * background->depthStride;
+		for (int j = 0; j < background->width; j++)
+		{
+			background->noise[offset + j] = (byte)computeNoise(background->deviation[offset + j], background->noiseFactor, background->minNoise);
+		}
+	}
+	return 0;
+}
+
+proc_m backgroundModelGetMaps(void* model, ushort** meanPtr, byte** deviationPtr, byte** noisePtr)
+{
+	BackgroundModel* background = (BackgroundModel*)model;
+	if (meanPtr != NULL) *meanPtr = background->mean;
+	if (deviationPtr != NULL) *deviationPtr = background->deviation;
+	if (noisePtr != NULL) *noisePtr = background->noise;
+	return 0;
+}
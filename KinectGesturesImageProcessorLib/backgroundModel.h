@@ -0,0 +1,55 @@
+#ifndef _BACKGROUND_MODEL_H_
+#define _BACKGROUND_MODEL_H_
+
+#include "depth.h"
+#include "simd.h"
+
+//Per-pixel fixed point model of the table: running mean depth and mean absolute deviation.
+//	mean		ushort, depth * 4 (Q14.2), the calibration map format of touchPipelineWork
+//	deviation	byte, mean |depth - mean| * 4 (Q6.2), saturates at 63.75 mm
+//	noise		byte, noise threshold * 4 (Q6.2) derived from the deviation, the noise map of touchPipelineWork
+//4 bytes per pixel, the old double map alone was 8. All maps are depthStride elements per row.
+//
+//Every update is mean += (sample - mean) * weight with a Q15 weight fixed for the whole frame, so there is no divide
+//per pixel. The product is rounded down after adding a per-frame dither in [0, 1), which keeps the mean unbiased even
+//when the step is below the Q14.2 resolution. Depth 0 (no reading) never updates a pixel.
+
+#define BACKGROUND_SHIFT 2				//Q14.2 / Q6.2
+#define BACKGROUND_WEIGHT_BITS 15
+
+typedef struct BackgroundModel
+{
+	int width, height, depthStride;
+	SimdLevel simdLevel;
+
+	int frameNum;						//frames calibrated since the last reset
+	unsigned int ditherIndex;
+
+	int noiseFactor;					//Q8, noise = max(minNoise, deviation * noiseFactor)
+	int minNoise;						//Q6.2
+
+	ushort* mean;
+	byte* deviation;
+	byte* noise;
+	byte* arena;
+} BackgroundModel;
+
+DLL_EXPORT void* backgroundModelCreate(int width, int height, int depthStride);
+proc_m backgroundModelDestroy(void* model);
+
+//forget everything and start a new calibration
+proc_m backgroundModelReset(void* model);
+
+//add one calibration frame: the n-th frame since the reset gets weight 1 / n, so the mean is the plain average
+proc_m backgroundModelCalibrate(void* model, ushort* srcDepthPtr);
+
+//slow adaptation after calibration: weight 2^-rateShift, only for pixels within their noise threshold of the mean,
+//so hands and fingers are never learned into the table. Refreshes the noise threshold of the adapted pixels.
+proc_m backgroundModelAdapt(void* model, ushort* srcDepthPtr, int rateShift);
+
+//noise threshold (mm) = max(minNoise, deviation * noiseFactor) for every pixel, the parameters are kept for backgroundModelAdapt
+proc_m backgroundModelSetNoise(void* model, double noiseFactor, double minNoise);
+
+proc_m backgroundModelGetMaps(void* model, ushort** meanPtr, byte** deviationPtr, byte** noisePtr);
+
+#endif
@@ -0,0 +1,176 @@
+#include "batchDetector.h"
+#include "derivativeFingerDetector.h"
+#include "detectorContext.h"
+#include "threadPool.h"
+#include "threading.h"
+#include "stageStats.h"
+#include "arena.h"
+#include <string.h>
+
+//what one thread of the pool works with, a cache line apart so the threads don't share any
+typedef struct BatchSlot
+{
+	void* detector;
+	long long busyNanos;
+	byte padding[ARENA_ALIGNMENT - sizeof(void*) - sizeof(long long)];
+} BatchSlot;
+
+typedef struct BatchDetector
+{
+	ThreadPool* threadPool;
+	int threadNum;
+	BatchSlot* slots;			//threadNum, in slotArena
+	byte* slotArena;
+
+	//the run in progress
+	ushort** frames;
+	const BatchParams* params;
+	int paramNum, jobNum, maxFingers;
+	BatchResults results;
+	volatile long nextJob;
+
+	BatchStats stats;
+} BatchDetector;
+
+//task t of the pool runs on detector t. Every task takes jobs until there are none left, the tasks of the threads
+//that are done first simply take more of them.
+static void batchTask(void* arg, int taskIndex)
+{
+	BatchDetector* batch = (BatchDetector*)arg;
+	BatchSlot* slot = &batch->slots[taskIndex];
+	const BatchResults* results = &batch->results;
+	int handHint[4];
+
+	for (;;)
+	{
+		long job = atomicIncrement(&batch->nextJob) - 1;
+		if (job >= batch->jobNum)
+		{
+			break;
+		}
+
+		const BatchParams* p = &batch->params[job % batch->paramNum];
+		ushort* frame = batch->frames[job / batch->paramNum];
+		memset(handHint, 0, sizeof(handHint));		//left as it is by frames without fingers
+		long long start = stageClock();
+		int fingerNum = derivativeFingerDetectorContextWorkEx(slot->detector, frame, NULL, p->fingerWidthMin, p->fingerWidthMax, p->fingerLengthMin, p->fingerLengthMax,
+															  batch->maxFingers, results->fingers + (long long)job * 2 * batch->maxFingers, handHint, OutputNone);
+		long long nanos = stageClock() - start;
+		slot->busyNanos += nanos;
+
+		results->fingerNum[job] = fingerNum;
+		if (results->handHint != NULL)
+		{
+			memcpy(results->handHint + 4 * (long long)job, handHint, sizeof(handHint));
+		}
+		if (results->frameNanos != NULL)
+		{
+			results->frameNanos[job] = (int)nanos;
+		}
+	}
+}
+
+DLL_EXPORT void* batchDetectorCreate(int width, int height, int depthStride, int deviceMaxDepth, double realWorldXToZ, double realWorldYToZ, int threadNum)
+{
+	BatchDetector* batch = new BatchDetector();
+	memset(batch, 0, sizeof(BatchDetector));
+	batch->threadPool = threadPoolCreate(threadNum > 0 ? threadNum : cpuCount());
+	batch->threadNum = threadPoolSize(batch->threadPool);
+
+	Arena arena = { NULL, 0 };
+	arenaNew(&arena, BatchSlot, batch->threadNum);	//measure
+	batch->slotArena = arenaAllocate(&arena);
+	if (batch->slotArena == NULL)
+	{
+		batchDetectorDestroy(batch);
+		return NULL;
+	}
+	batch->slots = arenaNew(&arena, BatchSlot, batch->threadNum);
+	memset(batch->slots, 0, batch->threadNum * sizeof(BatchSlot));
+
+	//the detectors get no threads of their own, the parallelism is across frames
+	for (int t = 0; t < batch->threadNum; t++)
+	{
+		batch->slots[t].detector = derivativeFingerDetectorCreate(width, height, depthStride, width * 3, deviceMaxDepth, realWorldXToZ, realWorldYToZ, 1);
+		if (batch->slots[t].detector == NULL)
+		{
+			batchDetectorDestroy(batch);
+			return NULL;
+		}
+	}
+	batch->stats.threadNum = batch->threadNum;
+
+	return batch;
+}
+
+proc_m batchDetectorDestroy(void* batch)
+{
+	BatchDetector* b = (BatchDetector*)batch;
+	if (b == NULL)
+	{
+		return 0;
+	}
+
+	for (int t = 0; b->slots != NULL && t < b->threadNum; t++)
+	{
+		derivativeFingerDetectorDestroy(b->slots[t].detector);
+	}
+	arenaFree(b->slotArena);
+	threadPoolDestroy(b->threadPool);
+	delete b;
+	return 0;
+}
+
+proc_m batchDetectorSetCamera(void* batch, void* camera)
+{
+	BatchDetector* b = (BatchDetector*)batch;
+	for (int t = 0; t < b->threadNum; t++)
+	{
+		if (derivativeFingerDetectorSetCamera(b->slots[t].detector, camera) != 0)
+		{
+			return -1;
+		}
+	}
+	return 0;
+}
+
+proc_m batchDetectorRun(void* batch, ushort** frames, int frameNum, const BatchParams* params, int paramNum, int maxFingers, BatchResults* results)
+{
+	BatchDetector* b = (BatchDetector*)batch;
+	if (frames == NULL || frameNum < 0 || params == NULL || paramNum <= 0 || maxFingers <= 0 || results == NULL ||
+		results->fingerNum == NULL || results->fingers == NULL || (long long)frameNum * paramNum > 0x7fffffff)
+	{
+		return -1;
+	}
+
+	b->frames = frames;
+	b->params = params;
+	b->paramNum = paramNum;
+	b->jobNum = frameNum * paramNum;
+	b->maxFingers = maxFingers;
+	b->results = *results;
+	b->nextJob = 0;
+	for (int t = 0; t < b->threadNum; t++)
+	{
+		b->slots[t].busyNanos = 0;
+	}
+
+	long long start = stageClock();
+	threadPoolRun(b->threadPool, batchTask, b, b->threadNum);
+
+	b->stats.jobs = b->jobNum;
+	b->stats.wallNanos = stageClock() - start;
+	b->stats.busyNanos = 0;
+	for (int t = 0; t < b->threadNum; t++)
+	{
+		b->stats.busyNanos += b->slots[t].busyNanos;
+	}
+	return b->jobNum;
+}
+
+proc_m batchDetectorGetStats(void* batch, BatchStats* statsPtr)
+{
+	BatchDetector* b = (BatchDetector*)batch;
+	*statsPtr = b->stats;
+	return 0;
+}
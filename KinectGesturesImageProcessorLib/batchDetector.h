@@ -0,0 +1,49 @@
+#ifndef _BATCH_DETECTOR_H_
+#define _BATCH_DETECTOR_H_
+
+#include "depth.h"
+
+//Offline reprocessing: many recorded frames through the derivative finger detector with many parameter sets, for
+//tuning. Every thread has a detector context of its own and the frames are independent, so the work is spread over
+//the threads job by job: a thread that is done with a job takes the next one nobody has started, whatever it is, and
+//no thread waits while there is work left. A job is one frame with one parameter set, job k = frame * paramNum + param.
+//
+//The detectors scan every frame whole: tracking would make a result depend on which thread had the previous frame.
+//The results are the same for any number of threads.
+
+typedef struct BatchParams
+{
+	double fingerWidthMin, fingerWidthMax;
+	double fingerLengthMin, fingerLengthMax;
+} BatchParams;
+
+//structure of arrays, allocated by the caller for frameNum * paramNum jobs
+typedef struct BatchResults
+{
+	int* fingerNum;				//per job
+	int* fingers;				//2 * maxFingers ints per job, (x, y) pairs, fingerNum of them used
+	int* handHint;				//4 ints per job, NULL when not needed
+	int* frameNanos;			//detection time per job, NULL when not needed
+} BatchResults;
+
+typedef struct BatchStats
+{
+	long long jobs;				//of the last run
+	long long wallNanos;		//of the last run
+	long long busyNanos;		//of the last run, summed over the threads
+	int threadNum;
+	int reserved;
+} BatchStats;
+
+//frames of the given size, see derivativeFingerDetectorCreate. threadNum 0 takes one per cpu. Returns NULL when out of memory.
+DLL_EXPORT void* batchDetectorCreate(int width, int height, int depthStride, int deviceMaxDepth, double realWorldXToZ, double realWorldYToZ, int threadNum);
+proc_m batchDetectorDestroy(void* batch);
+//the camera model (cameraModel.h) for all detectors, the model may be destroyed afterwards
+proc_m batchDetectorSetCamera(void* batch, void* camera);
+
+//frames: frameNum pointers to depth frames, depthStride ushorts per row. Returns when all jobs are done, with the
+//number of jobs, or -1 on bad arguments.
+proc_m batchDetectorRun(void* batch, ushort** frames, int frameNum, const BatchParams* params, int paramNum, int maxFingers, BatchResults* results);
+proc_m batchDetectorGetStats(void* batch, BatchStats* statsPtr);
+
+#endif
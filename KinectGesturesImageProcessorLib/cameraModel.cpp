@@ -0,0 +1,244 @@
+#include "cameraModel.h"
+#include <math.h>
+#include <string.h>
+
+void carveCameraModel(CameraModel* camera, Arena* arena)
+{
+	camera->xScale = arenaNew(arena, double, camera->width);
+	camera->yScale = arenaNew(arena, double, camera->height);
+}
+
+void cameraModelSetIntrinsics(CameraModel* camera, double fx, double fy, double cx, double cy)
+{
+	camera->fx = fx;
+	camera->fy = fy;
+	camera->cx = cx;
+	camera->cy = cy;
+	for (int x = 0; x < camera->width; x++)
+	{
+		camera->xScale[x] = (x - cx) / fx;
+	}
+	for (int y = 0; y < camera->height; y++)
+	{
+		camera->yScale[y] = (cy - y) / fy;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//batch kernels
+
+static void projectiveToRealWorldScalar(const CameraModel* camera, const int* pointPtr, int pointNum, double* resultPtr)
+{
+	for (int k = 0; k < pointNum; k++, pointPtr += 3, resultPtr += 3)
+	{
+		resultPtr[0] = cameraRealX(camera, pointPtr[0], pointPtr[2]);
+		resultPtr[1] = cameraRealY(camera, pointPtr[1], pointPtr[2]);
+		resultPtr[2] = pointPtr[2];
+	}
+}
+
+static void distSquaredScalar(const CameraModel* camera, const int* firstPtr, const int* secondPtr, int pointNum, double* resultPtr)
+{
+	for (int k = 0; k < pointNum; k++, firstPtr += 3, secondPtr += 3)
+	{
+		resultPtr[k] = cameraDistSquared(camera, firstPtr[0], firstPtr[1], firstPtr[2], secondPtr[0], secondPtr[1], secondPtr[2]);
+	}
+}
+
+#ifdef SIMD_X86
+//x and y of a point in the two lanes
+SIMD_TARGET_SSE2 static void projectiveToRealWorldSSE2(const CameraModel* camera, const int* pointPtr, int pointNum, double* resultPtr)
+{
+	const double* xs = camera->xScale;
+	const double* ys = camera->yScale;
+	for (int k = 0; k < pointNum; k++, pointPtr += 3, resultPtr += 3)
+	{
+		__m128d depth = _mm_set1_pd((double)pointPtr[2]);
+		_mm_storeu_pd(resultPtr, _mm_mul_pd(_mm_set_pd(ys[pointPtr[1]], xs[pointPtr[0]]), depth));
+		resultPtr[2] = pointPtr[2];
+	}
+}
+
+//two pairs per step, one in each lane
+SIMD_TARGET_SSE2 static void distSquaredSSE2(const CameraModel* camera, const int* firstPtr, const int* secondPtr, int pointNum, double* resultPtr)
+{
+	const double* xs = camera->xScale;
+	const double* ys = camera->yScale;
+	const int* a = firstPtr;
+	const int* b = secondPtr;
+	int k = 0;
+	for (; k + 2 <= pointNum; k += 2, a += 6, b += 6)
+	{
+		__m128d za = _mm_set_pd(a[5], a[2]);
+		__m128d zb = _mm_set_pd(b[5], b[2]);
+		__m128d dx = _mm_sub_pd(_mm_mul_pd(_mm_set_pd(xs[a[3]], xs[a[0]]), za), _mm_mul_pd(_mm_set_pd(xs[b[3]], xs[b[0]]), zb));
+		__m128d dy = _mm_sub_pd(_mm_mul_pd(_mm_set_pd(ys[a[4]], ys[a[1]]), za), _mm_mul_pd(_mm_set_pd(ys[b[4]], ys[b[1]]), zb));
+		__m128d dz = _mm_sub_pd(za, zb);
+		_mm_storeu_pd(resultPtr + k, _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz)));
+	}
+
+	distSquaredScalar(camera, a, b, pointNum - k, resultPtr + k);
+}
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+//exports
+
+static CameraModel* createModel(int width, int height)
+{
+	if (width <= 0 || height <= 0)
+	{
+		return NULL;
+	}
+
+	CameraModel* camera = new CameraModel;
+	memset(camera, 0, sizeof(CameraModel));
+	camera->width = width;
+	camera->height = height;
+	camera->simdLevel = simdDetect();
+
+	Arena arena = { NULL, 0 };
+	carveCameraModel(camera, &arena);
+	camera->arena = arenaAllocate(&arena);
+	if (camera->arena == NULL)
+	{
+		delete camera;
+		return NULL;
+	}
+	carveCameraModel(camera, &arena);
+	return camera;
+}
+
+DLL_EXPORT void* cameraModelCreate(int width, int height, double fx, double fy, double cx, double cy)
+{
+	if (fx == 0 || fy == 0)
+	{
+		return NULL;
+	}
+
+	CameraModel* camera = createModel(width, height);
+	if (camera != NULL)
+	{
+		cameraModelSetIntrinsics(camera, fx, fy, cx, cy);
+	}
+	return camera;
+}
+
+DLL_EXPORT void* cameraModelCreateFromRealWorldToZ(int width, int height, double realWorldXToZ, double realWorldYToZ)
+{
+	if (realWorldXToZ == 0 || realWorldYToZ == 0)
+	{
+		return NULL;
+	}
+	return cameraModelCreate(width, height, width / realWorldXToZ, height / realWorldYToZ, width * 0.5, height * 0.5);
+}
+
+//real / depth = slope * pixel + offset over the usable samples, false when the pixels don't spread
+static bool fitLine(const double* projectivePtr, const double* realWorldPtr, int pointNum, int axis, double& slope, double& offset)
+{
+	double n = 0, sumP = 0, sumR = 0, sumPP = 0, sumPR = 0;
+	for (int k = 0; k < pointNum; k++)
+	{
+		double depth = projectivePtr[3 * k + 2];
+		if (depth <= 0)
+		{
+			continue;
+		}
+		double p = projectivePtr[3 * k + axis];
+		double r = realWorldPtr[3 * k + axis] / depth;
+		n++;
+		sumP += p;
+		sumR += r;
+		sumPP += p * p;
+		sumPR += p * r;
+	}
+
+	double det = n * sumPP - sumP * sumP;
+	if (n < 2 || fabs(det) < 1e-9)
+	{
+		return false;
+	}
+	slope = (n * sumPR - sumP * sumR) / det;
+	offset = (sumR - slope * sumP) / n;
+	return slope != 0;
+}
+
+DLL_EXPORT void* cameraModelFit(int width, int height, const double* projectivePtr, const double* realWorldPtr, int pointNum)
+{
+	//rx / depth = x / fx - cx / fx, ry / depth = -y / fy + cy / fy
+	double xSlope, xOffset, ySlope, yOffset;
+	if (!fitLine(projectivePtr, realWorldPtr, pointNum, 0, xSlope, xOffset) ||
+		!fitLine(projectivePtr, realWorldPtr, pointNum, 1, ySlope, yOffset))
+	{
+		return NULL;
+	}
+
+	double fx = 1 / xSlope, fy = -1 / ySlope;
+	return cameraModelCreate(width, height, fx, fy, -xOffset * fx, yOffset * fy);
+}
+
+proc_m cameraModelDestroy(void* camera)
+{
+	CameraModel* model = (CameraModel*)camera;
+	if (model == NULL)
+	{
+		return -1;
+	}
+
+	arenaFree(model->arena);
+	delete model;
+	return 0;
+}
+
+proc_m cameraModelGetIntrinsics(void* camera, double* intrinsicsPtr)
+{
+	CameraModel* model = (CameraModel*)camera;
+	if (model == NULL || intrinsicsPtr == NULL)
+	{
+		return -1;
+	}
+
+	intrinsicsPtr[0] = model->fx;
+	intrinsicsPtr[1] = model->fy;
+	intrinsicsPtr[2] = model->cx;
+	intrinsicsPtr[3] = model->cy;
+	return 0;
+}
+
+proc_m cameraModelProjectiveToRealWorld(void* camera, const int* pointPtr, int pointNum, double* resultPtr)
+{
+	CameraModel* model = (CameraModel*)camera;
+	if (model == NULL || pointNum < 0)
+	{
+		return -1;
+	}
+
+#ifdef SIMD_X86
+	if (model->simdLevel >= SimdSSE2)
+	{
+		projectiveToRealWorldSSE2(model, pointPtr, pointNum, resultPtr);
+		return 0;
+	}
+#endif
+	projectiveToRealWorldScalar(model, pointPtr, pointNum, resultPtr);
+	return 0;
+}
+
+proc_m cameraModelDistSquared(void* camera, const int* firstPtr, const int* secondPtr, int pointNum, double* resultPtr)
+{
+	CameraModel* model = (CameraModel*)camera;
+	if (model == NULL || pointNum < 0)
+	{
+		return -1;
+	}
+
+#ifdef SIMD_X86
+	if (model->simdLevel >= SimdSSE2)
+	{
+		distSquaredSSE2(model, firstPtr, secondPtr, pointNum, resultPtr);
+		return 0;
+	}
+#endif
+	distSquaredScalar(model, firstPtr, secondPtr, pointNum, resultPtr);
+	return 0;
+}
@@ -0,0 +1,68 @@
+#ifndef _CAMERA_MODEL_H_
+#define _CAMERA_MODEL_H_
+
+#include "depth.h"
+#include "simd.h"
+#include "arena.h"
+
+//Pinhole model of the depth camera, projective (pixel column, row, depth) to real world (millimetres, x right, y up):
+//	rx = (x - cx) / fx * depth		ry = (cy - y) / fy * depth		rz = depth
+//The per pixel factors are precomputed once, a column and a row table, so a conversion is a lookup and a multiply.
+//The old realWorldXToZ / YToZ pair is the centred special case fx = width / realWorldXToZ, cx = width / 2.
+
+typedef struct CameraModel
+{
+	int width, height;
+	double fx, fy, cx, cy;		//pixels
+	double* xScale;				//width entries, real world x / depth of a column
+	double* yScale;				//height entries, real world y / depth of a row
+	SimdLevel simdLevel;
+	byte* arena;				//the tables, owned by models of cameraModelCreate only
+} CameraModel;
+
+//for owners that carve the tables out of an arena of their own, call with the arena measuring first, see arena.h
+void carveCameraModel(CameraModel* camera, Arena* arena);
+//width and height are set already, fills the tables
+void cameraModelSetIntrinsics(CameraModel* camera, double fx, double fy, double cx, double cy);
+
+inline double cameraRealX(const CameraModel* camera, int x, int depth) { return camera->xScale[x] * depth; }
+inline double cameraRealY(const CameraModel* camera, int y, int depth) { return camera->yScale[y] * depth; }
+
+inline double cameraDistSquared(const CameraModel* camera, int x1, int y1, int depth1, int x2, int y2, int depth2)
+{
+	double dx = camera->xScale[x1] * depth1 - camera->xScale[x2] * depth2;
+	double dy = camera->yScale[y1] * depth1 - camera->yScale[y2] * depth2;
+	double dz = depth1 - depth2;
+	return dx * dx + dy * dy + dz * dz;
+}
+
+//two points of one row at one depth, the strip width: no y or z term
+inline double cameraRowDistSquared(const CameraModel* camera, int x1, int x2, int depth)
+{
+	double dx = (camera->xScale[x1] - camera->xScale[x2]) * depth;
+	return dx * dx;
+}
+
+inline void cameraRealWorldToProjective(const CameraModel* camera, double rx, double ry, int depth, int& px, int& py)
+{
+	px = (int)(rx * camera->fx / depth + camera->cx);
+	py = (int)(camera->cy - ry * camera->fy / depth);
+}
+
+//exports, models of their own for the C# side and the tools
+
+DLL_EXPORT void* cameraModelCreate(int width, int height, double fx, double fy, double cx, double cy);
+DLL_EXPORT void* cameraModelCreateFromRealWorldToZ(int width, int height, double realWorldXToZ, double realWorldYToZ);
+//least squares fit of the intrinsics to pointNum (x, y, depth) projective points and the real world (x, y, z) the driver
+//gives for them. Points with a depth of 0 are left out. Returns NULL with fewer than 2 distinct columns or rows.
+DLL_EXPORT void* cameraModelFit(int width, int height, const double* projectivePtr, const double* realWorldPtr, int pointNum);
+proc_m cameraModelDestroy(void* camera);
+//fx, fy, cx, cy
+proc_m cameraModelGetIntrinsics(void* camera, double* intrinsicsPtr);
+
+//pointNum (x, y, depth) triplets in pointPtr, inside the frame, to (x, y, z) real world triplets in resultPtr
+proc_m cameraModelProjectiveToRealWorld(void* camera, const int* pointPtr, int pointNum, double* resultPtr);
+//squared real world distances between the projective triplets firstPtr[k] and secondPtr[k]
+proc_m cameraModelDistSquared(void* camera, const int* firstPtr, const int* secondPtr, int pointNum, double* resultPtr);
+
+#endif
@@ -0,0 +1,288 @@
+#include "debugCapture.h"
+#include "derivativeFingerDetector.h"
+#include "arena.h"
+#include "threading.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct CaptureSlot
+{
+	DebugSnapshotHeader header;
+	ushort* depth;
+	int *hDerivative, *vDerivative;
+	int* strips;
+	int* fingers;
+	byte* image;
+	char path[DEBUG_CAPTURE_MAX_PATH];
+	bool busy;					//taken, until the writer is done with it
+} CaptureSlot;
+
+typedef struct DebugCapture
+{
+	int width, height;
+	int maxStrips;				//as many as the detector can hold, see DetectorContext::stripCapacity
+	int slotNum;
+	CaptureSlot* slots;
+
+	//slots waiting for the writer, oldest first
+	Mutex mutex;
+	int* queue;
+	int queueHead, queueNum;
+	DebugCaptureStats stats;
+
+	Semaphore wake;				//posted for every queued slot and to stop
+	Thread thread;
+	volatile long stopRequested;
+
+	byte* arena;
+} DebugCapture;
+
+static void carveCapture(DebugCapture* c, Arena* arena)
+{
+	int size = c->width * c->height;
+	c->slots = arenaNew(arena, CaptureSlot, c->slotNum);
+	c->queue = arenaNew(arena, int, c->slotNum);
+	for (int s = 0; s < c->slotNum; s++)
+	{
+		CaptureSlot* slot = arena->base != NULL ? &c->slots[s] : NULL;
+		ushort* depth = arenaNew(arena, ushort, size);
+		int* hDerivative = arenaNew(arena, int, size);
+		int* vDerivative = arenaNew(arena, int, size);
+		int* strips = arenaNew(arena, int, 3 * c->maxStrips);
+		int* fingers = arenaNew(arena, int, 2 * DEBUG_CAPTURE_MAX_FINGERS);
+		byte* image = arenaNew(arena, byte, 3 * size);
+		if (slot != NULL)
+		{
+			slot->depth = depth;
+			slot->hDerivative = hDerivative;
+			slot->vDerivative = vDerivative;
+			slot->strips = strips;
+			slot->fingers = fingers;
+			slot->image = image;
+			slot->busy = false;
+		}
+	}
+}
+
+static bool writeSnapshot(const DebugCapture* c, const CaptureSlot* slot)
+{
+	FILE* file = fopen(slot->path, "wb");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	const DebugSnapshotHeader* header = &slot->header;
+	int size = c->width * c->height;
+	bool ok = fwrite(header, sizeof(DebugSnapshotHeader), 1, file) == 1 &&
+			  fwrite(slot->depth, sizeof(ushort), size, file) == (size_t)size;
+	if (ok && (header->flags & SnapshotDerivative))
+	{
+		ok = fwrite(slot->hDerivative, sizeof(int), size, file) == (size_t)size &&
+			 fwrite(slot->vDerivative, sizeof(int), size, file) == (size_t)size;
+	}
+	ok = ok && fwrite(slot->strips, 3 * sizeof(int), header->stripNum, file) == (size_t)header->stripNum;
+	ok = ok && fwrite(slot->fingers, 2 * sizeof(int), header->fingerNum, file) == (size_t)header->fingerNum;
+	if (ok && (header->flags & SnapshotImage))
+	{
+		ok = fwrite(slot->image, 3, size, file) == (size_t)size;
+	}
+
+	return fclose(file) == 0 && ok;
+}
+
+static THREAD_PROC(writerProc)
+{
+	DebugCapture* c = (DebugCapture*)threadArg;
+
+	for (;;)
+	{
+		semaphoreWait(&c->wake);
+
+		mutexLock(&c->mutex);
+		if (c->queueNum == 0)
+		{
+			mutexUnlock(&c->mutex);
+			if (c->stopRequested)
+			{
+				break;
+			}
+			continue;
+		}
+		CaptureSlot* slot = &c->slots[c->queue[c->queueHead]];
+		c->queueHead = (c->queueHead + 1) % c->slotNum;
+		c->queueNum--;
+		mutexUnlock(&c->mutex);
+
+		bool written = writeSnapshot(c, slot);
+
+		mutexLock(&c->mutex);
+		if (written) c->stats.written++;
+		else c->stats.failed++;
+		slot->busy = false;
+		mutexUnlock(&c->mutex);
+	}
+
+	return 0;
+}
+
+DLL_EXPORT void* debugCaptureCreate(int width, int height, int slotNum)
+{
+	if (width <= 0 || height <= 0 || slotNum <= 0)
+	{
+		return NULL;
+	}
+
+	DebugCapture* c = new DebugCapture();
+	memset(c, 0, sizeof(DebugCapture));
+	c->width = width;
+	c->height = height;
+	c->maxStrips = (width / 4 + 1) * height;
+	c->slotNum = slotNum;
+
+	Arena arena = { NULL, 0 };
+	carveCapture(c, &arena);
+	c->arena = arenaAllocate(&arena);
+	if (c->arena == NULL)
+	{
+		delete c;
+		return NULL;
+	}
+	carveCapture(c, &arena);
+
+	if (!semaphoreInit(&c->wake))
+	{
+		arenaFree(c->arena);
+		delete c;
+		return NULL;
+	}
+	mutexInit(&c->mutex);
+
+	if (!threadStart(&c->thread, writerProc, c))
+	{
+		mutexDestroy(&c->mutex);
+		semaphoreDestroy(&c->wake);
+		arenaFree(c->arena);
+		delete c;
+		return NULL;
+	}
+
+	return c;
+}
+
+proc_m debugCaptureDestroy(void* capture)
+{
+	DebugCapture* c = (DebugCapture*)capture;
+	if (c == NULL)
+	{
+		return 0;
+	}
+
+	//the queued slots have a post each and come first
+	c->stopRequested = 1;
+	semaphorePost(&c->wake);
+	threadJoin(&c->thread);
+
+	mutexDestroy(&c->mutex);
+	semaphoreDestroy(&c->wake);
+	arenaFree(c->arena);
+	delete c;
+
+	return 0;
+}
+
+proc_m debugCaptureTake(void* capture, void* detector, ushort* srcDepthPtr, int depthStride, int* fingers, int fingerNum, int* handHint,
+						byte* image, int pixelStride, long long timestamp, const char* path)
+{
+	DebugCapture* c = (DebugCapture*)capture;
+	if (c == NULL || srcDepthPtr == NULL || path == NULL || strlen(path) >= DEBUG_CAPTURE_MAX_PATH)
+	{
+		return -1;
+	}
+
+	CaptureSlot* slot = NULL;
+	mutexLock(&c->mutex);
+	for (int s = 0; s < c->slotNum && slot == NULL; s++)
+	{
+		slot = c->slots[s].busy ? NULL : &c->slots[s];
+	}
+	if (slot != NULL)
+	{
+		slot->busy = true;
+	}
+	else
+	{
+		c->stats.dropped++;
+	}
+	mutexUnlock(&c->mutex);
+	if (slot == NULL)
+	{
+		return -1;
+	}
+
+	int width = c->width, height = c->height;
+	DebugSnapshotHeader* header = &slot->header;
+	memset(header, 0, sizeof(DebugSnapshotHeader));
+	strcpy(header->magic, DEBUG_SNAPSHOT_MAGIC);
+	header->version = DEBUG_SNAPSHOT_VERSION;
+	header->headerSize = sizeof(DebugSnapshotHeader);
+	header->width = width;
+	header->height = height;
+	header->timestamp = timestamp;
+	header->fingerNum = fingerNum < DEBUG_CAPTURE_MAX_FINGERS ? fingerNum : DEBUG_CAPTURE_MAX_FINGERS;
+	if (handHint != NULL)
+	{
+		memcpy(header->handHint, handHint, sizeof(header->handHint));
+	}
+	strcpy(slot->path, path);
+
+	for (int i = 0; i < height; i++)
+	{
+		memcpy(slot->depth + i * width, srcDepthPtr + i * depthStride, width * sizeof(ushort));
+	}
+	if (fingers != NULL)
+	{
+		memcpy(slot->fingers, fingers, 2 * header->fingerNum * sizeof(int));
+	}
+	if (image != NULL)
+	{
+		for (int i = 0; i < height; i++)
+		{
+			memcpy(slot->image + 3 * i * width, image + i * pixelStride, 3 * width);
+		}
+		header->flags |= SnapshotImage;
+	}
+
+	if (detector != NULL)
+	{
+		int *hRes, *vRes;
+		if (derivativeFingerDetectorContextGetDerivativeFrame(detector, &hRes, &vRes) == 0)
+		{
+			for (int i = 0; i < height; i++)
+			{
+				memcpy(slot->hDerivative + i * width, hRes + i * depthStride, width * sizeof(int));
+				memcpy(slot->vDerivative + i * width, vRes + i * depthStride, width * sizeof(int));
+			}
+			header->flags |= SnapshotDerivative;
+		}
+		header->stripNum = derivativeFingerDetectorGetStrips(detector, slot->strips, c->maxStrips);
+	}
+
+	mutexLock(&c->mutex);
+	c->queue[(c->queueHead + c->queueNum) % c->slotNum] = (int)(slot - c->slots);
+	c->queueNum++;
+	c->stats.taken++;
+	mutexUnlock(&c->mutex);
+	semaphorePost(&c->wake);
+
+	return 0;
+}
+
+proc_m debugCaptureGetStats(void* capture, DebugCaptureStats* statsPtr)
+{
+	DebugCapture* c = (DebugCapture*)capture;
+	mutexLock(&c->mutex);
+	*statsPtr = c->stats;
+	mutexUnlock(&c->mutex);
+	return 0;
+}
@@ -0,0 +1,65 @@
+#ifndef _DEBUG_CAPTURE_H_
+#define _DEBUG_CAPTURE_H_
+
+#include "depth.h"
+
+//Debug snapshots of the derivative detector, written to disk by a thread of their own. Taking one only copies the
+//frame and the detector buffers into a free preallocated slot, the file is written later, so detection goes on.
+//KinectGesturesTools/snapshotDump converts a snapshot to CSV and PNG files.
+//
+//Snapshot file, little endian:
+//	header		DebugSnapshotHeader
+//	depth		width * height ushorts
+//	derivative	width * height ints horizontal, then as many vertical, with SnapshotDerivative only
+//	strips		stripNum (row, leftCol, rightCol) int triplets
+//	fingers		fingerNum (x, y) int pairs
+//	image		width * height RGB24 pixels, with SnapshotImage only
+//Rows carry no padding.
+
+#define DEBUG_SNAPSHOT_MAGIC "KGSNAP"				//8 bytes with the terminating 0
+#define DEBUG_SNAPSHOT_VERSION 1
+#define DEBUG_CAPTURE_MAX_FINGERS 64
+#define DEBUG_CAPTURE_MAX_PATH 260
+
+typedef enum
+{
+	SnapshotDerivative = 1,		//the detector filled its derivative frames for this frame
+	SnapshotImage = 2			//the frame was detected with OutputImage
+} SnapshotFlags;
+
+typedef struct DebugSnapshotHeader
+{
+	char magic[8];
+	int version;
+	int headerSize;				//sizeof(DebugSnapshotHeader), the depth follows
+	int width, height;
+	int flags;					//SnapshotFlags
+	int fingerNum;
+	int stripNum;
+	int handHint[4];
+	int reserved;
+	long long timestamp;
+} DebugSnapshotHeader;
+
+typedef struct DebugCaptureStats
+{
+	int taken;					//copied into a slot
+	int written;
+	int dropped;				//no free slot
+	int failed;					//could not write the file
+} DebugCaptureStats;
+
+//slotNum snapshots may wait for the writer at a time. Returns NULL when out of memory.
+DLL_EXPORT void* debugCaptureCreate(int width, int height, int slotNum);
+//writes the snapshots still waiting, then stops the writer
+proc_m debugCaptureDestroy(void* capture);
+
+//detector: the derivative detector that just detected the frame, its strips and derivative frames are copied. Call it
+//from the thread that runs the detector. image (optional): the RGB24 output of the frame, pixelStride bytes per row.
+//Returns 0, or -1 when all slots are waiting for the writer and the snapshot is dropped.
+proc_m debugCaptureTake(void* capture, void* detector, ushort* srcDepthPtr, int depthStride, int* fingers, int fingerNum, int* handHint,
+						byte* image, int pixelStride, long long timestamp, const char* path);
+
+proc_m debugCaptureGetStats(void* capture, DebugCaptureStats* statsPtr);
+
+#endif
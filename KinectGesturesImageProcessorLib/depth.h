@@ -4,7 +4,11 @@
 typedef unsigned char byte;
 typedef unsigned short ushort;
 
+#ifdef _WIN32
 #define DLL_EXPORT extern "C" __declspec(dllexport)
+#else
+#define DLL_EXPORT extern "C" __attribute__((visibility("default")))	//the replay tools build the library on Linux
+#endif
 #define proc_m DLL_EXPORT int								//processor function modifier
 #define proc_para_depth ushort* srcDepthPtr, byte* dstPixelPtr, int width, int height, int depthStride, int pixelStride
 
@@ -0,0 +1,205 @@
+#include "depthSequence.h"
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+//64 bit offsets, a few minutes of 640x480 are already more than 2 GB
+static bool seekFile(FILE* file, long long offset)
+{
+#ifdef _MSC_VER
+	return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//recording
+
+DLL_EXPORT void* depthSequenceCreate(const char* path, int width, int height, int deviceMaxDepth, double realWorldXToZ, double realWorldYToZ, int maxFrames)
+{
+	if (width <= 0 || height <= 0 || maxFrames <= 0)
+	{
+		return NULL;
+	}
+
+	FILE* file = fopen(path, "wb");
+	if (file == NULL)
+	{
+		return NULL;
+	}
+
+	DepthSequence* sequence = new DepthSequence();
+	memset(sequence, 0, sizeof(DepthSequence));
+	sequence->file = file;
+	sequence->header = &sequence->recording;
+
+	DepthSequenceHeader* header = &sequence->recording;
+	memcpy(header->magic, DEPTH_SEQUENCE_MAGIC, sizeof(header->magic));
+	header->version = DEPTH_SEQUENCE_VERSION;
+	header->headerSize = sizeof(DepthSequenceHeader);
+	header->width = width;
+	header->height = height;
+	header->deviceMaxDepth = deviceMaxDepth;
+	header->capacity = maxFrames;
+	header->frameNum = 0;
+	header->realWorldXToZ = realWorldXToZ;
+	header->realWorldYToZ = realWorldYToZ;
+	header->frameSize = (long long)width * height * sizeof(ushort);
+
+	long long tableEnd = sizeof(DepthSequenceHeader) + (long long)maxFrames * sizeof(long long);
+	header->frameOffset = (tableEnd + DEPTH_SEQUENCE_ALIGNMENT - 1) / DEPTH_SEQUENCE_ALIGNMENT * DEPTH_SEQUENCE_ALIGNMENT;
+
+	//header, then a zeroed table up to the first frame
+	bool ok = fwrite(header, sizeof(DepthSequenceHeader), 1, file) == 1;
+	static const byte zeros[DEPTH_SEQUENCE_ALIGNMENT] = { 0 };
+	for (long long offset = sizeof(DepthSequenceHeader); ok && offset < header->frameOffset; offset += DEPTH_SEQUENCE_ALIGNMENT)
+	{
+		long long count = header->frameOffset - offset < DEPTH_SEQUENCE_ALIGNMENT ? header->frameOffset - offset : DEPTH_SEQUENCE_ALIGNMENT;
+		ok = fwrite(zeros, (size_t)count, 1, file) == 1;
+	}
+
+	if (!ok)
+	{
+		depthSequenceClose(sequence);
+		return NULL;
+	}
+
+	return sequence;
+}
+
+proc_m depthSequenceWrite(void* sequence, ushort* srcDepthPtr, int depthStride, long long timestamp)
+{
+	DepthSequence* seq = (DepthSequence*)sequence;
+	DepthSequenceHeader* header = &seq->recording;
+	FILE* file = (FILE*)seq->file;
+	if (seq->view != NULL || header->frameNum >= header->capacity)
+	{
+		return -1;
+	}
+
+	int index = header->frameNum;
+	bool ok = seekFile(file, header->frameOffset + index * header->frameSize);
+	if (depthStride == header->width)
+	{
+		ok = ok && fwrite(srcDepthPtr, (size_t)header->frameSize, 1, file) == 1;
+	}
+	else
+	{
+		for (int i = 0; ok && i < header->height; i++)
+		{
+			ok = fwrite(srcDepthPtr + i * depthStride, header->width * sizeof(ushort), 1, file) == 1;
+		}
+	}
+
+	//the frame before its timestamp and count, so a reader never sees a frame that isn't there
+	ok = ok && fflush(file) == 0;
+	ok = ok && seekFile(file, header->headerSize + index * (long long)sizeof(long long)) && fwrite(&timestamp, sizeof(long long), 1, file) == 1;
+	header->frameNum = index + 1;
+	ok = ok && seekFile(file, offsetof(DepthSequenceHeader, frameNum)) && fwrite(&header->frameNum, sizeof(int), 1, file) == 1;
+	ok = ok && fflush(file) == 0;
+
+	return ok ? index : -1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//replaying
+
+static bool validHeader(const DepthSequenceHeader* header, long long fileSize)
+{
+	if (fileSize < (long long)sizeof(DepthSequenceHeader) || memcmp(header->magic, DEPTH_SEQUENCE_MAGIC, sizeof(header->magic)) != 0 ||
+		header->version != DEPTH_SEQUENCE_VERSION || header->headerSize != sizeof(DepthSequenceHeader) ||
+		header->width <= 0 || header->height <= 0 || header->frameSize != (long long)header->width * header->height * (long long)sizeof(ushort) ||
+		header->frameNum < 0 || header->frameNum > header->capacity || header->frameOffset % DEPTH_SEQUENCE_ALIGNMENT != 0)
+	{
+		return false;
+	}
+
+	return header->headerSize + (long long)header->capacity * (long long)sizeof(long long) <= header->frameOffset &&
+		   header->frameOffset + header->frameNum * header->frameSize <= fileSize;
+}
+
+DLL_EXPORT void* depthSequenceOpen(const char* path)
+{
+	DepthSequence* sequence = new DepthSequence();
+	memset(sequence, 0, sizeof(DepthSequence));
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	LARGE_INTEGER size;
+	if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+		delete sequence;
+		return NULL;
+	}
+	sequence->file = file;
+	sequence->viewSize = size.QuadPart;
+	sequence->mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	sequence->view = sequence->mapping != NULL ? MapViewOfFile(sequence->mapping, FILE_MAP_READ, 0, 0, 0) : NULL;	//fails past 2 GB in a 32 bit process
+#else
+	//fopen rather than open(2): this library exports its own open (morphological.cpp)
+	FILE* file = fopen(path, "rb");
+	struct stat status;
+	if (file == NULL || fstat(fileno(file), &status) != 0 || status.st_size == 0)
+	{
+		if (file != NULL) fclose(file);
+		delete sequence;
+		return NULL;
+	}
+	sequence->file = file;
+	sequence->viewSize = status.st_size;
+	void* view = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_SHARED, fileno(file), 0);
+	sequence->view = view != MAP_FAILED ? view : NULL;
+#endif
+
+	const DepthSequenceHeader* header = (const DepthSequenceHeader*)sequence->view;
+	if (header == NULL || !validHeader(header, sequence->viewSize))
+	{
+		depthSequenceClose(sequence);
+		return NULL;
+	}
+
+	sequence->header = header;
+	sequence->timestamps = (const long long*)((const byte*)sequence->view + header->headerSize);
+	sequence->frames = (const ushort*)((const byte*)sequence->view + header->frameOffset);
+	return sequence;
+}
+
+proc_m depthSequenceClose(void* sequence)
+{
+	DepthSequence* seq = (DepthSequence*)sequence;
+	if (seq == NULL)
+	{
+		return 0;
+	}
+
+#ifdef _WIN32
+	if (seq->view != NULL) UnmapViewOfFile(seq->view);
+	if (seq->mapping != NULL) CloseHandle(seq->mapping);
+	if (seq->file != NULL)
+	{
+		if (seq->header == &seq->recording) fclose((FILE*)seq->file);
+		else CloseHandle(seq->file);
+	}
+#else
+	if (seq->view != NULL) munmap(seq->view, (size_t)seq->viewSize);
+	if (seq->file != NULL) fclose((FILE*)seq->file);
+#endif
+
+	delete seq;
+	return 0;
+}
@@ -0,0 +1,58 @@
+#ifndef _DEPTH_SEQUENCE_H_
+#define _DEPTH_SEQUENCE_H_
+
+#include "depth.h"
+
+//Raw depth sequence file, recorded from the sensor and replayed without it:
+//	header		DepthSequenceHeader, then the timestamp table: capacity long longs (microseconds), frameNum of them used
+//	frames		from frameOffset on, frame k at frameOffset + k * frameSize, width * height ushorts each, no row padding
+//Everything is little endian. frameOffset is a multiple of DEPTH_SEQUENCE_ALIGNMENT, so a memory mapped file gives
+//aligned frames that go straight into the detectors (depthStride = width). The writer updates frameNum after every
+//frame, a recording cut short by a crash is still readable.
+
+#define DEPTH_SEQUENCE_MAGIC "KGDEPTH"				//8 bytes with the terminating 0
+#define DEPTH_SEQUENCE_VERSION 1
+#define DEPTH_SEQUENCE_ALIGNMENT 4096
+
+typedef struct DepthSequenceHeader
+{
+	char magic[8];
+	int version;
+	int headerSize;					//sizeof(DepthSequenceHeader), the timestamp table follows
+	int width, height;
+	int deviceMaxDepth;
+	int capacity;					//entries of the timestamp table, the most frames the file can hold
+	int frameNum;
+	int reserved;
+	double realWorldXToZ, realWorldYToZ;	//see derivativeFingerDetectorCreate
+	long long frameOffset;
+	long long frameSize;			//bytes
+} DepthSequenceHeader;
+
+typedef struct DepthSequence
+{
+	const DepthSequenceHeader* header;
+	const long long* timestamps;
+	const ushort* frames;
+
+	void* view;						//the whole file mapped, NULL while recording
+	long long viewSize;
+	void* file;						//FILE*, or the file HANDLE of a mapping on Windows
+	void* mapping;					//mapping HANDLE on Windows
+	DepthSequenceHeader recording;	//what is written so far, header points here while recording
+} DepthSequence;
+
+#define depthSequenceFrame(sequence, index) ((sequence)->frames + (long long)(index) * (sequence)->header->width * (sequence)->header->height)
+
+//recording, maxFrames is fixed up front because the timestamp table sits in the header. Returns NULL on failure.
+DLL_EXPORT void* depthSequenceCreate(const char* path, int width, int height, int deviceMaxDepth, double realWorldXToZ, double realWorldYToZ, int maxFrames);
+//returns the index of the frame, -1 when the file is full or on a write error
+proc_m depthSequenceWrite(void* sequence, ushort* srcDepthPtr, int depthStride, long long timestamp);
+
+//replaying, the file is mapped read only. Returns NULL when it isn't a depth sequence.
+DLL_EXPORT void* depthSequenceOpen(const char* path);
+
+//closes both kinds
+proc_m depthSequenceClose(void* sequence);
+
+#endif
@@ -1,8 +1,12 @@
-#include "depth.h"
+#include "derivativeFingerDetector.h"
+#include "detectorContext.h"
+#include "arena.h"
+#include "sobel.h"
+#include "pyramid.h"
+#include "fixedSize.h"
 #include <memory.h>
 #include <assert.h>
 #include <math.h>
-#include <vector>
 #include <algorithm>
 using namespace std;
 
@@ -12,6 +16,13 @@ using namespace std;
 #define STRIP_MAX_BLANK_PIXEL 10
 #define FINGER_MIN_PIXEL_LENGTH 10
 #define FINGER_TO_HAND_OFFSET 100   //in millimeters
+#define PYRAMID_MAX_CANDIDATES OVERLAY_MAX_FINGERS
+#define OUTPUT_HISTOGRAM_SUB_BINS 8192		//per band, enough for the derivative of the table and the hands
+#define OUTPUT_HISTOGRAM_TAIL_SHARE 16		//one pixel in that many of a band may be past the sub-histogram before a rescan
+#define QUALITY_AVERAGE_WEIGHT 4			//the frame time average follows roughly the last 4 frames
+#define QUALITY_RESTORE_SHARE 0.6			//a better level is tried when a level takes less than this share of the deadline
+#define QUALITY_HOLD_FRAMES 30				//frames at a level before that, doubled after every failed try
+#define QUALITY_MAX_HOLD_FRAMES 960
 
 typedef enum
 {
@@ -21,69 +32,36 @@ typedef enum
 	StripFalling
 } StripState;
 
-typedef struct Strip
-{
-	int row;
-	int leftCol, rightCol;
-	bool visited;
-	struct Strip(int row, int leftCol, int rightCol) : row(row), leftCol(leftCol), rightCol(rightCol), visited(false) { }
-} Strip;
+static DetectorContext* defaultContext = NULL;	//used by the context-less exports
 
-typedef struct Finger
+//A frame processed in horizontal bands. Sobel reads its halo rows straight from the source and findStrips only
+//touches its own rows of the derivative, the pixel buffer and the strip store, so bands are independent until findFingers.
+//In tracking and pyramid mode the bands only cover the rows of roi, and strips are only looked for in its spans.
+typedef struct FrameJob
 {
-	int tipX, tipY, tipZ;
-	int endX, endY, endZ;
-	struct Finger(int tipX, int tipY, int tipZ, int endX, int endY, int endZ) : tipX(tipX), tipY(tipY), tipZ(tipZ), endX(endX), endY(endY), endZ(endZ) { }
-	bool operator<(const Finger& ref) const { return endY - tipY > ref.endY - ref.tipY; }	//sort more to less
-} Finger;
-
-static int *hDerivativeRes = NULL, *vDerivativeRes = NULL, *histogram = NULL;
-static byte* tmpPixelBuffer;
-static int maxHistogramSize = 0, deviceMaxDepth;
-static double realWorldXToZ, realWorldYToZ;
-
-int sobel(proc_para_depth)
+	DetectorContext* ctx;
+	ushort* srcDepthPtr;
+	byte* dstPixelPtr;
+	int width, height, depthStride, pixelStride;
+	double fingerWidthMin, fingerWidthMax;
+	Roi roi;
+	bool materialize;			//fill the full derivative frames, otherwise every row is scanned as soon as it is computed
+	const int* spans;			//[left, right) column pairs within roi, sorted and disjoint
+	int spanNum;
+} FrameJob;
+
+#define frameJobPara(job) (job)->srcDepthPtr, (job)->dstPixelPtr, (job)->width, (job)->height, (job)->depthStride, (job)->pixelStride
+
+//rows of a band when rows [top, bottom) are split into ctx->bandNum bands
+static void bandRows(DetectorContext* ctx, int band, int top, int bottom, int& rowBegin, int& rowEnd)
 {
-	const double tpl[5][5] =	
-	{
-		{1, 2, 0, -2, -1},
-		{4, 8, 0, -8, -4},
-		{6, 12, 0, -12, -6},
-		{4, 8, 0, -8, -4},
-		{1, 2, 0, -2, -1}
-	};
-
-	const int tpl_offset = 2;
-
-	for (int i = 0; i < height; i++)
-	{
-		for (int j = 0; j < width; j++)
-		{
-
-			double depthH = 0, depthV = 0;
-			for (int ti = 0; ti < 5; ti++)
-			{
-				int neighbor_row = i + ti - tpl_offset;
-				if(neighbor_row < 0 || neighbor_row >= height)
-					continue;
-
-				for (int tj = 0; tj < 5; tj++)
-				{
-					int neighbor_col = j + tj - tpl_offset;
-					if(neighbor_col < 0 || neighbor_col >= width)
-						continue;
-
-					ushort srcDepthVal = *srcDepth(neighbor_row, neighbor_col);
-					//depthH += tpl[ti][tj] * srcDepthVal;
-					depthH += tpl[ti][tj] * (srcDepthVal == 0 ? deviceMaxDepth : srcDepthVal);
-					//depthV += tpl[tj][ti] * *srcDepth(neighbor_row, neighbor_col);
-				}
-			}
-			*bufferDepth(hDerivativeRes, i, j) = (int)(depthH + 0.5);
-			//*bufferDepth(vDerivativeRes, i, j) = (int)(depthV + 0.5);
-		}
-	}
+	rowBegin = top + (bottom - top) * band / ctx->bandNum;
+	rowEnd = top + (bottom - top) * (band + 1) / ctx->bandNum;
+}
 
+int sobel(DetectorContext* ctx, proc_para_depth)
+{
+	sobelRows(ctx->simdLevel, srcDepthPtr, width, height, depthStride, ctx->deviceMaxDepth, 0, height, ctx->hDerivativeRes, ctx->vDerivativeRes, ctx->sobelScratch);
 	return 0;
 }
 
@@ -113,8 +91,8 @@ int sobelLinear(proc_para_depth)
 					depthH += tpl[ti] * *srcDepth(i, neighbor_col);
 				}
 			}
-			*bufferDepth(hDerivativeRes, i, j) = (int)(depthH + 0.5);
-			*bufferDepth(vDerivativeRes, i, j) = (int)(depthV + 0.5);
+			*bufferDepth(ctx->hDerivativeRes, i, j) = (int)(depthH + 0.5);
+			*bufferDepth(ctx->vDerivativeRes, i, j) = (int)(depthV + 0.5);
 		}
 	}
 
@@ -122,250 +100,314 @@ int sobelLinear(proc_para_depth)
 }
 */
 
-void generateOutputImage(proc_para_depth)
+//range of the absolute derivative in rows [rowBegin, rowEnd). Branch free, so the rows vectorize; with a FixedSize the
+//row length is a constant and there is no remainder loop.
+template <class Size>
+static void derivativeRangeRows(const int* hDerivative, Size size, int rowBegin, int rowEnd, int& min, int& max)
 {
-	//generate histogram
-	//int min = 65535, max = -65535;
-	int min = 65535, max = 0;
-	for (int i = 0; i < height; i++)
+	const int width = size.width(), depthStride = size.stride();
+	int rowMin = 65535, rowMax = 0;
+	for (int i = rowBegin; i < rowEnd; i++)
 	{
+		const int* h = bufferDepth(hDerivative, i, 0);
 		for (int j = 0; j < width; j++)
 		{
-			int h = (int)abs(*bufferDepth(hDerivativeRes, i, j));
-			//int v = *bufferDepth(vDerivativeRes, i, j);
-			if (h > max) max = h;
-			//if (v > max) max = v;
-			if (h < min) min = h;
-			//if (v < min) min = v;
+			int a = abs(h[j]);
+			rowMax = a > rowMax ? a : rowMax;
+			rowMin = a < rowMin ? a : rowMin;
 		}
 	}
-	
-	int histogramSize = max - min + 1;
-	assert(histogramSize < maxHistogramSize);
-	int histogramOffset = min;
+	min = rowMin;
+	max = rowMax;
+}
+
+void derivativeRange(DetectorContext* ctx, proc_para_depth, int rowBegin, int rowEnd, int& min, int& max)
+{
+	dispatchFixedSize(width, height, depthStride, derivativeRangeRows(ctx->hDerivativeRes, size, rowBegin, rowEnd, min, max));
+}
 
-	memset(histogram, 0, histogramSize * sizeof(int));
+//rows [rowBegin, rowEnd) of the output image: the equalized derivative under the overlay of findStrips / findFingers
+void drawOutputRows(DetectorContext* ctx, proc_para_depth, int rowBegin, int rowEnd)
+{
+	const Histogram* h = &ctx->histogram;
+	colorizeDerivativeRows(ctx->simdLevel, ctx->hDerivativeRes, depthStride, ctx->tmpPixelBuffer, h->lut, h->offset, h->size,
+						   dstPixelPtr, pixelStride, width, rowBegin, rowEnd);
+}
 
-	//int points = 0;
-	for (int i = 0; i < height; i++)
-	{
-		for (int j = 0; j < width; j++)
-		{
-			int h = (int)abs(*bufferDepth(hDerivativeRes, i, j));
-			//int v = *bufferDepth(vDerivativeRes, i, j);
-			histogram[h - histogramOffset]++;
-			//histogram[v - histogramOffset]++;
-		}
-	}
+static void rangeBandTask(void* arg, int band)
+{
+	FrameJob* job = (FrameJob*)arg;
+	DetectorContext* ctx = job->ctx;
+	int rowBegin, rowEnd;
+	bandRows(ctx, band, 0, job->height, rowBegin, rowEnd);
+	derivativeRange(ctx, frameJobPara(job), rowBegin, rowEnd, ctx->bandMin[band], ctx->bandMax[band]);
+}
 
-	for (int i = 1; i < histogramSize; i++)
-	{
-		histogram[i] += histogram[i-1];
-	}
+static void countBandTask(void* arg, int band)
+{
+	FrameJob* job = (FrameJob*)arg;
+	DetectorContext* ctx = job->ctx;
+	int rowBegin, rowEnd;
+	bandRows(ctx, band, 0, job->height, rowBegin, rowEnd);
+	histogramCountAbs(&ctx->histogram, band, ctx->hDerivativeRes, job->depthStride, job->width, rowBegin, rowEnd);
+}
 
-	//int points = width * height * 2;
-	int points = width * height;
-	for (int i = 0; i < histogramSize; i++)
-	{
-		histogram[i] = (int)(256 * ((double)histogram[i] / (double)points) + 0.5);
-	}
+static void drawBandTask(void* arg, int band)
+{
+	FrameJob* job = (FrameJob*)arg;
+	DetectorContext* ctx = job->ctx;
+	int rowBegin, rowEnd;
+	bandRows(ctx, band, 0, job->height, rowBegin, rowEnd);
+	drawOutputRows(ctx, frameJobPara(job), rowBegin, rowEnd);
+}
 
-	//draw the image
-	for (int i = 0; i < height; i++)
+void generateOutputImage(DetectorContext* ctx, proc_para_depth)
+{
+	FrameJob job = { ctx, srcDepthPtr, dstPixelPtr, width, height, depthStride, pixelStride, 0, 0, { 0, 0, width, height }, true, NULL, 0 };
+
+	if (ctx->histogram.size == 0 || ++ctx->framesSinceHistogram >= ctx->histogramInterval)
 	{
-		for (int j = 0; j < width; j++)
+		threadPoolRun(ctx->threadPool, rangeBandTask, &job, ctx->bandNum);
+		int min = ctx->bandMin[0], max = ctx->bandMax[0];
+		for (int band = 1; band < ctx->bandNum; band++)
 		{
-			if (bufferPixel(tmpPixelBuffer, i, j)[0] == 255 || bufferPixel(tmpPixelBuffer, i, j)[1] == 255 || bufferPixel(tmpPixelBuffer, i, j)[2] == 255)
-			{
-				dstPixel(i ,j)[0] = bufferPixel(tmpPixelBuffer, i, j)[0];
-				dstPixel(i ,j)[1] = bufferPixel(tmpPixelBuffer, i, j)[1];
-				dstPixel(i ,j)[2] = bufferPixel(tmpPixelBuffer, i, j)[2];
-			}
-			else
-			{
-				int depth = *bufferDepth(hDerivativeRes, i, j);
-				if (depth >= 0)
-				{
-					dstPixel(i, j)[0] = 0;
-					dstPixel(i, j)[2] = histogram[depth - histogramOffset];
-				}
-				else
-				{
-					dstPixel(i, j)[0] = histogram[-depth - histogramOffset];
-					dstPixel(i, j)[2] = 0;
-				}
-				dstPixel(i, j)[1] = bufferPixel(tmpPixelBuffer, i, j)[1];
-				//dstPixel(i, j)[1] = 0;
-			}
-			//dstPixel(i, j)[1] = histogram[*bufferDepth(hDerivativeRes, i, j) - histogramOffset];
-			//dstPixel(i, j)[2] = histogram[*bufferDepth(vDerivativeRes, i, j) - histogramOffset];
+			if (ctx->bandMin[band] < min) min = ctx->bandMin[band];
+			if (ctx->bandMax[band] > max) max = ctx->bandMax[band];
 		}
-	}
-}
 
-double distSquaredInRealWorld(int x1, int y1, int depth1, int x2, int y2, int depth2, int width, int height)
-{
-	double x1Real = ((double)x1 / (double)width - 0.5) * depth1 * realWorldXToZ;
-	double y1Real = (0.5 - (double)y1 / (double)height) * depth1 * realWorldYToZ;
-	double x2Real = ((double)x2 / (double)width - 0.5) * depth2 * realWorldXToZ;
-	double y2Real = (0.5 - (double)y2 / (double)height) * depth2 * realWorldYToZ; 
+		histogramBegin(&ctx->histogram, min, max - min + 1);
+		threadPoolRun(ctx->threadPool, countBandTask, &job, ctx->bandNum);
+		histogramMerge(&ctx->histogram);
+		histogramLutEqualize(&ctx->histogram);
+		ctx->framesSinceHistogram = 0;
+	}
 
-	return (x1Real - x2Real) * (x1Real - x2Real) + (y1Real - y2Real) * (y1Real - y2Real) + (depth1 - depth2) * (depth1 - depth2);
+	threadPoolRun(ctx->threadPool, drawBandTask, &job, ctx->bandNum);
 }
 
-void convertProjectiveToRealWorld(int px, int py, int depth, double& rx, double& ry, int width, int height)
+static void extendBox(Roi& box, int x, int y)
 {
-	rx = ((double)px / (double)width - 0.5) * depth * realWorldXToZ;
-	ry = (0.5 - (double)py / (double)height) * depth * realWorldYToZ;
+	if (x < box.left) box.left = x;
+	if (x + 1 > box.right) box.right = x + 1;
+	if (y < box.top) box.top = y;
+	if (y + 1 > box.bottom) box.bottom = y + 1;
 }
 
-//strips: first vector: rows; second vector: a list of all strip in a row;
-void findStrips(proc_para_depth, double fingerWidthMin, double fingerWidthMax, vector<vector<Strip> >& strips)
+//adds the strips of columns [colBegin, colEnd) to row i of the strip store in ctx, from hRow, the horizontal derivative
+//of the row. The strips already in the row must be left of colBegin.
+static void findRowStrips(DetectorContext* ctx, proc_para_depth, double fingerWidthMin, double fingerWidthMax, const int* hRow, int i, int colBegin, int colEnd)
 {
-	for (int i = 0; i < height; i++)
+	Strip* rowStrips = ctx->strips + i * ctx->stripCapacity;
+	int& stripNum = ctx->stripNum[i];
+
+	StripState state = StripSmooth;
+	int partialMin = 0, partialMax = 0;
+	int partialMinPos = 0, partialMaxPos = 0;
+	for (int j = colBegin; j < colEnd; j++)
 	{
-		strips.push_back(vector<Strip>());
+		int currVal = hRow[j];
 
-		StripState state = StripSmooth;
-		int partialMin, partialMax;
-		int partialMinPos, partialMaxPos;
-		for (int j = 0; j < width; j++)
+		switch(state)
 		{
-			if (i == 240 && j == 160)
+		case StripSmooth:	//TODO: smooth
+			if (currVal > FINGER_EDGE_THRESHOLD)
 			{
-				int checkpoint = 1;
+				partialMax = currVal;
+				partialMaxPos = j;
+				state = StripRising;
 			}
+			break;
 
-			int currVal = *bufferDepth(hDerivativeRes, i, j);
-
-			switch(state)
+		case StripRising:
+			if (currVal > FINGER_EDGE_THRESHOLD)
 			{
-			case StripSmooth:	//TODO: smooth
-				if (currVal > FINGER_EDGE_THRESHOLD)
+				if (currVal > partialMax)
 				{
 					partialMax = currVal;
 					partialMaxPos = j;
-					state = StripRising;
 				}
-				break;
+			}
+			else 
+			{
+				state = StripMidSmooth;
+			}
+			break;
 
-			case StripRising:
-				if (currVal > FINGER_EDGE_THRESHOLD)
-				{
-					if (currVal > partialMax)
-					{
-						partialMax = currVal;
-						partialMaxPos = j;
-					}
-				}
-				else 
-				{
-					state = StripMidSmooth;
-				}
-				break;
+		case StripMidSmooth:
+			if (currVal < -FINGER_EDGE_THRESHOLD)
+			{
+				partialMin = currVal;
+				partialMinPos = j;
+				state = StripFalling;
+			}
+			else if (currVal > FINGER_EDGE_THRESHOLD)
+			{
+				//previous trial faied, start over
+				partialMax = currVal;
+				partialMaxPos = j;
+				state = StripRising;
+			}
+			break;
 
-			case StripMidSmooth:
-				if (currVal < -FINGER_EDGE_THRESHOLD)
+		case StripFalling:
+			if (currVal < -FINGER_EDGE_THRESHOLD)
+			{
+				if (currVal < partialMin)
 				{
 					partialMin = currVal;
 					partialMinPos = j;
-					state = StripFalling;
-				}
-				else if (currVal > FINGER_EDGE_THRESHOLD)
-				{
-					//previous trial faied, start over
-					partialMax = currVal;
-					partialMaxPos = j;
-					state = StripRising;
 				}
-				break;
+			}
+			else
+			{
+				int depth = *srcDepth(i, (partialMaxPos + partialMinPos) / 2);	//use the middle point of the strip to measure depth, assuming it is the center of the finger
+				double distSquared = cameraRowDistSquared(&ctx->camera, partialMaxPos, partialMinPos, depth);
 
-			case StripFalling:
-				if (currVal < -FINGER_EDGE_THRESHOLD)
+				if (distSquared >= fingerWidthMin * fingerWidthMin && distSquared <= fingerWidthMax * fingerWidthMax)
 				{
-					if (currVal < partialMin)
+					for (int tj = partialMaxPos; tj <= partialMinPos && (ctx->outputFlags & OutputImage); tj++)
 					{
-						partialMin = currVal;
-						partialMinPos = j;
+						//bufferPixel(ctx->tmpPixelBuffer, i, tj)[0] = 0;
+						bufferPixel(ctx->tmpPixelBuffer, i, tj)[1] = 255;
+						//bufferPixel(ctx->tmpPixelBuffer, i, tj)[2] = 0;
 					}
+					assert(stripNum < ctx->stripCapacity);
+					rowStrips[stripNum++] = Strip(i, partialMaxPos, partialMinPos);
+					
+					partialMax = currVal;
+					partialMaxPos = j;
 				}
-				else
-				{
-					int depth = *srcDepth(i, (partialMaxPos + partialMinPos) / 2);	//use the middle point of the strip to measure depth, assuming it is the center of the finger
-					double distSquared = distSquaredInRealWorld(
-						partialMaxPos, i, depth,
-						partialMinPos, i, depth,
-						width, height);
 
-					if (distSquared >= fingerWidthMin * fingerWidthMin && distSquared <= fingerWidthMax * fingerWidthMax)
-					{
-						for (int tj = partialMaxPos; tj <= partialMinPos; tj++)
-						{
-							//bufferPixel(tmpPixelBuffer, i, tj)[0] = 0;
-							bufferPixel(tmpPixelBuffer, i, tj)[1] = 255;
-							//bufferPixel(tmpPixelBuffer, i, tj)[2] = 0;
-						}
-						strips[i].push_back(Strip(i, partialMaxPos, partialMinPos));
-						
-						partialMax = currVal;
-						partialMaxPos = j;
-					}
+				state = StripSmooth;
+			}
+			break;
+		}
+	}
+}
 
-					state = StripSmooth;
-				}
-				break;
+//fills rows [rowBegin, rowEnd) of the strip store in ctx from hDerivativeRes, looking at columns [colBegin, colEnd) only
+void findStrips(DetectorContext* ctx, proc_para_depth, double fingerWidthMin, double fingerWidthMax, int rowBegin, int rowEnd, int colBegin, int colEnd)
+{
+	for (int i = rowBegin; i < rowEnd; i++)
+	{
+		ctx->stripNum[i] = 0;
+		if (i % ctx->rowStep == 0)
+		{
+			findRowStrips(ctx, srcDepthPtr, dstPixelPtr, width, height, depthStride, pixelStride, fingerWidthMin, fingerWidthMax,
+						  bufferDepth(ctx->hDerivativeRes, i, 0), i, colBegin, colEnd);
+		}
+	}
+}
+
+//fills row i of the strip store from hRow, span after span of job
+static void findSpanStrips(FrameJob* job, const int* hRow, int i)
+{
+	DetectorContext* ctx = job->ctx;
+	ctx->stripNum[i] = 0;
+	if (i % ctx->rowStep != 0)
+	{
+		return;
+	}
+	for (int s = 0; s < job->spanNum; s++)
+	{
+		findRowStrips(ctx, frameJobPara(job), job->fingerWidthMin, job->fingerWidthMax, hRow, i, job->spans[2 * s], job->spans[2 * s + 1]);
+	}
+}
+
+//index of the first strip of a row whose rightCol > col, strips of a row are sorted and disjoint
+static int firstStripRightOf(const Strip* rowStrips, int stripNum, int col)
+{
+	int low = 0, high = stripNum;
+	while (low < high)
+	{
+		int mid = (low + high) / 2;
+		if (rowStrips[mid].rightCol > col)
+		{
+			high = mid;
+		}
+		else
+		{
+			low = mid + 1;
+		}
+	}
+	return low;
+}
+
+//the strip of the row to continue a chain ending with top, NULL when there is none
+static Strip* linkStrip(DetectorContext* ctx, int row, const Strip* top)
+{
+	if (row == top->row)
+	{
+		return NULL;	//strips of a row never overlap each other, only top itself would
+	}
+
+	Strip* rowStrips = ctx->strips + row * ctx->stripCapacity;
+	int stripNum = ctx->stripNum[row];
+
+	Strip* best = NULL;
+	int bestOverlap = 0;
+	for (int k = firstStripRightOf(rowStrips, stripNum, top->leftCol); k < stripNum && rowStrips[k].leftCol < top->rightCol; k++)	//overlap!
+	{
+		Strip* strip = &rowStrips[k];
+		if (ctx->stripLinking == StripLinkFirst)
+		{
+			if (!strip->visited)
+			{
+				return strip;
 			}
+			continue;
+		}
+
+		int overlap = min(strip->rightCol, top->rightCol) - max(strip->leftCol, top->leftCol);
+		if (overlap > bestOverlap)
+		{
+			best = strip;
+			bestOverlap = overlap;
 		}
 	}
+	return best;
 }
 
 //handhint: the result for estimating the hand position, in real world coordinate. int x, int y, int z, int pixelLength. pixel lenth is used as the measure of confidence.
-int findFingers(proc_para_depth, double fingerLengthMin, double fingerLengthMax, vector<vector<Strip> >& strips, int maxFingers, int* resultPtr, int* handHint)
+int findFingers(DetectorContext* ctx, proc_para_depth, double fingerLengthMin, double fingerLengthMax, int maxFingers, int* resultPtr, int* handHint)
 {
-	vector<Strip*> stripBuffer;	//used to fill back
-	vector<Finger> fingers;
+	Strip** stripBuffer = ctx->chain;	//used to fill back
+	int stripBufferSize;
+	Finger* fingers = ctx->fingerCandidates;
+	int fingerNum = 0;
 
 	for (int i = 0; i < height; i++)
 	{
-		for (vector<Strip>::iterator it = strips[i].begin(); it != strips[i].end(); ++it)
+		Strip* rowStrips = ctx->strips + i * ctx->stripCapacity;
+		for (Strip* it = rowStrips; it != rowStrips + ctx->stripNum[i]; ++it)
 		{
 			if (it->visited)
 			{
 				continue;
 			}
 
-			stripBuffer.clear();
-			stripBuffer.push_back(&(*it));
+			stripBufferSize = 0;
+			stripBuffer[stripBufferSize++] = it;
+			stageCount(ctx->frameStats.counts[CountChains], 1);
 			it->visited = true;
 
-			//search down
+			//search down, over the rows with strips
 			int blankCounter = 0;
-			for (int si = i; si < height; si++)
+			for (int si = i; si < height; si += ctx->rowStep)
 			{
-				Strip* currTop = stripBuffer[stripBuffer.size() - 1];
+				Strip* currTop = stripBuffer[stripBufferSize - 1];
 
 				//search strip
-				bool stripFound = false;
-				for (vector<Strip>::iterator sIt = strips[si].begin(); sIt != strips[si].end(); ++sIt)
+				Strip* next = linkStrip(ctx, si, currTop);
+				if (next != NULL)
 				{
-					if (sIt->visited)
-					{
-						continue;
-					}
-
-					if (sIt->rightCol > currTop->leftCol && sIt->leftCol < currTop->rightCol)	//overlap!
-					{
-						stripBuffer.push_back(&(*sIt));
-						sIt->visited = true;
-						stripFound = true;
-						break;
-					}
+					stripBuffer[stripBufferSize++] = next;
+					next->visited = true;
 				}
-
-				if (!stripFound) //blank
+				else //blank
 				{
-					blankCounter++;
-					if (blankCounter > STRIP_MAX_BLANK_PIXEL)
+					blankCounter += ctx->rowStep;
+					if (blankCounter > ctx->maxBlankPixel)
 					{
 						//Too much blank, give up
 						break;
@@ -376,23 +418,38 @@ int findFingers(proc_para_depth, double fingerLengthMin, double fingerLengthMax,
 			//check length
 			Strip* first = stripBuffer[0];
 			int firstMidCol = (first->leftCol + first->rightCol) / 2;
-			Strip* last = stripBuffer[stripBuffer.size() - 1];
+			Strip* last = stripBuffer[stripBufferSize - 1];
 			int lastMidCol = (last->leftCol + last->rightCol) / 2;
 			int depth = *srcDepth((first->row + last->row) / 2, (firstMidCol + lastMidCol) / 2);	//jst a try
-			double lengthSquared = distSquaredInRealWorld(
+			double lengthSquared = cameraDistSquared(&ctx->camera, 
 				firstMidCol, first->row, depth, // *srcDepth(first->row, firstMidCol),
-				lastMidCol, last->row, depth, //*srcDepth(last->row, lastMidCol),
-				width, height
+				lastMidCol, last->row, depth //*srcDepth(last->row, lastMidCol)
 				);
 			int pixelLength = last->row - first->row +1;
 			
-			if (pixelLength >= FINGER_MIN_PIXEL_LENGTH 
+			if (pixelLength >= ctx->minPixelLength 
 				&& lengthSquared >= fingerLengthMin * fingerLengthMin 
-				&& lengthSquared <= fingerLengthMax * fingerLengthMax)	//finger!
+				&& lengthSquared <= fingerLengthMax * fingerLengthMax
+				&& fingerNum < ctx->maxFingerCandidates)	//finger!
 			{
+				Finger finger(firstMidCol, first->row, depth, lastMidCol, last->row, depth);	//TODO: depth?
+				if ((ctx->outputFlags & OutputOverlay) && ctx->fingerPointNum + stripBufferSize <= ctx->maxFingerPoints)
+				{
+					finger.pointBegin = ctx->fingerPointNum;
+					finger.pointNum = stripBufferSize;
+					for (int k = 0; k < stripBufferSize; k++)
+					{
+						ctx->fingerPoints[2 * ctx->fingerPointNum] = (stripBuffer[k]->leftCol + stripBuffer[k]->rightCol) / 2;
+						ctx->fingerPoints[2 * ctx->fingerPointNum + 1] = stripBuffer[k]->row;
+						ctx->fingerPointNum++;
+					}
+				}
+				fingers[fingerNum++] = finger;
+				stageCount(ctx->frameStats.counts[CountFingers], 1);
+
 				//fill back
 				int bufferPos = -1;
-				for (int row = first->row; row <= last->row; row++)
+				for (int row = first->row; row <= last->row && (ctx->outputFlags & OutputImage); row++)
 				{
 					int leftCol, rightCol;
 					if (row == stripBuffer[bufferPos + 1]->row)	//find next detected row
@@ -410,35 +467,44 @@ int findFingers(proc_para_depth, double fingerLengthMin, double fingerLengthMax,
 
 					for (int col = leftCol; col <= rightCol; col++)
 					{
-						bufferPixel(tmpPixelBuffer, row, col)[0] = 255;
-						//bufferPixel(tmpPixelBuffer, row, col)[1] = 255;
-						bufferPixel(tmpPixelBuffer, row, col)[2] = 255;
+						bufferPixel(ctx->tmpPixelBuffer, row, col)[0] = 255;
+						//bufferPixel(ctx->tmpPixelBuffer, row, col)[1] = 255;
+						bufferPixel(ctx->tmpPixelBuffer, row, col)[2] = 255;
 					}
 				}
-
-				fingers.push_back(Finger(firstMidCol, first->row, depth, lastMidCol, last->row, depth));	//TODO: depth?
 			}
 		}
 	}
 
-	sort(fingers.begin(), fingers.end());
+	sort(fingers, fingers + fingerNum);
 	int i;
-	for (i = 0; i < maxFingers && i < fingers.size(); i++)
+	Roi box = { width, height, 0, 0 };	//the reported fingers, for the tracking mode
+	for (i = 0; i < maxFingers && i < fingerNum; i++)
 	{
 		resultPtr[2 * i] = fingers[i].tipX;
 		resultPtr[2 * i + 1] = fingers[i].tipY;
+		extendBox(box, fingers[i].tipX, fingers[i].tipY);
+		extendBox(box, fingers[i].endX, fingers[i].endY);
+		if (i < OVERLAY_MAX_FINGERS)
+		{
+			ctx->polylineBegin[i] = fingers[i].pointBegin;
+			ctx->polylineNum[i] = fingers[i].pointNum;
+		}
 	}
+	ctx->polylineFingerNum = min(i, OVERLAY_MAX_FINGERS);
+	stageCount(ctx->frameStats.counts[CountReported], i);
 	
+	ctx->candidateBox = box;
+
 	//hand hint	TODO: if tip and end are not in the same depth
-	if(fingers.size() > 0)
+	if(fingerNum > 0)
 	{
-		double rx1, ry1, rx2, ry2;
-		convertProjectiveToRealWorld(fingers[0].tipX, fingers[0].tipY, fingers[0].tipZ, rx1, ry1, width, height);
-		convertProjectiveToRealWorld(fingers[0].endX, fingers[0].endY, fingers[0].endZ, rx2, ry2, width, height);
+		double rx1 = cameraRealX(&ctx->camera, fingers[0].tipX, fingers[0].tipZ), ry1 = cameraRealY(&ctx->camera, fingers[0].tipY, fingers[0].tipZ);
+		double rx2 = cameraRealX(&ctx->camera, fingers[0].endX, fingers[0].endZ), ry2 = cameraRealY(&ctx->camera, fingers[0].endY, fingers[0].endZ);
 		double scale = FINGER_TO_HAND_OFFSET / sqrt((rx2 - rx1) * (rx2 - rx1) + (ry2 - ry1) * (ry2 - ry1));
 
-		/*double rx = fingers[0].tipZ * realWorldXToZ;
-		double ry = fingers[0].tipZ * realWorldYToZ;
+		/*double rx = fingers[0].tipZ * ctx->realWorldXToZ;
+		double ry = fingers[0].tipZ * ctx->realWorldYToZ;
 		double dx = fingers[0].endX - fingers[0].tipX;
 		double dy = fingers[0].endY - fingers[0].tipY;
 		double scale = FINGER_TO_HAND_OFFSET / sqrt(rx * rx * dx * dx + ry * ry * dy * dy);
@@ -450,71 +516,854 @@ int findFingers(proc_para_depth, double fingerLengthMin, double fingerLengthMax,
 
 		handHint[2] = fingers[0].tipZ;
 		handHint[3] = fingers[0].endY - fingers[0].tipY + 1;
+
+		if (handHint[2] > 0)
+		{
+			int hx, hy;
+			cameraRealWorldToProjective(&ctx->camera, handHint[0], handHint[1], handHint[2], hx, hy);
+			extendBox(box, max(0, min(width - 1, hx)), max(0, min(height - 1, hy)));
+		}
 	}
+	ctx->fingerBox = box;
 
 	return i;
 }
 
-proc_m derivativeFingerDetectorInit(proc_para_depth, int deviceMaxDepth, double realWorldXToZArg, double realWorldYToZArg)
+static void detectBandTask(void* arg, int band)
+{
+	FrameJob* job = (FrameJob*)arg;
+	DetectorContext* ctx = job->ctx;
+	int rowBegin, rowEnd;
+	bandRows(ctx, band, job->roi.top, job->roi.bottom, rowBegin, rowEnd);
+
+	if (ctx->outputFlags & OutputImage)
+	{
+		memset(ctx->tmpPixelBuffer + rowBegin * job->pixelStride, 0, (rowEnd - rowBegin) * job->pixelStride);
+	}
+	int* scratch = ctx->sobelScratch + band * sobelScratchSize(job->width);
+	if (job->materialize)
+	{
+		stageTime(sobelStart);
+		sobelRows(ctx->simdLevel, job->srcDepthPtr, job->width, job->height, job->depthStride, ctx->deviceMaxDepth, rowBegin, rowEnd, 
+			ctx->hDerivativeRes, ctx->vDerivativeRes, scratch);
+		stageAdd(ctx->bandNanos[2 * band], sobelStart);
+
+		stageTime(stripsStart);
+		for (int i = rowBegin; i < rowEnd; i++)
+		{
+			findSpanStrips(job, ctx->hDerivativeRes + i * job->depthStride, i);
+		}
+		stageAdd(ctx->bandNanos[2 * band + 1], stripsStart);
+		return;
+	}
+
+	//streaming: the row goes through the strip state machine right after sobel, while it is still in L1. Timing the two
+	//per row would cost more than they take, so both count as StageStrips.
+	stageTime(stripsStart);
+	int* hRow = ctx->streamRows + band * job->width;
+	SobelStream stream;
+	sobelStreamBegin(&stream, ctx->simdLevel, job->srcDepthPtr, job->width, job->height, job->depthStride, ctx->deviceMaxDepth, rowBegin, scratch);
+	for (int i = rowBegin; i < rowEnd; i++)
+	{
+		if (i % ctx->rowStep != 0)
+		{
+			sobelStreamSkipRow(&stream);
+			ctx->stripNum[i] = 0;
+			continue;
+		}
+		sobelStreamRow(&stream, hRow, NULL);
+		findSpanStrips(job, hRow, i);
+	}
+	stageAdd(ctx->bandNanos[2 * band + 1], stripsStart);
+}
+
+#ifndef NO_STAGE_STATS
+static void beginFrameStats(DetectorContext* ctx)
 {
-	hDerivativeRes = new int[depthStride * height];
-	vDerivativeRes = new int[depthStride * height];
-	tmpPixelBuffer = new byte[pixelStride * height * 3];
+	int frame = ctx->frameStats.frame + 1;
+	memset(&ctx->frameStats, 0, sizeof(FrameStats));
+	ctx->frameStats.frame = frame;
+	memset(ctx->bandNanos, 0, 2 * ctx->bandNum * sizeof(int));
+}
 
-	maxHistogramSize = deviceMaxDepth * 48 * 2;
-	histogram = new int[maxHistogramSize];	//allocate enough memory
+//adds up the bands and the strips, then publishes the frame for derivativeFingerDetectorGetStageStats
+static void publishFrameStats(DetectorContext* ctx, long long frameStart)
+{
+	FrameStats* stats = &ctx->frameStats;
+	for (int band = 0; band < ctx->bandNum; band++)
+	{
+		stats->nanos[StageSobel] += ctx->bandNanos[2 * band];
+		stats->nanos[StageStrips] += ctx->bandNanos[2 * band + 1];
+	}
+	for (int i = 0; i < ctx->height; i++)
+	{
+		stats->counts[CountStrips] += ctx->stripNum[i];
+	}
+	stats->frameMode = ctx->frameMode;
+	stats->quality = ctx->frameQuality;
+	stats->nanos[StageFrame] = (int)(stageClock() - frameStart);
 
-	realWorldXToZ = realWorldXToZArg;
-	realWorldYToZ = realWorldYToZArg;
-	::deviceMaxDepth = deviceMaxDepth;
+	stageStatsPublish(&ctx->stageStats, stats);
+}
+#endif
 
-	return 0;
+//threadNum: number of threads working on a frame, including the calling one. Results don't depend on it.
+static void carveContext(DetectorContext* ctx, Arena* arena)
+{
+	ctx->hDerivativeRes = arenaNew(arena, int, ctx->depthStride * ctx->height);
+	ctx->vDerivativeRes = arenaNew(arena, int, ctx->depthStride * ctx->height);
+	carveHistogram(&ctx->histogram, arena);
+	ctx->tmpPixelBuffer = arenaNew(arena, byte, ctx->pixelStride * ctx->height);
+	ctx->sobelScratch = arenaNew(arena, int, sobelScratchSize(ctx->width) * ctx->bandNum);
+	ctx->streamRows = arenaNew(arena, int, ctx->width * ctx->bandNum);
+	ctx->bandMin = arenaNew(arena, int, ctx->bandNum);
+	ctx->bandMax = arenaNew(arena, int, ctx->bandNum);
+	ctx->strips = arenaNew(arena, Strip, ctx->stripCapacity * ctx->height);
+	ctx->stripNum = arenaNew(arena, int, ctx->height);
+	ctx->fingerPoints = arenaNew(arena, int, 2 * ctx->maxFingerPoints);
+	ctx->polylineBegin = arenaNew(arena, int, OVERLAY_MAX_FINGERS);
+	ctx->polylineNum = arenaNew(arena, int, OVERLAY_MAX_FINGERS);
+	ctx->chain = arenaNew(arena, Strip*, ctx->height + 1);
+	ctx->fingerCandidates = arenaNew(arena, Finger, ctx->maxFingerCandidates);
+	carveCameraModel(&ctx->camera, arena);
+#ifndef NO_STAGE_STATS
+	ctx->bandNanos = arenaNew(arena, int, 2 * ctx->bandNum);
+#endif
 }
 
-proc_m derivativeFingerDetectorDispose()
+//sharedPool: the thread pool of the full resolution detector when creating its coarse level, NULL otherwise
+static DetectorContext* createContext(int width, int height, int depthStride, int pixelStride, int deviceMaxDepth, double realWorldXToZ, double realWorldYToZ, int threadNum, ThreadPool* sharedPool)
 {
-	if (hDerivativeRes != NULL)
+	DetectorContext* ctx = new DetectorContext();
+	ctx->width = width;
+	ctx->height = height;
+	ctx->depthStride = depthStride;
+	ctx->pixelStride = pixelStride;
+	ctx->deviceMaxDepth = deviceMaxDepth;
+	ctx->camera.width = width;
+	ctx->camera.height = height;
+	ctx->simdLevel = ctx->camera.simdLevel = simdDetect();
+	ctx->stripCapacity = width / 4 + 1;
+	ctx->maxFingerPoints = ctx->stripCapacity * height;	//every strip once, more only when chains merge
+	ctx->maxFingerCandidates = ctx->maxFingerPoints;
+	ctx->histogramInterval = 1;
+	ctx->framesSinceHistogram = 0;
+	ctx->outputFlags = OutputImage;
+	ctx->fingerPointNum = ctx->polylineFingerNum = 0;
+#ifndef NO_STAGE_STATS
+	stageStatsReset(&ctx->stageStats);
+	memset(&ctx->frameStats, 0, sizeof(FrameStats));
+#endif
+	ctx->stripLinking = StripLinkFirst;
+	ctx->streaming = true;
+	ctx->derivativeRequested = false;
+	ctx->framesSinceDerivative = -1;
+	ctx->minPixelLength = FINGER_MIN_PIXEL_LENGTH;
+	ctx->maxBlankPixel = STRIP_MAX_BLANK_PIXEL;
+	ctx->rowStep = 1;
+	ctx->tracking = false;
+	ctx->fullScanInterval = 30;
+	ctx->roiPadding = 32;
+	ctx->framesSinceFullScan = 0;
+	ctx->roiValid = false;
+	ctx->frameMode = FrameFull;
+	Roi fullFrame = { 0, 0, width, height };
+	ctx->roi = ctx->fingerBox = ctx->candidateBox = fullFrame;
+	ctx->pyramidLevel = 0;
+	ctx->refinePadding = 16;
+	ctx->coarse = NULL;
+	ctx->pyramid = NULL;
+	ctx->refineBoxes = NULL;
+	ctx->refineBoxNum = 0;
+	ctx->pyramidArena = NULL;
+	ctx->deadlineNanos = 0;
+	ctx->maxQuality = ctx->quality = ctx->frameQuality = QualityFull;
+	ctx->qualityNanos = 0;
+	ctx->framesAtQuality = 0;
+	ctx->qualityHold = QUALITY_HOLD_FRAMES;
+	ctx->qualityRestored = false;
+	ctx->degraded = NULL;
+	ctx->degradedDepth = NULL;
+	ctx->degradedArena = NULL;
+
+	ctx->ownsThreadPool = sharedPool == NULL;
+	ctx->threadPool = sharedPool != NULL ? sharedPool : threadPoolCreate(threadNum);
+	ctx->bandNum = threadPoolSize(ctx->threadPool);
+	if (ctx->bandNum > height)
 	{
-		delete [] hDerivativeRes;
+		ctx->bandNum = height;
 	}
+	//the derivative spans deviceMaxDepth * 48 * 2 values at most, only the edges of the holes get far from 0
+	histogramInit(&ctx->histogram, ctx->simdLevel, deviceMaxDepth * 48 * 2, OUTPUT_HISTOGRAM_SUB_BINS, (height / ctx->bandNum + 1) * width / OUTPUT_HISTOGRAM_TAIL_SHARE, ctx->bandNum);
 
-	if (vDerivativeRes != NULL)
+	Arena arena = { NULL, 0 };
+	carveContext(ctx, &arena);	//measure
+	ctx->arena = arenaAllocate(&arena);
+	if (ctx->arena == NULL)
 	{
-		delete [] vDerivativeRes;
+		if (ctx->ownsThreadPool) threadPoolDestroy(ctx->threadPool);
+		delete ctx;
+		return NULL;
 	}
+	carveContext(ctx, &arena);
+	//realWorldXToZ / YToZ: real world width / height of the frame at a depth of 1, the camera looks at the frame centre
+	cameraModelSetIntrinsics(&ctx->camera, width / realWorldXToZ, height / realWorldYToZ, width * 0.5, height * 0.5);
+
+	return ctx;
+}
 
-	if (histogram != NULL)
+//create an independent detector for frames of the given size. threadNum: number of threads working on a frame, 
+//including the calling one; results don't depend on it. Returns NULL when out of memory.
+DLL_EXPORT void* derivativeFingerDetectorCreate(int width, int height, int depthStride, int pixelStride, int deviceMaxDepth, double realWorldXToZ, double realWorldYToZ, int threadNum)
+{
+	return createContext(width, height, depthStride, pixelStride, deviceMaxDepth, realWorldXToZ, realWorldYToZ, threadNum, NULL);
+}
+
+proc_m derivativeFingerDetectorDestroy(void* context)
+{
+	DetectorContext* ctx = (DetectorContext*)context;
+	if (ctx == NULL)
 	{
-		delete [] histogram;
+		return 0;
 	}
 
-	if (tmpPixelBuffer != NULL)
+	derivativeFingerDetectorDestroy(ctx->coarse);
+	arenaFree(ctx->pyramidArena);
+	derivativeFingerDetectorDestroy(ctx->degraded);
+	arenaFree(ctx->degradedArena);
+	if (ctx->ownsThreadPool)
 	{
-		delete [] tmpPixelBuffer;
+		threadPoolDestroy(ctx->threadPool);
 	}
+	arenaFree(ctx->arena);
+	delete ctx;
 
 	return 0;
 }
 
-proc_m derivativeFingerDetectorWork(proc_para_depth, double fingerWidthMin, double fingerWidthMax, double fingerLengthMin, double fingerLengthMax, int maxFingers, int* resultPtr, int* handHint)
+static bool boxesOverlap(const Roi& a, const Roi& b)
+{
+	return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+}
+
+//runs the coarse level of the pyramid and fills ctx->refineBoxes with a box per coarse finger, from its tip to its end
+//at full resolution grown by refinePadding. Boxes that overlap are merged, so two hands far apart are refined in two
+//boxes and the table between them is skipped. Returns the box around all of them, empty without any.
+static Roi coarseCandidates(DetectorContext* ctx, ushort* srcDepthPtr, double fingerWidthMin, double fingerWidthMax, double fingerLengthMin, double fingerLengthMax)
+{
+	int width = ctx->width, height = ctx->height, depthStride = ctx->depthStride;
+	ushort* level = ctx->pyramid;
+	for (int l = 0; l < ctx->pyramidLevel; l++)
+	{
+		downsampleDepth(ctx->simdLevel, srcDepthPtr, width, height, depthStride, level, width / 2);
+		srcDepthPtr = level;
+		width /= 2;
+		height /= 2;
+		depthStride = width;
+		level += width * height;
+	}
+
+	//the limits are in millimeters and the projection is normalized by the frame size, so they hold at any level
+	DetectorContext* coarse = ctx->coarse;
+	coarse->stripLinking = ctx->stripLinking;
+	int candidates[2 * PYRAMID_MAX_CANDIDATES], handHint[4];
+	int candidateNum = derivativeFingerDetectorContextWorkEx(coarse, srcDepthPtr, NULL, fingerWidthMin, fingerWidthMax, fingerLengthMin, fingerLengthMax,
+															 PYRAMID_MAX_CANDIDATES, candidates, handHint, OutputNone);
+
+	//the reported fingers are the first ones of fingerCandidates
+	Roi* boxes = ctx->refineBoxes;
+	int boxNum = 0, shift = ctx->pyramidLevel, padding = ctx->refinePadding;
+	for (int k = 0; k < candidateNum; k++)
+	{
+		const Finger* finger = &coarse->fingerCandidates[k];
+		Roi box = { min(finger->tipX, finger->endX), min(finger->tipY, finger->endY), max(finger->tipX, finger->endX) + 1, max(finger->tipY, finger->endY) + 1 };
+		box.left = max(0, (box.left << shift) - padding);
+		box.top = max(0, (box.top << shift) - padding);
+		box.right = min(ctx->width, (box.right << shift) + padding);
+		box.bottom = min(ctx->height, (box.bottom << shift) + padding);
+
+		//a merged box may overlap boxes it didn't before, so it goes through the others again
+		for (int m = 0; m < boxNum; m++)
+		{
+			if (boxesOverlap(box, boxes[m]))
+			{
+				box.left = min(box.left, boxes[m].left);
+				box.top = min(box.top, boxes[m].top);
+				box.right = max(box.right, boxes[m].right);
+				box.bottom = max(box.bottom, boxes[m].bottom);
+				boxes[m] = boxes[--boxNum];
+				m = -1;
+			}
+		}
+		boxes[boxNum++] = box;
+	}
+
+	Roi all = { 0, 0, 0, 0 };
+	for (int k = 0; k < boxNum; k++)
+	{
+		Roi box = boxes[k];
+		int p = k;
+		for (; p > 0 && boxes[p - 1].left > box.left; p--)
+		{
+			boxes[p] = boxes[p - 1];
+		}
+		boxes[p] = box;
+
+		if (k == 0)
+		{
+			all = box;
+		}
+		all.left = min(all.left, box.left);
+		all.top = min(all.top, box.top);
+		all.right = max(all.right, box.right);
+		all.bottom = max(all.bottom, box.bottom);
+	}
+	ctx->refineBoxNum = boxNum;
+	return all;
+}
+
+//QualityCoarse: the frame downsampled once goes through the half resolution detector and its fingers are scaled back.
+//No strips at full resolution, no derivative frame, nothing drawn.
+static int detectDegraded(DetectorContext* ctx, ushort* srcDepthPtr, double fingerWidthMin, double fingerWidthMax, double fingerLengthMin, double fingerLengthMax,
+						  int maxFingers, int* resultPtr, int* handHint)
+{
+	int width = ctx->width, height = ctx->height;
+	DetectorContext* degraded = ctx->degraded;
+	degraded->stripLinking = ctx->stripLinking;
+	downsampleDepth(ctx->simdLevel, srcDepthPtr, width, height, ctx->depthStride, ctx->degradedDepth, degraded->width);
+	int fingerNum = derivativeFingerDetectorContextWorkEx(degraded, ctx->degradedDepth, NULL, fingerWidthMin, fingerWidthMax, fingerLengthMin, fingerLengthMax,
+														  maxFingers, resultPtr, handHint, OutputNone);
+	for (int i = 0; i < 2 * fingerNum; i++)
+	{
+		resultPtr[i] <<= 1;
+	}
+	if (fingerNum > 0)
+	{
+		handHint[3] <<= 1;	//rows of the first finger, the real world position needs nothing
+	}
+
+	//the boxes at full resolution, so tracking goes on from them
+	Roi boxes[2] = { degraded->fingerBox, degraded->candidateBox };
+	for (int k = 0; k < 2; k++)
+	{
+		boxes[k].left <<= 1;
+		boxes[k].top <<= 1;
+		boxes[k].right = min(width, boxes[k].right << 1);
+		boxes[k].bottom = min(height, boxes[k].bottom << 1);
+	}
+	ctx->fingerBox = boxes[0];
+	ctx->candidateBox = boxes[1];
+
+	Roi fullFrame = { 0, 0, width, height };
+	ctx->roi = fullFrame;
+	ctx->frameMode = FrameFull;
+	ctx->framesSinceFullScan = 0;
+	ctx->roiValid = fingerNum > 0;
+	ctx->framesSinceDerivative = ctx->framesSinceDerivative < 0 ? -1 : ctx->framesSinceDerivative + 1;
+	ctx->polylineFingerNum = 0;
+	memset(ctx->stripNum, 0, height * sizeof(int));
+	return fingerNum;
+}
+
+//after every frame with a deadline: a level whose average frame time is past the deadline drops to the next one, a
+//level well within it tries the better one after qualityHold frames. A try that fails right away doubles the hold,
+//so a box that can't keep a level doesn't go on missing the deadline every QUALITY_HOLD_FRAMES frames.
+static void scheduleQuality(DetectorContext* ctx, long long frameNanos)
+{
+	ctx->qualityNanos = ctx->qualityNanos == 0 ? frameNanos : ctx->qualityNanos + (frameNanos - ctx->qualityNanos) / QUALITY_AVERAGE_WEIGHT;
+	ctx->framesAtQuality++;
+	if (ctx->qualityRestored && ctx->framesAtQuality >= QUALITY_HOLD_FRAMES)
+	{
+		ctx->qualityRestored = false;
+		ctx->qualityHold = QUALITY_HOLD_FRAMES;
+	}
+
+	int quality = ctx->quality;
+	if (ctx->qualityNanos > ctx->deadlineNanos && quality < ctx->maxQuality)
+	{
+		if (ctx->qualityRestored)
+		{
+			ctx->qualityHold = min(2 * ctx->qualityHold, QUALITY_MAX_HOLD_FRAMES);
+		}
+		ctx->qualityRestored = false;
+		quality++;
+	}
+	else if (quality > QualityFull && ctx->framesAtQuality >= ctx->qualityHold && ctx->qualityNanos < ctx->deadlineNanos * QUALITY_RESTORE_SHARE)
+	{
+		ctx->qualityRestored = true;
+		quality--;
+	}
+
+	if (quality != ctx->quality)
+	{
+		ctx->quality = quality;
+		ctx->qualityNanos = 0;
+		ctx->framesAtQuality = 0;
+	}
+}
+
+static void endFrame(DetectorContext* ctx, int quality, long long frameStart)
 {
-	memset(tmpPixelBuffer, 0, pixelStride * height * 3);
+	ctx->frameQuality = quality;
+	if (ctx->deadlineNanos > 0)
+	{
+		scheduleQuality(ctx, stageClock() - frameStart);
+	}
+#ifndef NO_STAGE_STATS
+	publishFrameStats(ctx, frameStart);
+#endif
+}
+
+//outputFlags: FrameOutput. Without OutputImage dstPixelPtr isn't touched and may be NULL, and nothing is drawn at all.
+//With a deadline (derivativeFingerDetectorSetDeadline) the frame may drop OutputImage, see the quality it ran at.
+proc_m derivativeFingerDetectorContextWorkEx(void* context, ushort* srcDepthPtr, byte* dstPixelPtr, double fingerWidthMin, double fingerWidthMax, double fingerLengthMin, double fingerLengthMax, int maxFingers, int* resultPtr, int* handHint, int outputFlags)
+{
+	DetectorContext* ctx = (DetectorContext*)context;
+	int width = ctx->width, height = ctx->height, depthStride = ctx->depthStride, pixelStride = ctx->pixelStride;
+	long long frameStart = stageClock();	//the scheduler needs it without the stage stats too
+#ifndef NO_STAGE_STATS
+	beginFrameStats(ctx);
+#endif
+	int quality = ctx->deadlineNanos > 0 ? ctx->quality : QualityFull;
+	if (quality >= QualityNoImage)
+	{
+		outputFlags &= ~OutputImage;
+	}
+	ctx->outputFlags = outputFlags;
+	ctx->rowStep = quality >= QualityHalfRows ? 2 : 1;
+	ctx->fingerPointNum = 0;
+
+	if (quality >= QualityCoarse)
+	{
+		int fingerNum = detectDegraded(ctx, srcDepthPtr, fingerWidthMin, fingerWidthMax, fingerLengthMin, fingerLengthMax, maxFingers, resultPtr, handHint);
+		endFrame(ctx, quality, frameStart);
+		return fingerNum;
+	}
 
-	sobel(srcDepthPtr, NULL, width, height, depthStride, pixelStride);
+	//tracking: only the padded box of the last fingers, unless a full scan is due
+	bool roiFrame = ctx->tracking && ctx->roiValid && ctx->framesSinceFullScan + 1 < ctx->fullScanInterval;
+	bool pyramidFrame = !roiFrame && ctx->coarse != NULL;	//a full scan, through the coarse level
+	Roi roi = { 0, 0, width, height };
+	const Roi* boxes = &roi;	//the frame is processed in these, rows in none of them are skipped
+	int boxNum = 1;
+	if (roiFrame)
+	{
+		roi.left = max(0, ctx->fingerBox.left - ctx->roiPadding);
+		roi.top = max(0, ctx->fingerBox.top - ctx->roiPadding);
+		roi.right = min(width, ctx->fingerBox.right + ctx->roiPadding);
+		roi.bottom = min(height, ctx->fingerBox.bottom + ctx->roiPadding);
+	}
+	else if (pyramidFrame)
+	{
+		roi = coarseCandidates(ctx, srcDepthPtr, fingerWidthMin, fingerWidthMax, fingerLengthMin, fingerLengthMax);
+		boxes = ctx->refineBoxes;
+		boxNum = ctx->refineBoxNum;
+	}
+
+	//the debug image reads the derivative frame back, so does a debug capture
+	bool materialize = !ctx->streaming || (outputFlags & OutputImage) || ctx->derivativeRequested;
+
+	//sobel and findStrips by bands, see FrameJob. The rows are cut at the top and the bottom of every box: a slice in
+	//some boxes goes through the bands with their columns as the spans, a slice in none has no derivative, no strips
+	//and nothing to draw.
+	FrameJob job = { ctx, srcDepthPtr, dstPixelPtr, width, height, depthStride, pixelStride, fingerWidthMin, fingerWidthMax, roi, materialize, NULL, 0 };
+	int spans[2 * PYRAMID_MAX_CANDIDATES];
+	for (int row = 0; row < height; )
+	{
+		int next = height, spanNum = 0;
+		for (int k = 0; k < boxNum; k++)
+		{
+			if (boxes[k].top > row)
+			{
+				next = min(next, boxes[k].top);
+			}
+			else if (boxes[k].bottom > row)
+			{
+				next = min(next, boxes[k].bottom);
+				spans[2 * spanNum] = boxes[k].left;
+				spans[2 * spanNum + 1] = boxes[k].right;
+				spanNum++;
+			}
+		}
+
+		if (spanNum > 0)
+		{
+			Roi slice = { spans[0], row, spans[2 * spanNum - 1], next };
+			job.roi = slice;
+			job.spans = spans;
+			job.spanNum = spanNum;
+			threadPoolRun(ctx->threadPool, detectBandTask, &job, ctx->bandNum);
+		}
+		else
+		{
+			int rowNum = next - row;
+			if (materialize)
+			{
+				memset(ctx->hDerivativeRes + row * depthStride, 0, rowNum * depthStride * sizeof(int));
+				memset(ctx->vDerivativeRes + row * depthStride, 0, rowNum * depthStride * sizeof(int));
+			}
+			if (outputFlags & OutputImage)
+			{
+				memset(ctx->tmpPixelBuffer + row * pixelStride, 0, rowNum * pixelStride);
+			}
+			memset(ctx->stripNum + row, 0, rowNum * sizeof(int));
+		}
+		row = next;
+	}
 	//sobelLinear(srcDepthPtr, NULL, width, height, depthStride, pixelStride);
 
-	vector<vector<Strip> > strips;
-	findStrips(srcDepthPtr, dstPixelPtr, width, height, depthStride, pixelStride, fingerWidthMin, fingerWidthMax, strips);
-	int fingerNum = findFingers(srcDepthPtr, dstPixelPtr, width, height, depthStride, pixelStride, fingerLengthMin, fingerLengthMax, strips, maxFingers, resultPtr, handHint);
-	generateOutputImage(srcDepthPtr, dstPixelPtr, width, height, depthStride, pixelStride);
+	stageTime(fingersStart);
+	int fingerNum = findFingers(ctx, srcDepthPtr, dstPixelPtr, width, height, depthStride, pixelStride, fingerLengthMin, fingerLengthMax, maxFingers, resultPtr, handHint);
+	stageAdd(ctx->frameStats.nanos[StageFingers], fingersStart);
+
+	if (outputFlags & OutputImage)
+	{
+		stageTime(outputStart);
+		generateOutputImage(ctx, srcDepthPtr, dstPixelPtr, width, height, depthStride, pixelStride);
+		stageAdd(ctx->frameStats.nanos[StageOutput], outputStart);
+	}
+
+	ctx->frameMode = roiFrame ? FrameRoi : (pyramidFrame ? FramePyramid : FrameFull);
+	ctx->roi = roi;
+	ctx->framesSinceFullScan = roiFrame ? ctx->framesSinceFullScan + 1 : 0;
+	ctx->roiValid = fingerNum > 0;	//lost: the next frame is a full scan
+	ctx->framesSinceDerivative = materialize ? 0 : (ctx->framesSinceDerivative < 0 ? -1 : ctx->framesSinceDerivative + 1);
+	ctx->derivativeRequested = ctx->derivativeRequested && !materialize;
 
+	endFrame(ctx, quality, frameStart);
 	return fingerNum;
 }
 
-proc_m derivativeFingerDetectorGetDerivativeFrame(int** hResPtr, int** vResPtr)	//not robust, just for debugging
+proc_m derivativeFingerDetectorContextWork(void* context, ushort* srcDepthPtr, byte* dstPixelPtr, double fingerWidthMin, double fingerWidthMax, double fingerLengthMin, double fingerLengthMax, int maxFingers, int* resultPtr, int* handHint)
 {
-	*hResPtr = hDerivativeRes;
-	*vResPtr = vDerivativeRes;
+	return derivativeFingerDetectorContextWorkEx(context, srcDepthPtr, dstPixelPtr, fingerWidthMin, fingerWidthMax, fingerLengthMin, fingerLengthMax, maxFingers, resultPtr, handHint, OutputImage);
+}
+
+//the histogram equalization of the output image is rebuilt every histogramInterval frames drawn, 1 (the default) for every frame
+proc_m derivativeFingerDetectorSetVisualization(void* context, int histogramInterval)
+{
+	DetectorContext* ctx = (DetectorContext*)context;
+	if (histogramInterval < 1)
+	{
+		return -1;
+	}
 
+	ctx->histogramInterval = histogramInterval;
 	return 0;
 }
+
+//strip spans of the last frame as (row, leftCol, rightCol) triplets, top to bottom. Returns the number written, at most maxSpans.
+//The strips are found anyway, so this costs nothing unless called.
+proc_m derivativeFingerDetectorGetStrips(void* context, int* spanPtr, int maxSpans)
+{
+	DetectorContext* ctx = (DetectorContext*)context;
+	int spanNum = 0;
+	for (int i = 0; i < ctx->height; i++)
+	{
+		const Strip* rowStrips = ctx->strips + i * ctx->stripCapacity;
+		for (int k = 0; k < ctx->stripNum[i] && spanNum < maxSpans; k++, spanNum++)
+		{
+			spanPtr[3 * spanNum] = i;
+			spanPtr[3 * spanNum + 1] = rowStrips[k].leftCol;
+			spanPtr[3 * spanNum + 2] = rowStrips[k].rightCol;
+		}
+	}
+	return spanNum;
+}
+
+//polylines of the fingers reported by the last frame (OutputOverlay), in the same order: the middle points (x, y) of their
+//strips from tip to end. pointNumPtr[k] receives the point count of finger k and pointPtr the points one finger after
+//another; a finger that doesn't fit in maxPoints gets 0 points. Returns the number of fingers written.
+proc_m derivativeFingerDetectorGetFingerPolylines(void* context, int* pointPtr, int maxPoints, int* pointNumPtr, int maxFingers)
+{
+	DetectorContext* ctx = (DetectorContext*)context;
+	int fingerNum = min(maxFingers, ctx->polylineFingerNum);
+	int pointNum = 0;
+	for (int k = 0; k < fingerNum; k++)
+	{
+		int count = ctx->polylineNum[k];
+		if (pointNum + count > maxPoints)
+		{
+			count = 0;
+		}
+
+		memcpy(pointPtr + 2 * pointNum, ctx->fingerPoints + 2 * ctx->polylineBegin[k], 2 * count * sizeof(int));
+		pointNumPtr[k] = count;
+		pointNum += count;
+	}
+	return fingerNum;
+}
+
+//tracking mode: after a frame with fingers, only their bounding box (with the hand hint) grown by padding pixels goes
+//through sobel, findStrips and findFingers. The whole frame is scanned every fullScanInterval frames and whenever no
+//finger was found. Off by default.
+proc_m derivativeFingerDetectorSetTracking(void* context, int enabled, int fullScanInterval, int padding)
+{
+	DetectorContext* ctx = (DetectorContext*)context;
+	if (fullScanInterval < 1 || padding < 0)
+	{
+		return -1;
+	}
+
+	ctx->tracking = enabled != 0;
+	ctx->fullScanInterval = fullScanInterval;
+	ctx->roiPadding = padding;
+	ctx->roiValid = false;
+	return 0;
+}
+
+static void carvePyramid(DetectorContext* ctx, Arena* arena)
+{
+	int size = 0;
+	for (int l = 1; l <= ctx->pyramidLevel; l++)
+	{
+		size += (ctx->width >> l) * (ctx->height >> l);
+	}
+	ctx->pyramid = arenaNew(arena, ushort, size);
+	ctx->refineBoxes = arenaNew(arena, Roi, PYRAMID_MAX_CANDIDATES);
+}
+
+//a coarse detector sees the same camera through pixels 2^level times as large
+static void scaleCamera(DetectorContext* ctx, DetectorContext* coarse, int level)
+{
+	if (coarse != NULL)
+	{
+		double scale = 1.0 / (1 << level);
+		CameraModel* camera = &ctx->camera;
+		cameraModelSetIntrinsics(&coarse->camera, camera->fx * scale, camera->fy * scale, camera->cx * scale, camera->cy * scale);
+	}
+}
+
+static void setCoarseCamera(DetectorContext* ctx)
+{
+	scaleCamera(ctx, ctx->coarse, ctx->pyramidLevel);
+	scaleCamera(ctx, ctx->degraded, 1);
+}
+
+//a detector for the frame downsampled level times, on the thread pool of ctx. NULL when out of memory.
+static DetectorContext* createCoarseContext(DetectorContext* ctx, int level)
+{
+	int coarseWidth = ctx->width >> level, coarseHeight = ctx->height >> level;
+	DetectorContext* coarse = createContext(coarseWidth, coarseHeight, coarseWidth, coarseWidth * 3, ctx->deviceMaxDepth, 1, 1, 0, ctx->threadPool);
+	if (coarse != NULL)
+	{
+		scaleCamera(ctx, coarse, level);
+
+		//the pixel limits shrink with the resolution
+		coarse->minPixelLength = max(2, FINGER_MIN_PIXEL_LENGTH >> level);
+		coarse->maxBlankPixel = max(1, STRIP_MAX_BLANK_PIXEL >> level);
+	}
+	return coarse;
+}
+
+//pyramid mode: every frame that would scan the whole frame runs the detector on the depth map downsampled level
+//times by 2 first (level 1, 0 turns it off), then only the box around every coarse finger grown by padding pixels
+//goes through the full resolution detector, boxes that overlap as one. Fingers the coarse level misses are lost.
+//Returns -1 on bad arguments or when out of memory.
+proc_m derivativeFingerDetectorSetPyramid(void* context, int level, int padding)
+{
+	DetectorContext* ctx = (DetectorContext*)context;
+	if (level < 0 || level > PYRAMID_MAX_LEVEL || padding < 0 || (ctx->width >> level) < 8 || (ctx->height >> level) < 8)
+	{
+		return -1;
+	}
+
+	derivativeFingerDetectorDestroy(ctx->coarse);
+	arenaFree(ctx->pyramidArena);
+	ctx->coarse = NULL;
+	ctx->pyramidArena = NULL;
+	ctx->pyramidLevel = 0;
+	ctx->refinePadding = padding;
+	if (level == 0)
+	{
+		return 0;
+	}
+
+	ctx->coarse = createCoarseContext(ctx, level);
+	ctx->pyramidLevel = level;
+
+	Arena arena = { NULL, 0 };
+	carvePyramid(ctx, &arena);	//measure
+	ctx->pyramidArena = arenaAllocate(&arena);
+	if (ctx->coarse == NULL || ctx->pyramidArena == NULL)
+	{
+		derivativeFingerDetectorSetPyramid(ctx, 0, padding);
+		return -1;
+	}
+	carvePyramid(ctx, &arena);
+	return 0;
+}
+
+static void carveDegraded(DetectorContext* ctx, Arena* arena)
+{
+	ctx->degradedDepth = arenaNew(arena, ushort, (ctx->width >> 1) * (ctx->height >> 1));
+}
+
+//deadline scheduler: while frames take longer than deadlineMillis on average, the following frames drop one
+//QualityLevel after the other, down to maxQuality; when frames are well within the deadline again the better levels
+//come back. The frame time is that of this function, thread pool included. deadlineMillis 0 turns it off, every frame
+//is QualityFull then. derivativeFingerDetectorGetQuality returns the level of the last frame, the stage stats keep it
+//per frame. Returns -1 on bad arguments or when out of memory.
+proc_m derivativeFingerDetectorSetDeadline(void* context, double deadlineMillis, int maxQuality)
+{
+	DetectorContext* ctx = (DetectorContext*)context;
+	if (!(deadlineMillis >= 0) || maxQuality < QualityFull || maxQuality >= QUALITY_NUM)
+	{
+		return -1;
+	}
+
+	if (maxQuality >= QualityCoarse && ctx->degraded == NULL)
+	{
+		if ((ctx->width >> 1) < 8 || (ctx->height >> 1) < 8)
+		{
+			return -1;
+		}
+
+		Arena arena = { NULL, 0 };
+		carveDegraded(ctx, &arena);	//measure
+		ctx->degradedArena = arenaAllocate(&arena);
+		ctx->degraded = createCoarseContext(ctx, 1);
+		if (ctx->degraded == NULL || ctx->degradedArena == NULL)
+		{
+			derivativeFingerDetectorDestroy(ctx->degraded);
+			arenaFree(ctx->degradedArena);
+			ctx->degraded = NULL;
+			ctx->degradedArena = NULL;
+			return -1;
+		}
+		carveDegraded(ctx, &arena);
+	}
+
+	ctx->deadlineNanos = (long long)(deadlineMillis * 1e6);
+	ctx->maxQuality = maxQuality;
+	ctx->quality = QualityFull;
+	ctx->qualityNanos = 0;
+	ctx->framesAtQuality = 0;
+	ctx->qualityHold = QUALITY_HOLD_FRAMES;
+	ctx->qualityRestored = false;
+	return 0;
+}
+
+//QualityLevel of the last frame
+proc_m derivativeFingerDetectorGetQuality(void* context)
+{
+	return ((DetectorContext*)context)->frameQuality;
+}
+
+//replaces the camera of realWorldXToZ / YToZ by a camera model, see cameraModel.h. A model of another resolution is
+//scaled to the frame. The detector keeps tables of its own, the model may be destroyed afterwards.
+proc_m derivativeFingerDetectorSetCamera(void* context, void* camera)
+{
+	DetectorContext* ctx = (DetectorContext*)context;
+	CameraModel* model = (CameraModel*)camera;
+	if (model == NULL)
+	{
+		return -1;
+	}
+
+	double xScale = (double)ctx->width / model->width, yScale = (double)ctx->height / model->height;
+	cameraModelSetIntrinsics(&ctx->camera, model->fx * xScale, model->fy * yScale, model->cx * xScale, model->cy * yScale);
+	setCoarseCamera(ctx);
+	return 0;
+}
+
+//FrameMode of the last frame. roiPtr (optional) receives the region it processed: left, top, right, bottom (exclusive)
+proc_m derivativeFingerDetectorGetFrameMode(void* context, int* roiPtr)
+{
+	DetectorContext* ctx = (DetectorContext*)context;
+	if (roiPtr != NULL)
+	{
+		roiPtr[0] = ctx->roi.left;
+		roiPtr[1] = ctx->roi.top;
+		roiPtr[2] = ctx->roi.right;
+		roiPtr[3] = ctx->roi.bottom;
+	}
+	return ctx->frameMode;
+}
+
+//streaming (the default): frames without OutputImage never write the derivative frames, every band computes a row
+//into a buffer of its own and scans it for strips right away. The results are the same either way.
+proc_m derivativeFingerDetectorSetStreaming(void* context, int enabled)
+{
+	DetectorContext* ctx = (DetectorContext*)context;
+	ctx->streaming = enabled != 0;
+	return 0;
+}
+
+//makes the next frame fill the derivative frames even when streaming, for derivativeFingerDetectorContextGetDerivativeFrame
+proc_m derivativeFingerDetectorRequestDerivativeFrame(void* context)
+{
+	DetectorContext* ctx = (DetectorContext*)context;
+	ctx->derivativeRequested = true;
+	return 0;
+}
+
+//mode: StripLinking, StripLinkFirst by default
+proc_m derivativeFingerDetectorSetLinking(void* context, int mode)
+{
+	DetectorContext* ctx = (DetectorContext*)context;
+	if (mode != StripLinkFirst && mode != StripLinkBestOverlap)
+	{
+		return -1;
+	}
+
+	ctx->stripLinking = mode;
+	return 0;
+}
+
+//timings and counts of the last STAGE_STATS_FRAMES frames, see stageStats.h. Lock free, safe to call from any thread
+//while the detector works. Returns the number of frames in the snapshot, -1 when built with NO_STAGE_STATS.
+proc_m derivativeFingerDetectorGetStageStats(void* context, StageSnapshot* snapshotPtr)
+{
+#ifndef NO_STAGE_STATS
+	DetectorContext* ctx = (DetectorContext*)context;
+	return stageStatsSnapshot(&ctx->stageStats, snapshotPtr);
+#else
+	return -1;
+#endif
+}
+
+//not robust, just for debugging. Returns the number of frames since the derivative frames were last filled (0: by the
+//last frame), -1 when they never were: see derivativeFingerDetectorRequestDerivativeFrame.
+proc_m derivativeFingerDetectorContextGetDerivativeFrame(void* context, int** hResPtr, int** vResPtr)
+{
+	DetectorContext* ctx = (DetectorContext*)context;
+	*hResPtr = ctx->hDerivativeRes;
+	*vResPtr = ctx->vDerivativeRes;
+
+	return ctx->framesSinceDerivative;
+}
+
+//context-less exports, kept for existing callers. They all work on one default context.
+
+proc_m derivativeFingerDetectorInitParallel(proc_para_depth, int deviceMaxDepth, double realWorldXToZArg, double realWorldYToZArg, int threadNum)
+{
+	derivativeFingerDetectorDestroy(defaultContext);
+	defaultContext = (DetectorContext*)derivativeFingerDetectorCreate(width, height, depthStride, pixelStride, deviceMaxDepth, realWorldXToZArg, realWorldYToZArg, threadNum);
+
+	return defaultContext == NULL ? -1 : 0;
+}
+
+proc_m derivativeFingerDetectorInit(proc_para_depth, int deviceMaxDepth, double realWorldXToZArg, double realWorldYToZArg)
+{
+	return derivativeFingerDetectorInitParallel(srcDepthPtr, dstPixelPtr, width, height, depthStride, pixelStride, deviceMaxDepth, realWorldXToZArg, realWorldYToZArg, 1);
+}
+
+proc_m derivativeFingerDetectorDispose()
+{
+	derivativeFingerDetectorDestroy(defaultContext);
+	defaultContext = NULL;
+
+	return 0;
+}
+
+proc_m derivativeFingerDetectorWork(proc_para_depth, double fingerWidthMin, double fingerWidthMax, double fingerLengthMin, double fingerLengthMax, int maxFingers, int* resultPtr, int* handHint)
+{
+	assert(width == defaultContext->width && height == defaultContext->height);
+	return derivativeFingerDetectorContextWork(defaultContext, srcDepthPtr, dstPixelPtr, fingerWidthMin, fingerWidthMax, fingerLengthMin, fingerLengthMax, maxFingers, resultPtr, handHint);
+}
+
+proc_m derivativeFingerDetectorGetDerivativeFrame(int** hResPtr, int** vResPtr)	//not robust, just for debugging
+{
+	return derivativeFingerDetectorContextGetDerivativeFrame(defaultContext, hResPtr, vResPtr);
+}
@@ -0,0 +1,36 @@
+#ifndef _DERIVATIVE_FINGER_DETECTOR_H_
+#define _DERIVATIVE_FINGER_DETECTOR_H_
+
+#include "depth.h"
+#include "stageStats.h"
+
+//exports of derivativeFingerDetector.cpp for native callers, the C# side declares them in ImageProcessorLib.cs.
+//The comments at the definitions describe the parameters.
+
+DLL_EXPORT void* derivativeFingerDetectorCreate(int width, int height, int depthStride, int pixelStride, int deviceMaxDepth, double realWorldXToZ, double realWorldYToZ, int threadNum);
+proc_m derivativeFingerDetectorDestroy(void* context);
+proc_m derivativeFingerDetectorContextWorkEx(void* context, ushort* srcDepthPtr, byte* dstPixelPtr, double fingerWidthMin, double fingerWidthMax, double fingerLengthMin, double fingerLengthMax, int maxFingers, int* resultPtr, int* handHint, int outputFlags);
+proc_m derivativeFingerDetectorContextWork(void* context, ushort* srcDepthPtr, byte* dstPixelPtr, double fingerWidthMin, double fingerWidthMax, double fingerLengthMin, double fingerLengthMax, int maxFingers, int* resultPtr, int* handHint);
+proc_m derivativeFingerDetectorSetVisualization(void* context, int histogramInterval);
+proc_m derivativeFingerDetectorGetStrips(void* context, int* spanPtr, int maxSpans);
+proc_m derivativeFingerDetectorGetFingerPolylines(void* context, int* pointPtr, int maxPoints, int* pointNumPtr, int maxFingers);
+proc_m derivativeFingerDetectorSetTracking(void* context, int enabled, int fullScanInterval, int padding);
+proc_m derivativeFingerDetectorSetPyramid(void* context, int level, int padding);
+proc_m derivativeFingerDetectorSetCamera(void* context, void* camera);
+proc_m derivativeFingerDetectorSetDeadline(void* context, double deadlineMillis, int maxQuality);
+proc_m derivativeFingerDetectorGetQuality(void* context);
+proc_m derivativeFingerDetectorGetFrameMode(void* context, int* roiPtr);
+proc_m derivativeFingerDetectorSetLinking(void* context, int mode);
+proc_m derivativeFingerDetectorSetStreaming(void* context, int enabled);
+proc_m derivativeFingerDetectorRequestDerivativeFrame(void* context);
+proc_m derivativeFingerDetectorGetStageStats(void* context, StageSnapshot* snapshotPtr);
+proc_m derivativeFingerDetectorContextGetDerivativeFrame(void* context, int** hResPtr, int** vResPtr);
+
+//context-less, on one default context
+proc_m derivativeFingerDetectorInitParallel(proc_para_depth, int deviceMaxDepth, double realWorldXToZArg, double realWorldYToZArg, int threadNum);
+proc_m derivativeFingerDetectorInit(proc_para_depth, int deviceMaxDepth, double realWorldXToZArg, double realWorldYToZArg);
+proc_m derivativeFingerDetectorDispose();
+proc_m derivativeFingerDetectorWork(proc_para_depth, double fingerWidthMin, double fingerWidthMax, double fingerLengthMin, double fingerLengthMax, int maxFingers, int* resultPtr, int* handHint);
+proc_m derivativeFingerDetectorGetDerivativeFrame(int** hResPtr, int** vResPtr);
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef _DETECTOR_CONTEXT_H_
+#define _DETECTOR_CONTEXT_H_
+
+#include "depth.h"
+#include "simd.h"
+#include "threadPool.h"
+#include "stageStats.h"
+#include "cameraModel.h"
+#include "histogram.h"
+
+typedef struct Strip
+{
+	int row;
+	int leftCol, rightCol;
+	bool visited;
+	Strip(int row, int leftCol, int rightCol) : row(row), leftCol(leftCol), rightCol(rightCol), visited(false) { }
+} Strip;
+
+//how findFingers links a strip to the next rows
+typedef enum
+{
+	StripLinkFirst = 0,			//the leftmost free overlapping strip, a strip belongs to one chain only
+	StripLinkBestOverlap = 1	//the overlapping strip sharing most columns; chains may merge into strips already taken,
+								//and strips left aside start chains of their own, so chains can branch
+} StripLinking;
+
+typedef struct Finger
+{
+	int tipX, tipY, tipZ;
+	int endX, endY, endZ;
+	int pointBegin, pointNum;	//polyline in DetectorContext::fingerPoints
+	Finger(int tipX, int tipY, int tipZ, int endX, int endY, int endZ) : tipX(tipX), tipY(tipY), tipZ(tipZ), endX(endX), endY(endY), endZ(endZ), pointBegin(0), pointNum(0) { }
+	bool operator<(const Finger& ref) const { return endY - tipY > ref.endY - ref.tipY; }	//sort more to less
+} Finger;
+
+//what a frame produces besides the fingers, flags
+typedef enum
+{
+	OutputNone = 0,
+	OutputImage = 1,			//the RGB24 debug image in dstPixelPtr
+	OutputOverlay = 2			//finger polylines, see derivativeFingerDetectorGetFingerPolylines
+} FrameOutput;
+
+#define OVERLAY_MAX_FINGERS 64
+
+typedef enum
+{
+	FrameFull = 0,				//the whole frame went through the detector
+	FrameRoi = 1,				//only the region around the fingers of the previous frame
+	FramePyramid = 2			//a coarse pass, then only the region around its fingers at full resolution
+} FrameMode;
+
+//what a frame gave up to stay within the deadline, see derivativeFingerDetectorSetDeadline. Every level drops what
+//the levels before it dropped too.
+typedef enum
+{
+	QualityFull = 0,			//as asked for
+	QualityNoImage = 1,			//without OutputImage
+	QualityHalfRows = 2,		//strips of every other row only, chains step over the rows between
+	QualityCoarse = 3,			//the frame downsampled once and detected at half resolution
+	QUALITY_NUM
+} QualityLevel;
+
+typedef struct Roi
+{
+	int left, top, right, bottom;	//right and bottom exclusive
+} Roi;
+
+//Everything one derivative finger detector needs. The buffers are carved out of a single aligned arena owned by
+//the context, so contexts share nothing and several of them can work on different threads at the same time.
+typedef struct DetectorContext
+{
+	int width, height, depthStride, pixelStride;
+	int deviceMaxDepth;
+	CameraModel camera;			//tables in the arena, see derivativeFingerDetectorSetCamera
+	SimdLevel simdLevel;
+
+	ThreadPool* threadPool;
+	int bandNum;				//a frame is split into bandNum horizontal bands, one per thread
+
+	byte* arena;
+	int *hDerivativeRes, *vDerivativeRes;
+	Histogram histogram;		//of the absolute horizontal derivative, for the output image
+	int histogramInterval;		//the histogram is rebuilt every histogramInterval frames with OutputImage
+	int framesSinceHistogram;
+	byte* tmpPixelBuffer;
+	int* sobelScratch;			//sobelScratchSize(width) ints per band
+	int* streamRows;			//one derivative row per band, see derivativeFingerDetectorSetStreaming
+	int *bandMin, *bandMax;
+
+	//flat strip store, rebuilt every frame: row i holds stripNum[i] strips at strips + i * stripCapacity, sorted by
+	//column and disjoint, so the overlaps of a strip in another row are found with a binary search
+	Strip* strips;
+	int* stripNum;
+	int stripCapacity;			//a strip takes at least 4 columns, so width / 4 + 1
+	int stripLinking;			//StripLinking
+	int minPixelLength;			//rows of the shortest finger, FINGER_MIN_PIXEL_LENGTH at full resolution
+	int maxBlankPixel;			//rows a chain may skip, STRIP_MAX_BLANK_PIXEL at full resolution
+	int rowStep;				//strips on every rowStep-th row, 2 with QualityHalfRows
+
+	//streaming, see derivativeFingerDetectorSetStreaming
+	bool streaming;
+	bool derivativeRequested;	//the next frame fills hDerivativeRes / vDerivativeRes
+	int framesSinceDerivative;	//since they were last filled, -1 never
+
+	//tracking mode, see derivativeFingerDetectorSetTracking
+	bool tracking;
+	int fullScanInterval, roiPadding;
+	int framesSinceFullScan;
+	bool roiValid;				//the last frame found fingers, fingerBox can be tracked
+	Roi fingerBox;				//fingers and hand hint of the last frame
+	Roi roi;					//region processed by the last frame
+	int frameMode;				//FrameMode of the last frame
+	Roi candidateBox;			//fingers of the last frame without the hand hint
+
+	//pyramid mode, see derivativeFingerDetectorSetPyramid
+	int pyramidLevel;			//0: off
+	int refinePadding;
+	struct DetectorContext* coarse;	//detector of the coarsest level, shares threadPool
+	ushort* pyramid;			//the levels one after another, each half the size of the previous one
+	Roi* refineBoxes;			//the coarse fingers at full resolution, padded and merged until disjoint, sorted by left
+	int refineBoxNum;
+	byte* pyramidArena;
+	bool ownsThreadPool;
+
+	//deadline scheduler, see derivativeFingerDetectorSetDeadline
+	long long deadlineNanos;	//0: off
+	int maxQuality;				//the lowest QualityLevel it may go to
+	int quality;				//QualityLevel of the next frame
+	int frameQuality;			//of the last frame
+	long long qualityNanos;		//moving average of the frame time at quality, 0 before its first frame
+	int framesAtQuality;
+	int qualityHold;			//frames at a level before trying the better one, grows when a try fails
+	bool qualityRestored;		//quality was reached from a worse level, not dropped to
+	struct DetectorContext* degraded;	//half resolution detector of QualityCoarse, shares threadPool
+	ushort* degradedDepth;
+	byte* degradedArena;
+
+	//findFingers, reserved up front so a frame allocates nothing
+	Strip** chain;				//the strips of the chain being followed, one per row at most
+	Finger* fingerCandidates;	//every chain long enough, sorted before the best are reported
+	int maxFingerCandidates;	//maxFingerPoints, a chain takes a strip of its own or merges into another one
+
+	int outputFlags;			//FrameOutput of the current frame
+	int* fingerPoints;			//(x, y) pairs, the polylines of the accepted fingers
+	int maxFingerPoints, fingerPointNum;
+	int *polylineBegin, *polylineNum;	//polylines of the reported fingers, OVERLAY_MAX_FINGERS at most
+	int polylineFingerNum;
+
+#ifndef NO_STAGE_STATS
+	StageStatsRing stageStats;	//see derivativeFingerDetectorGetStageStats
+	FrameStats frameStats;		//the frame in progress
+	int* bandNanos;				//StageSobel and StageStrips of every band
+#endif
+} DetectorContext;
+
+//the stages of derivativeFingerDetectorContextWorkEx over the whole frame, for the benchmarks: generateOutputImage on
+//the thread pool, the others on the calling thread. They run with ctx->outputFlags and ctx->rowStep as they are. sobel fills hDerivativeRes and vDerivativeRes, findStrips
+//reads hDerivativeRes, findFingers marks the strips it links visited so it runs once per findStrips, and
+//generateOutputImage draws the derivative under the overlay both left in tmpPixelBuffer.
+int sobel(DetectorContext* ctx, proc_para_depth);
+void findStrips(DetectorContext* ctx, proc_para_depth, double fingerWidthMin, double fingerWidthMax, int rowBegin, int rowEnd, int colBegin, int colEnd);
+int findFingers(DetectorContext* ctx, proc_para_depth, double fingerLengthMin, double fingerLengthMax, int maxFingers, int* resultPtr, int* handHint);
+void generateOutputImage(DetectorContext* ctx, proc_para_depth);
+
+#endif
@@ -0,0 +1,408 @@
+#include "detectorWorker.h"
+#include "derivativeFingerDetector.h"
+#include "detectorContext.h"
+#include "debugCapture.h"
+#include "arena.h"
+#include "threading.h"
+#include <string.h>
+
+//the shared middle slot of the frame triple buffer: its index, and whether it holds a frame the worker hasn't taken
+#define FRAME_SLOT_MASK 3
+#define FRAME_FRESH 4
+
+typedef struct WorkerFrame
+{
+	long long sequence, timestamp, submitNanos;
+	double fingerWidthMin, fingerWidthMax, fingerLengthMin, fingerLengthMax;
+	int outputFlags;
+	ushort* depth;
+} WorkerFrame;
+
+typedef struct DetectorWorker
+{
+	DetectorContext* detector;
+	int maxFingers;
+	FingerTracker tracker;			//the worker's, like the detector guarded by detectorMutex
+
+	//frames: the capture thread owns backFrame, the worker frontFrame, they swap through middleFrame
+	WorkerFrame frames[WORKER_FRAME_SLOTS];
+	volatile long middleFrame;
+	int backFrame, frontFrame;
+
+	//results: latestResult is published, readers counts the consumers holding each slot
+	DetectorResult results[WORKER_RESULT_SLOTS];
+	volatile long readers[WORKER_RESULT_SLOTS];
+	volatile long latestResult;		//-1 before the first result
+
+	volatile long maxAgeMillis;
+
+	//counters of the capture thread, 32 bit so they are read whole
+	volatile long submitted, overwritten;
+	//counters of the worker, read as a whole with the sequence number, odd while written
+	volatile long statsSequence;
+	DetectorWorkerStats workerStats;
+
+	//a snapshot of detectorWorkerSnapshot, taken right after the next frame the worker detects
+	Mutex snapshotMutex;
+	volatile long snapshotPending;
+	void* snapshotCapture;
+	char snapshotPath[DEBUG_CAPTURE_MAX_PATH];
+
+	Semaphore wake;					//posted for every frame and to stop
+	Mutex detectorMutex;			//held by the worker while detecting
+	Thread thread;
+	volatile long stopRequested;
+
+	byte* arena;
+} DetectorWorker;
+
+static void carveWorker(DetectorWorker* w, Arena* arena)
+{
+	DetectorContext* ctx = w->detector;
+	for (int s = 0; s < WORKER_FRAME_SLOTS; s++)
+	{
+		w->frames[s].depth = arenaNew(arena, ushort, ctx->depthStride * ctx->height);
+	}
+	for (int s = 0; s < WORKER_RESULT_SLOTS; s++)
+	{
+		w->results[s].fingers = arenaNew(arena, int, 2 * w->maxFingers);
+		w->results[s].image = arenaNew(arena, byte, ctx->pixelStride * ctx->height);
+		w->results[s].tracks = arenaNew(arena, FingerTrack, TRACKER_MAX_TRACKS);
+	}
+}
+
+//a slot neither published nor held. A consumer may still bump the count of a slot it saw published before, but it
+//checks latestResult again afterwards and lets go, so it never reads a slot being written.
+static int freeResultSlot(DetectorWorker* w)
+{
+	long latest = w->latestResult;
+	for (int s = 0; s < WORKER_RESULT_SLOTS; s++)
+	{
+		if (s != latest && w->readers[s] == 0)
+		{
+			return s;
+		}
+	}
+	return -1;
+}
+
+static void publishStats(DetectorWorker* w, bool processed, long long latencyNanos)
+{
+	DetectorWorkerStats* stats = &w->workerStats;
+
+	w->statsSequence++;
+	memoryBarrier();
+	if (processed)
+	{
+		stats->processed++;
+		stats->latencyLastNanos = latencyNanos;
+		stats->latencyAvgNanos = stats->processed == 1 ? latencyNanos : stats->latencyAvgNanos + (latencyNanos - stats->latencyAvgNanos) / 16;
+		stats->latencyMaxNanos = latencyNanos > stats->latencyMaxNanos ? latencyNanos : stats->latencyMaxNanos;
+	}
+	else
+	{
+		stats->dropped++;
+	}
+	memoryBarrier();
+	w->statsSequence++;
+}
+
+//on the worker thread, holding the detector
+static void takeSnapshot(DetectorWorker* w, const WorkerFrame* frame, const DetectorResult* result)
+{
+	DetectorContext* ctx = w->detector;
+	byte* image = (result->outputFlags & OutputImage) ? result->image : NULL;
+
+	mutexLock(&w->snapshotMutex);
+	debugCaptureTake(w->snapshotCapture, ctx, frame->depth, ctx->depthStride, result->fingers, result->fingerNum, (int*)result->handHint,
+					 image, ctx->pixelStride, frame->timestamp, w->snapshotPath);
+	w->snapshotPending = 0;
+	mutexUnlock(&w->snapshotMutex);
+}
+
+static void detectFrame(DetectorWorker* w, const WorkerFrame* frame)
+{
+	long long maxAgeNanos = w->maxAgeMillis * 1000000LL;
+	if (maxAgeNanos > 0 && stageClock() - frame->submitNanos > maxAgeNanos)
+	{
+		publishStats(w, false, 0);
+		return;
+	}
+
+	int slot = freeResultSlot(w);
+	if (slot < 0)
+	{
+		publishStats(w, false, 0);
+		return;
+	}
+
+	DetectorResult* result = &w->results[slot];
+	bool snapshot = w->snapshotPending != 0;
+	mutexLock(&w->detectorMutex);
+	if (snapshot)
+	{
+		derivativeFingerDetectorRequestDerivativeFrame(w->detector);
+	}
+	result->fingerNum = derivativeFingerDetectorContextWorkEx(w->detector, frame->depth, result->image,
+															  frame->fingerWidthMin, frame->fingerWidthMax, frame->fingerLengthMin, frame->fingerLengthMax,
+															  w->maxFingers, result->fingers, result->handHint, frame->outputFlags);
+	result->frameMode = derivativeFingerDetectorGetFrameMode(w->detector, NULL);
+	result->quality = derivativeFingerDetectorGetQuality(w->detector);
+	result->outputFlags = w->detector->outputFlags;
+	result->trackNum = fingerTrackerStep(&w->tracker, frame->timestamp, result->fingers, result->fingerNum);
+	memcpy(result->tracks, w->tracker.tracks, result->trackNum * sizeof(FingerTrack));
+	if (snapshot)
+	{
+		takeSnapshot(w, frame, result);
+	}
+	mutexUnlock(&w->detectorMutex);
+
+	result->sequence = frame->sequence;
+	result->timestamp = frame->timestamp;
+	result->submitNanos = frame->submitNanos;
+	result->doneNanos = stageClock();
+
+	atomicExchange(&w->latestResult, slot);		//a full barrier, the result is written before it's published
+	publishStats(w, true, result->doneNanos - result->submitNanos);
+}
+
+static THREAD_PROC(workerProc)
+{
+	DetectorWorker* w = (DetectorWorker*)threadArg;
+
+	for (;;)
+	{
+		semaphoreWait(&w->wake);
+		if (w->stopRequested)
+		{
+			break;
+		}
+
+		//one post per frame, but frames replaced before they were taken leave nothing fresh behind
+		if ((w->middleFrame & FRAME_FRESH) == 0)
+		{
+			continue;
+		}
+		w->frontFrame = atomicExchange(&w->middleFrame, w->frontFrame) & FRAME_SLOT_MASK;
+		detectFrame(w, &w->frames[w->frontFrame]);
+	}
+
+	return 0;
+}
+
+DLL_EXPORT void* detectorWorkerCreate(void* detector, int maxFingers)
+{
+	if (detector == NULL || maxFingers <= 0)
+	{
+		return NULL;
+	}
+
+	DetectorWorker* w = new DetectorWorker();
+	memset(w, 0, sizeof(DetectorWorker));
+	w->detector = (DetectorContext*)detector;
+	w->maxFingers = maxFingers;
+	fingerTrackerInit(&w->tracker);
+	w->backFrame = 0;
+	w->middleFrame = 1;
+	w->frontFrame = 2;
+	w->latestResult = -1;
+
+	Arena arena = { NULL, 0 };
+	carveWorker(w, &arena);
+	w->arena = arenaAllocate(&arena);
+	if (w->arena == NULL)
+	{
+		delete w;
+		return NULL;
+	}
+	carveWorker(w, &arena);
+
+	if (!semaphoreInit(&w->wake))
+	{
+		arenaFree(w->arena);
+		delete w;
+		return NULL;
+	}
+	mutexInit(&w->detectorMutex);
+	mutexInit(&w->snapshotMutex);
+
+	if (!threadStart(&w->thread, workerProc, w))
+	{
+		mutexDestroy(&w->snapshotMutex);
+		mutexDestroy(&w->detectorMutex);
+		semaphoreDestroy(&w->wake);
+		arenaFree(w->arena);
+		delete w;
+		return NULL;
+	}
+
+	return w;
+}
+
+proc_m detectorWorkerDestroy(void* worker)
+{
+	DetectorWorker* w = (DetectorWorker*)worker;
+	if (w == NULL)
+	{
+		return 0;
+	}
+
+	w->stopRequested = 1;
+	semaphorePost(&w->wake);
+	threadJoin(&w->thread);
+
+	mutexDestroy(&w->snapshotMutex);
+	mutexDestroy(&w->detectorMutex);
+	semaphoreDestroy(&w->wake);
+	arenaFree(w->arena);
+	delete w;
+
+	return 0;
+}
+
+proc_m detectorWorkerSetMaxAge(void* worker, int maxAgeMillis)
+{
+	DetectorWorker* w = (DetectorWorker*)worker;
+	w->maxAgeMillis = maxAgeMillis > 0 ? maxAgeMillis : 0;
+	return 0;
+}
+
+proc_m detectorWorkerSubmit(void* worker, ushort* srcDepthPtr, long long timestamp, double fingerWidthMin, double fingerWidthMax, double fingerLengthMin, double fingerLengthMax, int outputFlags)
+{
+	DetectorWorker* w = (DetectorWorker*)worker;
+	long long submitNanos = stageClock();
+
+	WorkerFrame* frame = &w->frames[w->backFrame];
+	memcpy(frame->depth, srcDepthPtr, w->detector->depthStride * w->detector->height * sizeof(ushort));
+	frame->sequence = w->submitted + 1;
+	frame->timestamp = timestamp;
+	frame->submitNanos = submitNanos;
+	frame->fingerWidthMin = fingerWidthMin;
+	frame->fingerWidthMax = fingerWidthMax;
+	frame->fingerLengthMin = fingerLengthMin;
+	frame->fingerLengthMax = fingerLengthMax;
+	frame->outputFlags = outputFlags;
+
+	//a full barrier, the frame is written before the worker can take it
+	long previous = atomicExchange(&w->middleFrame, w->backFrame | FRAME_FRESH);
+	w->backFrame = previous & FRAME_SLOT_MASK;
+	if ((previous & FRAME_FRESH) != 0)
+	{
+		w->overwritten++;
+	}
+	w->submitted++;
+	semaphorePost(&w->wake);
+
+	return (int)frame->sequence;
+}
+
+DLL_EXPORT DetectorResult* detectorWorkerAcquire(void* worker)
+{
+	DetectorWorker* w = (DetectorWorker*)worker;
+
+	for (;;)
+	{
+		long slot = w->latestResult;
+		if (slot < 0)
+		{
+			return NULL;
+		}
+
+		atomicIncrement(&w->readers[slot]);
+		if (w->latestResult == slot)
+		{
+			return &w->results[slot];
+		}
+		atomicDecrement(&w->readers[slot]);		//a newer one came in between, the worker may be writing this slot already
+	}
+}
+
+proc_m detectorWorkerRelease(void* worker, DetectorResult* result)
+{
+	DetectorWorker* w = (DetectorWorker*)worker;
+	if (result != NULL)
+	{
+		atomicDecrement(&w->readers[result - w->results]);
+	}
+	return 0;
+}
+
+proc_m detectorWorkerGetStats(void* worker, DetectorWorkerStats* statsPtr)
+{
+	DetectorWorker* w = (DetectorWorker*)worker;
+
+	for (;;)
+	{
+		long before = w->statsSequence;
+		memoryBarrier();
+		*statsPtr = w->workerStats;
+		memoryBarrier();
+		if (before == w->statsSequence && (before & 1) == 0)
+		{
+			break;
+		}
+	}
+
+	statsPtr->submitted = w->submitted;
+	statsPtr->overwritten = w->overwritten;
+	return 0;
+}
+
+proc_m detectorWorkerPredict(void* worker, DetectorResult* result, long long timestamp, FingerTrack* tracksPtr)
+{
+	DetectorWorker* w = (DetectorWorker*)worker;
+	if (timestamp == 0)
+	{
+		timestamp = result->timestamp + (stageClock() - result->submitNanos) / 1000;
+	}
+
+	fingerTracksPredict(result->tracks, result->trackNum, timestamp, w->tracker.maxPredictMicros, tracksPtr);
+	return result->trackNum;
+}
+
+proc_m detectorWorkerSetTracker(void* worker, double gate, double alpha, double beta, int maxMissed, int maxPredictMillis)
+{
+	DetectorWorker* w = (DetectorWorker*)worker;
+
+	mutexLock(&w->detectorMutex);
+	int status = fingerTrackerSetParams(&w->tracker, gate, alpha, beta, maxMissed, maxPredictMillis);
+	if (status == 0)
+	{
+		fingerTrackerReset(&w->tracker);
+	}
+	mutexUnlock(&w->detectorMutex);
+	return status;
+}
+
+proc_m detectorWorkerLockDetector(void* worker)
+{
+	mutexLock(&((DetectorWorker*)worker)->detectorMutex);
+	return 0;
+}
+
+proc_m detectorWorkerUnlockDetector(void* worker)
+{
+	mutexUnlock(&((DetectorWorker*)worker)->detectorMutex);
+	return 0;
+}
+
+proc_m detectorWorkerSnapshot(void* worker, void* capture, const char* path)
+{
+	DetectorWorker* w = (DetectorWorker*)worker;
+	if (capture == NULL || path == NULL || strlen(path) >= DEBUG_CAPTURE_MAX_PATH)
+	{
+		return -1;
+	}
+
+	int status = -1;
+	mutexLock(&w->snapshotMutex);
+	if (!w->snapshotPending)
+	{
+		w->snapshotCapture = capture;
+		strcpy(w->snapshotPath, path);
+		w->snapshotPending = 1;
+		status = 0;
+	}
+	mutexUnlock(&w->snapshotMutex);
+	return status;
+}
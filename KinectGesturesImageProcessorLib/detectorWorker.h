@@ -0,0 +1,82 @@
+#ifndef _DETECTOR_WORKER_H_
+#define _DETECTOR_WORKER_H_
+
+#include "depth.h"
+#include "fingerTracker.h"
+
+//Runs a derivative finger detector on a thread of its own, between a capture thread and any number of consumers:
+//	capture		detectorWorkerSubmit copies the depth frame into a triple buffer and returns, it never waits
+//	worker		takes the newest frame, detects, tracks the fingers (fingerTracker.h), publishes the result
+//	consumers	detectorWorkerAcquire returns the newest result in place, no copy, until detectorWorkerRelease
+//Frames the worker didn't get to in time are replaced by newer ones: the detector always works on the latest frame,
+//the skipped ones are counted. Results live in WORKER_RESULT_SLOTS slots with a reader count each: the worker never
+//writes a slot that is published or held, so up to WORKER_RESULT_SLOTS - 2 consumers may hold a result at a time.
+
+#define WORKER_FRAME_SLOTS 3
+#define WORKER_RESULT_SLOTS 4
+
+//long longs first and an even num of ints before the pointers, the C# side mirrors it as a sequential struct
+typedef struct DetectorResult
+{
+	long long sequence;			//of the depth frame, from 1
+	long long timestamp;		//as given to detectorWorkerSubmit
+	long long submitNanos;		//stageClock when the frame was submitted
+	long long doneNanos;		//stageClock when the result was published
+	int fingerNum;
+	int frameMode;				//FrameMode
+	int outputFlags;			//FrameOutput the frame was detected with, image is valid with OutputImage only. The
+								//deadline scheduler may have dropped OutputImage of the submitted flags.
+	int trackNum;
+	int quality;				//QualityLevel, see derivativeFingerDetectorSetDeadline
+	int reserved;
+	int handHint[4];
+	int* fingers;				//fingerNum (x, y) pairs
+	byte* image;				//RGB24, pixelStride bytes per row
+	FingerTrack* tracks;		//trackNum, at timestamp. The detection of a track indexes fingers.
+} DetectorResult;
+
+typedef struct DetectorWorkerStats
+{
+	long long submitted;		//frames given to detectorWorkerSubmit
+	long long processed;		//frames detected
+	long long overwritten;		//replaced by a newer frame before the worker took them
+	long long dropped;			//taken by the worker but not detected: older than the age limit, or no free result slot
+	long long latencyLastNanos;	//submit to publish of the last result
+	long long latencyAvgNanos;	//moving average over roughly the last 16 results
+	long long latencyMaxNanos;
+} DetectorWorkerStats;
+
+//detector: a context of derivativeFingerDetectorCreate, used by the worker thread only from now on (see
+//detectorWorkerLockDetector). It stays owned by the caller and must outlive the worker. Returns NULL when out of memory.
+DLL_EXPORT void* detectorWorkerCreate(void* detector, int maxFingers);
+proc_m detectorWorkerDestroy(void* worker);
+
+//frames older than maxAgeMillis when the worker gets to them are dropped rather than detected, 0 (default) keeps all
+proc_m detectorWorkerSetMaxAge(void* worker, int maxAgeMillis);
+
+//one capture thread only. Copies the frame, depthStride of the detector ushorts per row, and returns its sequence.
+//timestamp is in microseconds, the tracker measures the finger velocities with it.
+proc_m detectorWorkerSubmit(void* worker, ushort* srcDepthPtr, long long timestamp, double fingerWidthMin, double fingerWidthMax, double fingerLengthMin, double fingerLengthMax, int outputFlags);
+
+//the newest result, NULL before the first one. It doesn't change until released, release it before acquiring again.
+DLL_EXPORT DetectorResult* detectorWorkerAcquire(void* worker);
+proc_m detectorWorkerRelease(void* worker, DetectorResult* result);
+
+proc_m detectorWorkerGetStats(void* worker, DetectorWorkerStats* statsPtr);
+
+//the tracks of a held result extrapolated to timestamp into tracksPtr (TRACKER_MAX_TRACKS), returns their num.
+//timestamp 0 is now: the frame timestamp plus the time since it was submitted, the latency of the worker.
+proc_m detectorWorkerPredict(void* worker, DetectorResult* result, long long timestamp, FingerTrack* tracksPtr);
+//see fingerTrackerSetParams. The tracks start over, ids go on counting.
+proc_m detectorWorkerSetTracker(void* worker, double gate, double alpha, double beta, int maxMissed, int maxPredictMillis);
+
+//keeps the worker off the detector, to read its buffers (derivativeFingerDetectorContextGetDerivativeFrame) or change its
+//settings. Submitting goes on meanwhile, the worker carries on with the newest frame after the unlock.
+proc_m detectorWorkerLockDetector(void* worker);
+proc_m detectorWorkerUnlockDetector(void* worker);
+
+//a debug snapshot (debugCapture.h) of the next frame the worker detects into path, with its derivative frames. Returns
+//right away: 0, or -1 while the previous snapshot is still to be taken. The capture must outlive the worker.
+proc_m detectorWorkerSnapshot(void* worker, void* capture, const char* path);
+
+#endif
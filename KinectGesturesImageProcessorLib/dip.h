@@ -1,9 +1,16 @@
 #ifndef _DIP_H_
 #define _DIP_H_
 
+#include <stddef.h>
+
 typedef unsigned char byte;
 
-#define proc_m extern "C" __declspec(dllexport) int								//processor function modifier
+#ifdef _WIN32
+#define DLL_EXPORT extern "C" __declspec(dllexport)
+#else
+#define DLL_EXPORT extern "C" __attribute__((visibility("default")))	//the replay tools build the library on Linux
+#endif
+#define proc_m DLL_EXPORT int								//processor function modifier
 #define proc_para byte* srcPtr, byte* dstPtr, int width, int height, int stride		//common parameters
 
 #define srcPixelBit(row, col) ((srcPtr + (row) * stride + (col)))
@@ -16,4 +23,13 @@ typedef unsigned char byte;
 
 #define bwBit(value) ((value) ? 0xFF : 0)
 
+//morphological.cpp, segmentation.cpp. open clashes with open(2) of <fcntl.h>, don't include both in one file.
+proc_m dilate(proc_para);
+proc_m erose(proc_para);
+proc_m open(proc_para, byte* switchPtr);
+proc_m extractPointsEx(void* labeller, proc_para, int maxNum, int minArea, int* resultPtr, int* labelPtr);
+DLL_EXPORT void* extractPointsCreate(int width, int height);
+proc_m extractPointsDestroy(void* labeller);
+proc_m extractPoints(proc_para, byte* switchPtr, int maxNum, int minArea, int* resultPtr);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "fingerTracker.h"
+#include <string.h>
+#include <algorithm>
+
+#define TRACKER_GATE 40					//pixels, a finger moves less than this between two frames at 30 fps
+#define TRACKER_ALPHA 0.7
+#define TRACKER_BETA 0.3
+#define TRACKER_MAX_MISSED 3
+#define TRACKER_MAX_PREDICT_MICROS 50000
+
+typedef struct TrackPair
+{
+	double distance2;
+	int track, detection;
+} TrackPair;
+
+//nearest first; ties go to the older track and the longer finger, so equal frames give equal ids
+static bool pairBefore(const TrackPair& a, const TrackPair& b)
+{
+	if (a.distance2 != b.distance2) return a.distance2 < b.distance2;
+	if (a.track != b.track) return a.track < b.track;
+	return a.detection < b.detection;
+}
+
+void fingerTrackerInit(FingerTracker* t)
+{
+	memset(t, 0, sizeof(FingerTracker));
+	t->gate = TRACKER_GATE;
+	t->alpha = TRACKER_ALPHA;
+	t->beta = TRACKER_BETA;
+	t->maxMissed = TRACKER_MAX_MISSED;
+	t->maxPredictMicros = TRACKER_MAX_PREDICT_MICROS;
+	t->nextId = 1;
+}
+
+//ids go on counting, a consumer never sees an old id for a new finger
+void fingerTrackerReset(FingerTracker* t)
+{
+	t->trackNum = 0;
+	t->lastTimestamp = 0;
+}
+
+int fingerTrackerStep(FingerTracker* t, long long timestamp, const int* fingers, int fingerNum)
+{
+	//the first frame, a repeated or an out of order timestamp: no motion to predict or to measure
+	double dt = t->lastTimestamp != 0 && timestamp > t->lastTimestamp ? (timestamp - t->lastTimestamp) * 1e-6 : 0;
+	t->lastTimestamp = timestamp;
+	fingerNum = std::min(std::max(fingerNum, 0), TRACKER_MAX_DETECTIONS);
+
+	TrackPair pairs[TRACKER_MAX_TRACKS * TRACKER_MAX_DETECTIONS];
+	int pairNum = 0;
+	double gate2 = t->gate * t->gate;
+	for (int k = 0; k < t->trackNum; k++)
+	{
+		FingerTrack* track = &t->tracks[k];
+		track->x += track->vx * dt;
+		track->y += track->vy * dt;
+		track->timestamp = timestamp;
+		track->detection = -1;
+
+		for (int d = 0; d < fingerNum; d++)
+		{
+			double dx = fingers[2 * d] - track->x, dy = fingers[2 * d + 1] - track->y;
+			double distance2 = dx * dx + dy * dy;
+			if (distance2 <= gate2)
+			{
+				TrackPair pair = { distance2, k, d };
+				pairs[pairNum++] = pair;
+			}
+		}
+	}
+	std::sort(pairs, pairs + pairNum, pairBefore);
+
+	int trackOf[TRACKER_MAX_DETECTIONS];
+	for (int d = 0; d < fingerNum; d++)
+	{
+		trackOf[d] = -1;
+	}
+	for (int p = 0; p < pairNum; p++)
+	{
+		FingerTrack* track = &t->tracks[pairs[p].track];
+		int d = pairs[p].detection;
+		if (track->detection >= 0 || trackOf[d] >= 0)
+		{
+			continue;
+		}
+		track->detection = d;
+		trackOf[d] = pairs[p].track;
+
+		double rx = fingers[2 * d] - track->x, ry = fingers[2 * d + 1] - track->y;
+		track->x += t->alpha * rx;
+		track->y += t->alpha * ry;
+		if (dt > 0)
+		{
+			//the second sighting in a row has no velocity to correct yet, it measures it
+			double gain = track->age == 1 && track->missed == 0 ? 1 : t->beta;
+			track->vx += gain * rx / dt;
+			track->vy += gain * ry / dt;
+		}
+		track->age++;
+		track->missed = 0;
+	}
+
+	//tracks missed too often go, the rest keep their order: oldest id first
+	int kept = 0;
+	for (int k = 0; k < t->trackNum; k++)
+	{
+		FingerTrack* track = &t->tracks[k];
+		if (track->detection < 0 && ++track->missed > t->maxMissed)
+		{
+			continue;
+		}
+		t->tracks[kept++] = *track;
+	}
+	t->trackNum = kept;
+
+	//detections nobody claimed, longest finger first
+	for (int d = 0; d < fingerNum && t->trackNum < TRACKER_MAX_TRACKS; d++)
+	{
+		if (trackOf[d] >= 0)
+		{
+			continue;
+		}
+		FingerTrack* track = &t->tracks[t->trackNum++];
+		memset(track, 0, sizeof(FingerTrack));
+		track->timestamp = timestamp;
+		track->x = fingers[2 * d];
+		track->y = fingers[2 * d + 1];
+		track->id = t->nextId++;
+		track->age = 1;
+		track->detection = d;
+	}
+
+	return t->trackNum;
+}
+
+void fingerTracksPredict(const FingerTrack* tracks, int trackNum, long long timestamp, long long maxPredictMicros, FingerTrack* dst)
+{
+	for (int k = 0; k < trackNum; k++)
+	{
+		long long ahead = std::min(std::max(timestamp - tracks[k].timestamp, 0LL), maxPredictMicros);
+		dst[k] = tracks[k];
+		dst[k].timestamp = tracks[k].timestamp + ahead;
+		dst[k].x = tracks[k].x + tracks[k].vx * ahead * 1e-6;
+		dst[k].y = tracks[k].y + tracks[k].vy * ahead * 1e-6;
+	}
+}
+
+DLL_EXPORT void* fingerTrackerCreate()
+{
+	FingerTracker* t = new FingerTracker();
+	fingerTrackerInit(t);
+	return t;
+}
+
+proc_m fingerTrackerDestroy(void* tracker)
+{
+	delete (FingerTracker*)tracker;
+	return 0;
+}
+
+proc_m fingerTrackerSetParams(void* tracker, double gate, double alpha, double beta, int maxMissed, int maxPredictMillis)
+{
+	FingerTracker* t = (FingerTracker*)tracker;
+	if (!(gate > 0) || !(alpha > 0 && alpha <= 1) || !(beta > 0 && beta <= 1) || maxMissed < 0 || maxPredictMillis < 0)
+	{
+		return -1;
+	}
+
+	t->gate = gate;
+	t->alpha = alpha;
+	t->beta = beta;
+	t->maxMissed = maxMissed;
+	t->maxPredictMicros = maxPredictMillis * 1000LL;
+	return 0;
+}
+
+proc_m fingerTrackerUpdate(void* tracker, long long timestamp, int* fingers, int fingerNum, FingerTrack* tracksPtr)
+{
+	FingerTracker* t = (FingerTracker*)tracker;
+	int trackNum = fingerTrackerStep(t, timestamp, fingers, fingerNum);
+	if (tracksPtr != NULL)
+	{
+		memcpy(tracksPtr, t->tracks, trackNum * sizeof(FingerTrack));
+	}
+	return trackNum;
+}
+
+proc_m fingerTrackerPredict(void* tracker, long long timestamp, FingerTrack* tracksPtr)
+{
+	FingerTracker* t = (FingerTracker*)tracker;
+	fingerTracksPredict(t->tracks, t->trackNum, timestamp, t->maxPredictMicros, tracksPtr);
+	return t->trackNum;
+}
+
+proc_m fingerTrackerResetTracks(void* tracker)
+{
+	fingerTrackerReset((FingerTracker*)tracker);
+	return 0;
+}
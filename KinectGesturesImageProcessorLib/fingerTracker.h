@@ -0,0 +1,61 @@
+#ifndef _FINGER_TRACKER_H_
+#define _FINGER_TRACKER_H_
+
+#include "depth.h"
+
+//Gives the fingertips of consecutive frames stable ids. findFingers returns them longest finger first, so the order
+//changes from frame to frame; the tracker keeps a track per finger:
+//	predict		every track moves to the frame time with its velocity
+//	match		detection / track pairs closer than the gate, nearest pair first (greedy global nearest neighbour)
+//	filter		matched tracks take the detection in with a constant velocity alpha-beta filter, unmatched ones
+//				coast for up to maxMissed frames, unmatched detections start new tracks
+//Everything is fixed size, TRACKER_MAX_TRACKS tracks against TRACKER_MAX_DETECTIONS detections, and nothing allocates:
+//an update costs a few microseconds at most.
+//Timestamps are microseconds, like the OpenNI depth frames and depthSequence.h.
+
+#define TRACKER_MAX_TRACKS 16
+#define TRACKER_MAX_DETECTIONS 16		//further detections of a frame are ignored
+
+//naturally aligned, the C# side mirrors it as a sequential struct
+typedef struct FingerTrack
+{
+	long long timestamp;		//of x, y
+	double x, y;				//pixels
+	double vx, vy;				//pixels per second
+	int id;						//from 1, never reused by a tracker
+	int age;					//frames with a detection
+	int missed;					//frames in a row without one, 0 when the last frame had it
+	int detection;				//index into the fingers of the last update, -1 when missed
+} FingerTrack;
+
+typedef struct FingerTracker
+{
+	double gate;				//pixels between the predicted track and a detection
+	double alpha, beta;			//filter gains for position and velocity
+	int maxMissed;
+	long long maxPredictMicros;	//extrapolation limit of fingerTrackerPredict
+
+	FingerTrack tracks[TRACKER_MAX_TRACKS];
+	int trackNum;
+	int nextId;
+	long long lastTimestamp;	//of the last update, 0 before the first
+} FingerTracker;
+
+void fingerTrackerInit(FingerTracker* t);
+void fingerTrackerReset(FingerTracker* t);
+//fingers: fingerNum (x, y) pairs as derivativeFingerDetectorWork fills them. Returns the num of tracks.
+int fingerTrackerStep(FingerTracker* t, long long timestamp, const int* fingers, int fingerNum);
+//tracks moved to timestamp with their velocity, at most maxPredictMicros ahead of their own timestamp
+void fingerTracksPredict(const FingerTrack* tracks, int trackNum, long long timestamp, long long maxPredictMicros, FingerTrack* dst);
+
+DLL_EXPORT void* fingerTrackerCreate();
+proc_m fingerTrackerDestroy(void* tracker);
+//gate in pixels, alpha and beta in (0, 1], maxMissed frames >= 0, maxPredictMillis >= 0. Returns -1 for a bad value.
+proc_m fingerTrackerSetParams(void* tracker, double gate, double alpha, double beta, int maxMissed, int maxPredictMillis);
+//returns the num of tracks, with them in tracksPtr (optional, TRACKER_MAX_TRACKS)
+proc_m fingerTrackerUpdate(void* tracker, long long timestamp, int* fingers, int fingerNum, FingerTrack* tracksPtr);
+//the tracks of the last update extrapolated to timestamp into tracksPtr (TRACKER_MAX_TRACKS), returns their num
+proc_m fingerTrackerPredict(void* tracker, long long timestamp, FingerTrack* tracksPtr);
+proc_m fingerTrackerResetTracks(void* tracker);
+
+#endif
@@ -0,0 +1,15 @@
+#include "fixedSize.h"
+
+static volatile long fixedSizeEnabled = 1;
+
+bool fixedSizeKernels()
+{
+	return fixedSizeEnabled != 0;
+}
+
+proc_m setFixedSizeKernels(int enabled)
+{
+	int previous = fixedSizeEnabled != 0;
+	fixedSizeEnabled = enabled != 0;
+	return previous;
+}
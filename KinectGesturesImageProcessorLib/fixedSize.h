@@ -0,0 +1,46 @@
+#ifndef _FIXED_SIZE_H_
+#define _FIXED_SIZE_H_
+
+#include "depth.h"
+
+//Frame sizes as template parameters, so the kernels we run most get their loop bounds and row strides as constants:
+//the compiler drops the stride multiplies, unrolls the borders and vectorizes the rows without a remainder loop.
+//A kernel is written once against a size policy and instantiated for FixedSize and RuntimeSize:
+//	template <class Size> static void kernel(..., Size size) { int width = size.width(), ...; }
+//and dispatchFixedSize picks the instantiation for a frame, RuntimeSize for anything else.
+
+template <int W, int H>
+struct FixedSize
+{
+	int width() const { return W; }
+	int height() const { return H; }
+	int stride() const { return W; }		//rows are packed
+};
+
+struct RuntimeSize
+{
+	int w, h, s;
+	RuntimeSize(int width, int height, int stride) : w(width), h(height), s(stride) { }
+	int width() const { return w; }
+	int height() const { return h; }
+	int stride() const { return s; }
+};
+
+//enabled 0 runs every kernel through its RuntimeSize instantiation, for benchmarks and checks. Returns the previous setting.
+proc_m setFixedSizeKernels(int enabled);
+bool fixedSizeKernels();
+
+//the Kinect depth modes: 640x480 and 320x240 the server runs, and 80x60 the specialization was asked for. Only a raw
+//80x60 frame reaches that one, the pyramid's coarse level of 640x480 is 320x240 and never draws an image.
+//call sees the instantiation as the variable size.
+#define dispatchFixedSize(width, height, stride, call) \
+	do \
+	{ \
+		bool fixed = fixedSizeKernels() && (stride) == (width); \
+		if (fixed && (width) == 640 && (height) == 480) { FixedSize<640, 480> size; call; } \
+		else if (fixed && (width) == 320 && (height) == 240) { FixedSize<320, 240> size; call; } \
+		else if (fixed && (width) == 80 && (height) == 60) { FixedSize<80, 60> size; call; } \
+		else { RuntimeSize size(width, height, stride); call; } \
+	} while (0)
+
+#endif
@@ -0,0 +1,656 @@
+#include "histogram.h"
+#include "threadPool.h"
+#include "threading.h"
+#include <memory.h>
+#include <math.h>
+#include <assert.h>
+
+void histogramInit(Histogram* h, SimdLevel level, int maxBins, int subBins, int tailCapacity, int bandNum)
+{
+	h->maxBins = maxBins;
+	h->subBins = subBins < maxBins ? subBins : maxBins;
+	h->tailCapacity = tailCapacity;
+	h->bandNum = bandNum;
+	h->simdLevel = level;
+	h->offset = h->size = h->points = 0;
+}
+
+void carveHistogram(Histogram* h, Arena* arena)
+{
+	h->bands = arenaNew(arena, HistogramBand, h->bandNum);
+	h->sub = arenaNew(arena, int, h->subBins * h->bandNum);
+	h->tail = arenaNew(arena, int, h->tailCapacity * h->bandNum);
+	h->bins = arenaNew(arena, int, h->maxBins);
+	h->lut = arenaNew(arena, byte, h->maxBins + HISTOGRAM_LUT_PADDING);
+	if (h->lut != NULL)
+	{
+		memset(h->lut, 0, h->maxBins + HISTOGRAM_LUT_PADDING);
+	}
+}
+
+void histogramBegin(Histogram* h, int offset, int size)
+{
+	assert(size > 0 && size <= h->maxBins);
+	h->offset = offset;
+	h->size = size;
+	h->points = 0;
+
+	//the sub-histograms are cleared by their bands, the bins past them collect the tails
+	int subSize = size < h->subBins ? size : h->subBins;
+	memset(h->bins + subSize, 0, (size - subSize) * sizeof(int));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//count
+
+static inline int valueOf(ushort v) { return v; }
+static inline int valueOf(int v) { return v < 0 ? -v : v; }
+
+//returns the num of values in the tail buffer, -1 when it overflowed. Zero depth is no reading.
+template <typename T>
+static int countRows(const Histogram* h, const T* src, int stride, int width, int rowBegin, int rowEnd, int* sub, int* tail, bool skipZero)
+{
+	int offset = h->offset, last = h->size - 1;
+	int subSize = h->size < h->subBins ? h->size : h->subBins;
+	int tailNum = 0, tailCapacity = h->tailCapacity;
+
+	for (int i = rowBegin; i < rowEnd; i++)
+	{
+		const T* row = src + i * stride;
+		for (int j = 0; j < width; j++)
+		{
+			if (skipZero && row[j] == 0)
+			{
+				continue;
+			}
+			int bin = valueOf(row[j]) - offset;
+			bin = bin < 0 ? 0 : (bin > last ? last : bin);
+			if (bin < subSize)
+			{
+				sub[bin]++;
+			}
+			else if (tailNum < tailCapacity)
+			{
+				tail[tailNum++] = bin;
+			}
+			else
+			{
+				tailNum = tailCapacity + 1;		//the merge counts the tail of these rows again
+			}
+		}
+	}
+	return tailNum <= tailCapacity ? tailNum : -1;
+}
+
+//the bins past the sub-histograms of one band, straight into h->bins
+template <typename T>
+static void countTail(Histogram* h, const T* src, int stride, int width, int rowBegin, int rowEnd, bool skipZero)
+{
+	int offset = h->offset, last = h->size - 1;
+	int subSize = h->size < h->subBins ? h->size : h->subBins;
+	for (int i = rowBegin; i < rowEnd; i++)
+	{
+		const T* row = src + i * stride;
+		for (int j = 0; j < width; j++)
+		{
+			if (skipZero && row[j] == 0)
+			{
+				continue;
+			}
+			int bin = valueOf(row[j]) - offset;
+			bin = bin < 0 ? 0 : (bin > last ? last : bin);
+			if (bin >= subSize)
+			{
+				h->bins[bin]++;
+			}
+		}
+	}
+}
+
+static HistogramBand* beginBand(Histogram* h, int band, const void* src, int stride, int width, int rowBegin, int rowEnd, bool absolute)
+{
+	HistogramBand* b = &h->bands[band];
+	b->src = src;
+	b->stride = stride;
+	b->width = width;
+	b->rowBegin = rowBegin;
+	b->rowEnd = rowEnd;
+	b->absolute = absolute;
+
+	int subSize = h->size < h->subBins ? h->size : h->subBins;
+	memset(h->sub + band * h->subBins, 0, subSize * sizeof(int));
+	return b;
+}
+
+void histogramCountDepth(Histogram* h, int band, const ushort* src, int stride, int width, int rowBegin, int rowEnd)
+{
+	HistogramBand* b = beginBand(h, band, src, stride, width, rowBegin, rowEnd, false);
+	b->tailNum = countRows(h, src, stride, width, rowBegin, rowEnd, h->sub + band * h->subBins, h->tail + band * h->tailCapacity, true);
+}
+
+void histogramCountAbs(Histogram* h, int band, const int* src, int stride, int width, int rowBegin, int rowEnd)
+{
+	HistogramBand* b = beginBand(h, band, src, stride, width, rowBegin, rowEnd, true);
+	b->tailNum = countRows(h, src, stride, width, rowBegin, rowEnd, h->sub + band * h->subBins, h->tail + band * h->tailCapacity, false);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//merge
+
+//bins[b] = sum of the sub-histograms up to b, for b < size
+static void mergePrefixScalar(const int* sub, int subBins, int bandNum, int* bins, int size)
+{
+	int sum = 0;
+	for (int b = 0; b < size; b++)
+	{
+		for (int band = 0; band < bandNum; band++)
+		{
+			sum += sub[band * subBins + b];
+		}
+		bins[b] = sum;
+	}
+}
+
+#ifdef SIMD_X86
+SIMD_TARGET_SSE2 static void mergePrefixSSE2(const int* sub, int subBins, int bandNum, int* bins, int size)
+{
+	__m128i carry = _mm_setzero_si128();
+	int b = 0;
+	for (; b + 4 <= size; b += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(sub + b));
+		for (int band = 1; band < bandNum; band++)
+		{
+			v = _mm_add_epi32(v, _mm_loadu_si128((const __m128i*)(sub + band * subBins + b)));
+		}
+		//prefix sum of the 4 lanes, then the total so far
+		v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+		v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+		v = _mm_add_epi32(v, carry);
+		_mm_storeu_si128((__m128i*)(bins + b), v);
+		carry = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+
+	int sum = b > 0 ? bins[b - 1] : 0;
+	for (; b < size; b++)
+	{
+		for (int band = 0; band < bandNum; band++)
+		{
+			sum += sub[band * subBins + b];
+		}
+		bins[b] = sum;
+	}
+}
+#endif
+
+void histogramMerge(Histogram* h)
+{
+	int subSize = h->size < h->subBins ? h->size : h->subBins;
+#ifdef SIMD_X86
+	if (h->simdLevel >= SimdSSE2)
+	{
+		mergePrefixSSE2(h->sub, h->subBins, h->bandNum, h->bins, subSize);
+	}
+	else
+#endif
+	{
+		mergePrefixScalar(h->sub, h->subBins, h->bandNum, h->bins, subSize);
+	}
+
+	if (subSize < h->size)
+	{
+		for (int band = 0; band < h->bandNum; band++)
+		{
+			const HistogramBand* b = &h->bands[band];
+			if (b->tailNum >= 0)
+			{
+				const int* tail = h->tail + band * h->tailCapacity;
+				for (int t = 0; t < b->tailNum; t++)
+				{
+					h->bins[tail[t]]++;
+				}
+			}
+			else if (b->absolute)
+			{
+				countTail(h, (const int*)b->src, b->stride, b->width, b->rowBegin, b->rowEnd, false);
+			}
+			else
+			{
+				countTail(h, (const ushort*)b->src, b->stride, b->width, b->rowBegin, b->rowEnd, true);
+			}
+		}
+
+		for (int b = subSize; b < h->size; b++)
+		{
+			h->bins[b] += h->bins[b - 1];
+		}
+	}
+
+	h->points = h->bins[h->size - 1];
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//lut
+
+void histogramLutEqualize(Histogram* h)
+{
+	int points = h->points;
+	for (int b = 0; b < h->size; b++)
+	{
+		h->lut[b] = points > 0 ? (byte)(int)(256 * ((double)h->bins[b] / (double)points) + 0.5) : 0;
+	}
+}
+
+void histogramLutNearBright(Histogram* h)
+{
+	int points = h->points;
+	for (int b = 0; b < h->size; b++)
+	{
+		h->lut[b] = points > 0 ? (byte)(256LL * (points - h->bins[b]) / points) : 0;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//colorize, scalar
+
+static void colorizeDepthRowsScalar(const ushort* src, int depthStride, const byte* lut, int lutSize, byte* dst, int pixelStride,
+									int width, int rowBegin, int rowEnd)
+{
+	for (int i = rowBegin; i < rowEnd; i++)
+	{
+		const ushort* s = src + i * depthStride;
+		byte* d = dst + i * pixelStride;
+		for (int j = 0; j < width; j++, d += 3)
+		{
+			d[0] = d[1] = d[2] = lut[s[j] < lutSize ? s[j] : lutSize - 1];
+		}
+	}
+}
+
+static void colorizeDerivativeRowsScalar(const int* hDerivative, int depthStride, const byte* overlay, const byte* lut, int offset, int lutSize,
+										 byte* dst, int pixelStride, int width, int rowBegin, int rowEnd)
+{
+	for (int i = rowBegin; i < rowEnd; i++)
+	{
+		const int* h = hDerivative + i * depthStride;
+		const byte* o = overlay + i * pixelStride;
+		byte* d = dst + i * pixelStride;
+		for (int j = 0; j < width; j++, o += 3, d += 3)
+		{
+			if (o[0] == 255 || o[1] == 255 || o[2] == 255)
+			{
+				d[0] = o[0];
+				d[1] = o[1];
+				d[2] = o[2];
+				continue;
+			}
+
+			//the lut may be older than the derivative, so clamp to its range
+			int index = (h[j] < 0 ? -h[j] : h[j]) - offset;
+			byte v = lut[index < 0 ? 0 : (index >= lutSize ? lutSize - 1 : index)];
+			d[0] = h[j] < 0 ? v : 0;
+			d[1] = o[1];
+			d[2] = h[j] < 0 ? 0 : v;
+		}
+	}
+}
+
+static void colorizeTableRowsScalar(const ushort* depth, const ushort* calibration, const byte* noise, int depthStride, int noise4, int finger4,
+									byte* dst, int pixelStride, int width, int rowBegin, int rowEnd)
+{
+	for (int i = rowBegin; i < rowEnd; i++)
+	{
+		const ushort* s = depth + i * depthStride;
+		const ushort* c = calibration + i * depthStride;
+		const byte* n = noise != NULL ? noise + i * depthStride : NULL;
+		byte* d = dst + i * pixelStride;
+		for (int j = 0; j < width; j++, d += 3)
+		{
+			int dist = (int)c[j] - ((int)s[j] << 2);
+			int pixelNoise4 = n != NULL ? n[j] : noise4;
+			d[0] = d[1] = d[2] = 0;
+			if (dist < pixelNoise4) d[2] = 255;			//too near
+			else if (dist < finger4) d[0] = 255;		//finger
+			else d[1] = 255;							//too far
+		}
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//colorize, AVX2: 16 pixels at a time, two gathers of 8 lut entries, then a byte shuffle to RGB24
+
+#ifdef SIMD_HAVE_AVX2
+
+//RGB24 <-> planes of 16 bytes: byte k of chunk c of the pixels holds channel (16c + k) % 3 of pixel (16c + k) / 3
+static const signed char interleaveMasks[3][3][16] =
+{
+	{ { 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5 },
+	  { -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1 },
+	  { -1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1 } },
+	{ { -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1 },
+	  { 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10 },
+	  { -1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1 } },
+	{ { -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1 },
+	  { -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1 },
+	  { 10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15 } }
+};
+
+static const signed char deinterleaveMasks[3][3][16] =
+{
+	{ { 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	  { -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1 },
+	  { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13 } },
+	{ { 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	  { -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1 },
+	  { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14 } },
+	{ { 2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	  { -1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1 },
+	  { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15 } }
+};
+
+#define shuffleMask(masks, a, b) _mm_loadu_si128((const __m128i*)(masks)[a][b])
+
+SIMD_TARGET_AVX2 static inline void storeRgb(byte* dst, __m128i c0, __m128i c1, __m128i c2)
+{
+	for (int chunk = 0; chunk < 3; chunk++)
+	{
+		__m128i v = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, shuffleMask(interleaveMasks, chunk, 0)),
+											  _mm_shuffle_epi8(c1, shuffleMask(interleaveMasks, chunk, 1))),
+								 _mm_shuffle_epi8(c2, shuffleMask(interleaveMasks, chunk, 2)));
+		_mm_storeu_si128((__m128i*)(dst + 16 * chunk), v);
+	}
+}
+
+SIMD_TARGET_AVX2 static inline __m128i loadChannel(const byte* src, int channel)
+{
+	__m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)src), shuffleMask(deinterleaveMasks, channel, 0));
+	v = _mm_or_si128(v, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 16)), shuffleMask(deinterleaveMasks, channel, 1)));
+	return _mm_or_si128(v, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 32)), shuffleMask(deinterleaveMasks, channel, 2)));
+}
+
+//16 bytes from two vectors of 8 ints in [0, 255]
+SIMD_TARGET_AVX2 static inline __m128i packValues(__m256i a, __m256i b)
+{
+	__m128i lo = _mm_packs_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1));
+	__m128i hi = _mm_packs_epi32(_mm256_castsi256_si128(b), _mm256_extracti128_si256(b, 1));
+	return _mm_packus_epi16(lo, hi);
+}
+
+//16 byte masks from two vectors of 8 int masks
+SIMD_TARGET_AVX2 static inline __m128i packMasks(__m256i a, __m256i b)
+{
+	__m128i lo = _mm_packs_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1));
+	__m128i hi = _mm_packs_epi32(_mm256_castsi256_si128(b), _mm256_extracti128_si256(b, 1));
+	return _mm_packs_epi16(lo, hi);
+}
+
+//lut entries at 8 indices, the gather reads 4 bytes at each
+SIMD_TARGET_AVX2 static inline __m256i gatherLut(const byte* lut, __m256i index)
+{
+	return _mm256_and_si256(_mm256_i32gather_epi32((const int*)lut, index, 1), _mm256_set1_epi32(0xFF));
+}
+
+SIMD_TARGET_AVX2 static void colorizeDepthRowsAVX2(const ushort* src, int depthStride, const byte* lut, int lutSize, byte* dst, int pixelStride,
+												   int width, int rowBegin, int rowEnd)
+{
+	const __m256i last = _mm256_set1_epi32(lutSize - 1);
+	for (int i = rowBegin; i < rowEnd; i++)
+	{
+		const ushort* s = src + i * depthStride;
+		byte* d = dst + i * pixelStride;
+		int j = 0;
+		for (; j + 16 <= width; j += 16)
+		{
+			__m256i i0 = _mm256_min_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(s + j))), last);
+			__m256i i1 = _mm256_min_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(s + j + 8))), last);
+			__m128i gray = packValues(gatherLut(lut, i0), gatherLut(lut, i1));
+			storeRgb(d + 3 * j, gray, gray, gray);
+		}
+		colorizeDepthRowsScalar(s + j, 0, lut, lutSize, d + 3 * j, 0, width - j, 0, 1);
+	}
+}
+
+SIMD_TARGET_AVX2 static void colorizeDerivativeRowsAVX2(const int* hDerivative, int depthStride, const byte* overlay, const byte* lut, int offset, int lutSize,
+														byte* dst, int pixelStride, int width, int rowBegin, int rowEnd)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i offsetLanes = _mm256_set1_epi32(offset);
+	const __m256i last = _mm256_set1_epi32(lutSize - 1);
+	const __m128i full = _mm_set1_epi8((char)255);
+	for (int i = rowBegin; i < rowEnd; i++)
+	{
+		const int* h = hDerivative + i * depthStride;
+		const byte* o = overlay + i * pixelStride;
+		byte* d = dst + i * pixelStride;
+		int j = 0;
+		for (; j + 16 <= width; j += 16)
+		{
+			__m256i h0 = _mm256_loadu_si256((const __m256i*)(h + j));
+			__m256i h1 = _mm256_loadu_si256((const __m256i*)(h + j + 8));
+			__m256i i0 = _mm256_min_epi32(_mm256_max_epi32(_mm256_sub_epi32(_mm256_abs_epi32(h0), offsetLanes), zero), last);
+			__m256i i1 = _mm256_min_epi32(_mm256_max_epi32(_mm256_sub_epi32(_mm256_abs_epi32(h1), offsetLanes), zero), last);
+			__m128i v = packValues(gatherLut(lut, i0), gatherLut(lut, i1));
+			__m128i negative = packMasks(_mm256_cmpgt_epi32(zero, h0), _mm256_cmpgt_epi32(zero, h1));
+
+			__m128i o0 = loadChannel(o + 3 * j, 0), o1 = loadChannel(o + 3 * j, 1), o2 = loadChannel(o + 3 * j, 2);
+			__m128i isOverlay = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(o0, full), _mm_cmpeq_epi8(o1, full)), _mm_cmpeq_epi8(o2, full));
+			__m128i c0 = _mm_blendv_epi8(_mm_and_si128(negative, v), o0, isOverlay);
+			__m128i c2 = _mm_blendv_epi8(_mm_andnot_si128(negative, v), o2, isOverlay);
+			storeRgb(d + 3 * j, c0, o1, c2);
+		}
+		colorizeDerivativeRowsScalar(h + j, 0, o + 3 * j, lut, offset, lutSize, d + 3 * j, 0, width - j, 0, 1);
+	}
+}
+
+SIMD_TARGET_AVX2 static void colorizeTableRowsAVX2(const ushort* depth, const ushort* calibration, const byte* noise, int depthStride, int noise4, int finger4,
+												   byte* dst, int pixelStride, int width, int rowBegin, int rowEnd)
+{
+	const __m256i finger = _mm256_set1_epi32(finger4);
+	const __m128i full = _mm_set1_epi8((char)255);
+	__m256i n0 = _mm256_set1_epi32(noise4), n1 = n0;
+	for (int i = rowBegin; i < rowEnd; i++)
+	{
+		const ushort* s = depth + i * depthStride;
+		const ushort* c = calibration + i * depthStride;
+		const byte* n = noise != NULL ? noise + i * depthStride : NULL;
+		byte* d = dst + i * pixelStride;
+		int j = 0;
+		for (; j + 16 <= width; j += 16)
+		{
+			__m256i dist0 = _mm256_sub_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(c + j))),
+											 _mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(s + j))), 2));
+			__m256i dist1 = _mm256_sub_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(c + j + 8))),
+											 _mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(s + j + 8))), 2));
+			if (n != NULL)
+			{
+				__m128i nb = _mm_loadu_si128((const __m128i*)(n + j));
+				n0 = _mm256_cvtepu8_epi32(nb);
+				n1 = _mm256_cvtepu8_epi32(_mm_srli_si128(nb, 8));
+			}
+
+			__m128i nearMask = packMasks(_mm256_cmpgt_epi32(n0, dist0), _mm256_cmpgt_epi32(n1, dist1));
+			__m128i fingerMask = _mm_andnot_si128(nearMask, packMasks(_mm256_cmpgt_epi32(finger, dist0), _mm256_cmpgt_epi32(finger, dist1)));
+			__m128i farMask = _mm_andnot_si128(_mm_or_si128(nearMask, fingerMask), full);
+			storeRgb(d + 3 * j, fingerMask, farMask, nearMask);
+		}
+		colorizeTableRowsScalar(s + j, c + j, n != NULL ? n + j : NULL, 0, noise4, finger4, d + 3 * j, 0, width - j, 0, 1);
+	}
+}
+
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+
+void colorizeDepthRows(SimdLevel level, const ushort* src, int depthStride, const byte* lut, int lutSize, byte* dst, int pixelStride,
+					   int width, int rowBegin, int rowEnd)
+{
+#ifdef SIMD_HAVE_AVX2
+	if (level >= SimdAVX2)
+	{
+		colorizeDepthRowsAVX2(src, depthStride, lut, lutSize, dst, pixelStride, width, rowBegin, rowEnd);
+		return;
+	}
+#endif
+	colorizeDepthRowsScalar(src, depthStride, lut, lutSize, dst, pixelStride, width, rowBegin, rowEnd);
+}
+
+void colorizeDerivativeRows(SimdLevel level, const int* hDerivative, int depthStride, const byte* overlay, const byte* lut, int offset, int lutSize,
+							byte* dst, int pixelStride, int width, int rowBegin, int rowEnd)
+{
+#ifdef SIMD_HAVE_AVX2
+	if (level >= SimdAVX2)
+	{
+		colorizeDerivativeRowsAVX2(hDerivative, depthStride, overlay, lut, offset, lutSize, dst, pixelStride, width, rowBegin, rowEnd);
+		return;
+	}
+#endif
+	colorizeDerivativeRowsScalar(hDerivative, depthStride, overlay, lut, offset, lutSize, dst, pixelStride, width, rowBegin, rowEnd);
+}
+
+void colorizeTableRows(SimdLevel level, const ushort* depth, const ushort* calibration, const byte* noise, int depthStride, int noise4, int finger4,
+					   byte* dst, int pixelStride, int width, int rowBegin, int rowEnd)
+{
+#ifdef SIMD_HAVE_AVX2
+	if (level >= SimdAVX2)
+	{
+		colorizeTableRowsAVX2(depth, calibration, noise, depthStride, noise4, finger4, dst, pixelStride, width, rowBegin, rowEnd);
+		return;
+	}
+#endif
+	colorizeTableRowsScalar(depth, calibration, noise, depthStride, noise4, finger4, dst, pixelStride, width, rowBegin, rowEnd);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//the display paths of the server
+
+typedef struct DepthHistogram
+{
+	int width, height, depthStride;
+	int deviceMaxDepth;
+	ThreadPool* threadPool;
+	Histogram histogram;		//of the depth, every value gets a bin of the sub-histograms
+	byte* arena;
+} DepthHistogram;
+
+typedef struct DisplayJob
+{
+	DepthHistogram* d;
+	const ushort* srcDepthPtr;
+	const ushort* calibrationPtr;
+	const byte* noisePtr;
+	int noise4, finger4;
+	byte* dstPixelPtr;
+	int pixelStride;
+} DisplayJob;
+
+static void bandRows(const DepthHistogram* d, int band, int& rowBegin, int& rowEnd)
+{
+	rowBegin = d->height * band / d->histogram.bandNum;
+	rowEnd = d->height * (band + 1) / d->histogram.bandNum;
+}
+
+static void countTask(void* arg, int band)
+{
+	DisplayJob* job = (DisplayJob*)arg;
+	DepthHistogram* d = job->d;
+	int rowBegin, rowEnd;
+	bandRows(d, band, rowBegin, rowEnd);
+	histogramCountDepth(&d->histogram, band, job->srcDepthPtr, d->depthStride, d->width, rowBegin, rowEnd);
+}
+
+static void colorizeTask(void* arg, int band)
+{
+	DisplayJob* job = (DisplayJob*)arg;
+	DepthHistogram* d = job->d;
+	const Histogram* h = &d->histogram;
+	int rowBegin, rowEnd;
+	bandRows(d, band, rowBegin, rowEnd);
+	if (job->calibrationPtr != NULL)
+	{
+		colorizeTableRows(h->simdLevel, job->srcDepthPtr, job->calibrationPtr, job->noisePtr, d->depthStride, job->noise4, job->finger4,
+						  job->dstPixelPtr, job->pixelStride, d->width, rowBegin, rowEnd);
+	}
+	else
+	{
+		colorizeDepthRows(h->simdLevel, job->srcDepthPtr, d->depthStride, h->lut, d->deviceMaxDepth, job->dstPixelPtr, job->pixelStride, d->width, rowBegin, rowEnd);
+	}
+}
+
+DLL_EXPORT void* depthHistogramCreate(int width, int height, int depthStride, int deviceMaxDepth, int threadNum)
+{
+	if (width <= 0 || height <= 0 || deviceMaxDepth <= 0)
+	{
+		return NULL;
+	}
+
+	DepthHistogram* d = new DepthHistogram();
+	d->width = width;
+	d->height = height;
+	d->depthStride = depthStride;
+	d->deviceMaxDepth = deviceMaxDepth;
+	d->threadPool = threadPoolCreate(threadNum > 0 ? threadNum : cpuCount());
+	int bandNum = threadPoolSize(d->threadPool) < height ? threadPoolSize(d->threadPool) : height;
+	histogramInit(&d->histogram, simdDetect(), deviceMaxDepth, deviceMaxDepth, 0, bandNum);
+
+	Arena arena = { NULL, 0 };
+	carveHistogram(&d->histogram, &arena);
+	d->arena = arenaAllocate(&arena);
+	if (d->arena == NULL)
+	{
+		threadPoolDestroy(d->threadPool);
+		delete d;
+		return NULL;
+	}
+	carveHistogram(&d->histogram, &arena);
+
+	return d;
+}
+
+proc_m depthHistogramDestroy(void* histogram)
+{
+	DepthHistogram* d = (DepthHistogram*)histogram;
+	if (d == NULL)
+	{
+		return 0;
+	}
+
+	threadPoolDestroy(d->threadPool);
+	arenaFree(d->arena);
+	delete d;
+
+	return 0;
+}
+
+proc_m depthHistogramUpdate(void* histogram, ushort* srcDepthPtr)
+{
+	DepthHistogram* d = (DepthHistogram*)histogram;
+	Histogram* h = &d->histogram;
+	DisplayJob job = { d, srcDepthPtr, NULL, NULL, 0, 0, NULL, 0 };
+
+	histogramBegin(h, 0, d->deviceMaxDepth);
+	threadPoolRun(d->threadPool, countTask, &job, h->bandNum);
+	histogramMerge(h);
+	histogramLutNearBright(h);
+
+	return h->points;
+}
+
+proc_m depthHistogramColorize(void* histogram, ushort* srcDepthPtr, byte* dstPixelPtr, int pixelStride)
+{
+	DepthHistogram* d = (DepthHistogram*)histogram;
+	DisplayJob job = { d, srcDepthPtr, NULL, NULL, 0, 0, dstPixelPtr, pixelStride };
+	threadPoolRun(d->threadPool, colorizeTask, &job, d->histogram.bandNum);
+	return 0;
+}
+
+proc_m depthHistogramColorizeTable(void* histogram, ushort* srcDepthPtr, ushort* calibrationPtr, byte* noisePtr,
+								   double noiseThreshold, double fingerThreshold, byte* dstPixelPtr, int pixelStride)
+{
+	DepthHistogram* d = (DepthHistogram*)histogram;
+	//the same rounding as touchPipelineWork, distances are integers in Q14.2
+	int noise4 = (int)ceil(noiseThreshold * 4);
+	int finger4 = (int)ceil(fingerThreshold * 4);
+	DisplayJob job = { d, srcDepthPtr, calibrationPtr, noisePtr, noise4, finger4, dstPixelPtr, pixelStride };
+	threadPoolRun(d->threadPool, colorizeTask, &job, d->histogram.bandNum);
+	return 0;
+}
@@ -0,0 +1,85 @@
+#ifndef _HISTOGRAM_H_
+#define _HISTOGRAM_H_
+
+#include "depth.h"
+#include "simd.h"
+#include "arena.h"
+
+//Histogram equalization for the display images: the depth view of NuiSensor, the table view of MultiTouchTracker
+//and the derivative image of generateOutputImage.
+//	count		every band of rows counts into a sub-histogram of its own, so the bands share nothing. The sub-histograms
+//				cover the first subBins bins, the rare values past them go to a tail buffer of the band
+//	merge		adds the sub-histograms up and prefix sums them (SSE2), then adds the tails
+//	lut			the cumulative counts become a byte lookup table
+//	colorize	lut gather and RGB interleave of whole rows (AVX2)
+//A band whose tail buffer overflows is counted again serially by the merge, so any distribution gives exact counts.
+
+#define HISTOGRAM_LUT_PADDING 4		//the AVX2 gather reads 4 bytes at every lut entry
+
+typedef struct HistogramBand
+{
+	const void* src;			//the rows the band counted, for a rescan of the tail
+	int stride, width, rowBegin, rowEnd;
+	bool absolute;				//int values counted by magnitude, otherwise ushort depth without the zeros
+	int tailNum;				//-1 after an overflow
+} HistogramBand;
+
+typedef struct Histogram
+{
+	int maxBins;
+	int subBins;				//of every sub-histogram
+	int tailCapacity;			//values per band
+	int bandNum;
+	SimdLevel simdLevel;
+
+	HistogramBand* bands;
+	int* sub;					//subBins per band
+	int* tail;					//tailCapacity per band, bins past subBins
+	int* bins;					//cumulative after histogramMerge
+	byte* lut;					//maxBins + HISTOGRAM_LUT_PADDING
+
+	int offset, size;			//of the histogram being built: bin b counts the value offset + b, size 0 before the first one
+	int points;					//values counted
+} Histogram;
+
+void histogramInit(Histogram* h, SimdLevel level, int maxBins, int subBins, int tailCapacity, int bandNum);
+void carveHistogram(Histogram* h, Arena* arena);
+
+//starts a histogram of the values [offset, offset + size), size <= maxBins. Values outside count in the first / last bin.
+void histogramBegin(Histogram* h, int offset, int size);
+//rows [rowBegin, rowEnd) into the sub-histogram of band, bands can count at the same time
+void histogramCountDepth(Histogram* h, int band, const ushort* src, int stride, int width, int rowBegin, int rowEnd);
+void histogramCountAbs(Histogram* h, int band, const int* src, int stride, int width, int rowBegin, int rowEnd);
+//after every band counted: cumulative bins and points
+void histogramMerge(Histogram* h);
+
+//lut[b] = round(256 * bins[b] / points), 256 wraps to 0 like the old int to byte store of generateOutputImage
+void histogramLutEqualize(Histogram* h);
+//lut[b] = 256 * (points - bins[b]) / points, near is bright, 0 for no reading: the depth view of the OpenNI samples
+void histogramLutNearBright(Histogram* h);
+
+//gray RGB24 rows from depth, values past the lut take its last entry
+void colorizeDepthRows(SimdLevel level, const ushort* src, int depthStride, const byte* lut, int lutSize, byte* dst, int pixelStride,
+					   int width, int rowBegin, int rowEnd);
+//the derivative image: overlay pixels with a 255 channel are copied, other pixels get lut(|h|) in the first channel
+//when h < 0, in the third otherwise, and the overlay's second channel. lut covers |h| in [offset, offset + lutSize).
+void colorizeDerivativeRows(SimdLevel level, const int* hDerivative, int depthStride, const byte* overlay, const byte* lut, int offset, int lutSize,
+							byte* dst, int pixelStride, int width, int rowBegin, int rowEnd);
+//the calibrated table: third channel when table - depth < noise, first when < finger, second otherwise. calibration
+//and noise are in the Q14.2 / Q6.2 formats of backgroundModel.h, noise is optional and replaces noise4.
+void colorizeTableRows(SimdLevel level, const ushort* depth, const ushort* calibration, const byte* noise, int depthStride, int noise4, int finger4,
+					   byte* dst, int pixelStride, int width, int rowBegin, int rowEnd);
+
+//the display paths of the server, parallel over a pool of their own
+DLL_EXPORT void* depthHistogramCreate(int width, int height, int depthStride, int deviceMaxDepth, int threadNum);
+proc_m depthHistogramDestroy(void* histogram);
+//counts the frame and rebuilds the near is bright lut, returns the num of pixels with a reading
+proc_m depthHistogramUpdate(void* histogram, ushort* srcDepthPtr);
+//gray image of the frame with the lut of the last update
+proc_m depthHistogramColorize(void* histogram, ushort* srcDepthPtr, byte* dstPixelPtr, int pixelStride);
+//the table view: calibrationPtr / noisePtr from backgroundModelGetMaps, noisePtr optional. Without a calibration
+//(calibrationPtr NULL) the same as depthHistogramColorize.
+proc_m depthHistogramColorizeTable(void* histogram, ushort* srcDepthPtr, ushort* calibrationPtr, byte* noisePtr,
+								   double noiseThreshold, double fingerThreshold, byte* dstPixelPtr, int pixelStride);
+
+#endif
@@ -0,0 +1,290 @@
+#include "labeller.h"
+#include "arena.h"
+#include <memory.h>
+
+static const bitword allOnes = ~(bitword)0;
+
+static void carveLabeller(Labeller* labeller, Arena* arena)
+{
+	int maxRuns = (labeller->width + 1) / 2;
+
+	labeller->parent = arenaNew(arena, int, labeller->maxLabels + 1);
+	labeller->remap = arenaNew(arena, int, labeller->maxLabels + 1);
+	labeller->moments = arenaNew(arena, BlobMoments, labeller->maxLabels + 1);
+	labeller->runs[0] = arenaNew(arena, Run, maxRuns);
+	labeller->runs[1] = arenaNew(arena, Run, maxRuns);
+	labeller->packedRow = arenaNew(arena, bitword, packedStride(labeller->width));
+}
+
+Labeller* labellerCreate(int width, int height)
+{
+	Labeller* labeller = new Labeller();
+	labeller->width = width;
+	labeller->height = height;
+	labeller->maxLabels = ((width + 1) / 2) * ((height + 1) / 2);
+
+	Arena arena = { NULL, 0 };
+	carveLabeller(labeller, &arena);	//measure
+	labeller->arena = arenaAllocate(&arena);
+	if (labeller->arena == NULL)
+	{
+		delete labeller;
+		return NULL;
+	}
+	carveLabeller(labeller, &arena);
+
+	labellerBegin(labeller);
+	return labeller;
+}
+
+void labellerDestroy(Labeller* labeller)
+{
+	if (labeller == NULL)
+	{
+		return;
+	}
+
+	arenaFree(labeller->arena);
+	delete labeller;
+}
+
+void labellerBegin(Labeller* labeller)
+{
+	labeller->labelNum = 0;
+	labeller->full = false;
+	labeller->runNum[0] = labeller->runNum[1] = 0;
+	labeller->currRuns = 0;
+}
+
+static int findRoot(int* parent, int label)
+{
+	while (parent[label] != label)
+	{
+		parent[label] = parent[parent[label]];	//path halving
+		label = parent[label];
+	}
+	return label;
+}
+
+static int unite(int* parent, int a, int b)
+{
+	a = findRoot(parent, a);
+	b = findRoot(parent, b);
+	if (a < b)
+	{
+		parent[b] = a;
+		return a;
+	}
+	parent[a] = b;
+	return b;
+}
+
+//first column >= pos whose bit equals value, or packedStride(width) * 64 if there is none
+static int nextBit(const bitword* row, int words, int pos, bool value)
+{
+	int w = pos >> 6;
+	if (w >= words)
+	{
+		return words * 64;
+	}
+
+	bitword bits = (value ? row[w] : ~row[w]) & (allOnes << (pos & 63));
+	while (bits == 0)
+	{
+		if (++w >= words)
+		{
+			return words * 64;
+		}
+		bits = value ? row[w] : ~row[w];
+	}
+	return w * 64 + lowestBit(bits);
+}
+
+int labellerAddRow(Labeller* labeller, const bitword* packedRow, int row, int* labelRow)
+{
+	int width = labeller->width;
+	int words = packedStride(width);
+	if (labeller->full)
+	{
+		return -1;
+	}
+
+	labeller->currRuns ^= 1;
+	Run* prevRuns = labeller->runs[labeller->currRuns ^ 1];
+	int prevNum = row == 0 ? 0 : labeller->runNum[labeller->currRuns ^ 1];
+	Run* currRuns = labeller->runs[labeller->currRuns];
+	int currNum = 0;
+
+	if (labelRow != NULL)
+	{
+		memset(labelRow, 0, width * sizeof(int));
+	}
+
+	int prevIndex = 0;
+	for (int pos = 0; ; )
+	{
+		int left = nextBit(packedRow, words, pos, true);
+		if (left >= width)
+		{
+			break;
+		}
+		int right = nextBit(packedRow, words, left, false) - 1;	//the padding bits are 0, so this stops at width - 1
+		pos = right + 1;
+
+		//8-connected: previous runs touching [left - 1, right + 1]
+		while (prevIndex < prevNum && prevRuns[prevIndex].right < left - 1)
+		{
+			prevIndex++;
+		}
+
+		int label = 0;
+		for (int k = prevIndex; k < prevNum && prevRuns[k].left <= right + 1; k++)
+		{
+			label = label == 0 ? findRoot(labeller->parent, prevRuns[k].label) : unite(labeller->parent, label, prevRuns[k].label);
+		}
+
+		BlobMoments* m;
+		if (label == 0)
+		{
+			if (labeller->labelNum >= labeller->maxLabels)
+			{
+				//maxLabels bounds the runs that start a label, the check keeps a frame that beats it off the tables
+				labeller->full = true;
+				labeller->runNum[labeller->currRuns] = currNum;
+				return -1;
+			}
+			label = ++labeller->labelNum;
+			labeller->parent[label] = label;
+
+			m = &labeller->moments[label];
+			m->area = m->sumX = m->sumY = 0;
+			m->minX = left;
+			m->maxX = right;
+			m->minY = m->maxY = row;
+		}
+		else
+		{
+			m = &labeller->moments[label];
+			if (left < m->minX) m->minX = left;
+			if (right > m->maxX) m->maxX = right;
+			if (row > m->maxY) m->maxY = row;
+		}
+
+		int length = right - left + 1;
+		m->area += length;
+		m->sumX += (left + right) * length / 2;
+		m->sumY += row * length;
+
+		Run run = { left, right, label };
+		currRuns[currNum++] = run;
+
+		if (labelRow != NULL)
+		{
+			for (int j = left; j <= right; j++)
+			{
+				labelRow[j] = label;
+			}
+		}
+	}
+
+	labeller->runNum[labeller->currRuns] = currNum;
+	return 0;
+}
+
+int labellerAddByteRow(Labeller* labeller, const byte* row, int rowIndex, int* labelRow)
+{
+	packRows(row, labeller->packedRow, labeller->width, 0, 1, 0);
+	return labellerAddRow(labeller, labeller->packedRow, rowIndex, labelRow);
+}
+
+int labellerFinish(Labeller* labeller, int maxNum, int minArea, int* resultPtr, BlobMoments* momentsPtr)
+{
+	if (labeller->full)
+	{
+		return -1;
+	}
+
+	int* parent = labeller->parent;
+	BlobMoments* moments = labeller->moments;
+
+	//merge the moments of every provisional label into its root. Roots are the smallest label of their set,
+	//so going up flattens the tree as well: parent[parent[l]] is already a root.
+	for (int l = 1; l <= labeller->labelNum; l++)
+	{
+		int root = parent[parent[l]];
+		parent[l] = root;
+		if (root == l)
+		{
+			continue;
+		}
+
+		BlobMoments* m = &moments[l];
+		BlobMoments* r = &moments[root];
+		r->area += m->area;
+		r->sumX += m->sumX;
+		r->sumY += m->sumY;
+		if (m->minX < r->minX) r->minX = m->minX;
+		if (m->maxX > r->maxX) r->maxX = m->maxX;
+		if (m->minY < r->minY) r->minY = m->minY;
+		if (m->maxY > r->maxY) r->maxY = m->maxY;
+	}
+
+	//partial selection of the maxNum biggest roots, remap is free to use until the final labels are assigned
+	int* selected = labeller->remap;
+	int selectedNum = 0;
+	for (int l = 1; l <= labeller->labelNum; l++)
+	{
+		int area = moments[l].area;
+		if (parent[l] != l || area < minArea || maxNum <= 0)
+		{
+			continue;
+		}
+
+		if (selectedNum == maxNum && area <= moments[selected[selectedNum - 1]].area)
+		{
+			continue;
+		}
+
+		int p = selectedNum < maxNum ? selectedNum++ : maxNum - 1;
+		while (p > 0 && moments[selected[p - 1]].area < area)	//strictly less: ties stay in scan order
+		{
+			selected[p] = selected[p - 1];
+			p--;
+		}
+		selected[p] = l;
+	}
+
+	for (int pi = 0; pi < selectedNum; pi++)
+	{
+		BlobMoments* m = &moments[selected[pi]];
+		resultPtr[2 * pi] = m->sumX / m->area;
+		resultPtr[2 * pi + 1] = m->sumY / m->area;
+		if (momentsPtr != NULL)
+		{
+			momentsPtr[pi] = *m;
+		}
+	}
+
+	//final labels in scan order
+	int* remap = labeller->remap;
+	int finalNum = 0;
+	remap[0] = 0;
+	for (int l = 1; l <= labeller->labelNum; l++)
+	{
+		remap[l] = parent[l] == l ? ++finalNum : remap[parent[l]];
+	}
+
+	return selectedNum;
+}
+
+void labellerRelabel(Labeller* labeller, int* labelPtr, int height, int stride)
+{
+	for (int i = 0; i < height; i++)
+	{
+		int* row = labelPtr + i * stride;
+		for (int j = 0; j < labeller->width; j++)
+		{
+			row[j] = labeller->remap[row[j]];
+		}
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef _LABELLER_H_
+#define _LABELLER_H_
+
+#include "packedMorphological.h"
+
+//Streaming 8-connected component labelling over runs of packed rows, with union-find on provisional labels.
+//Every table is allocated once in labellerCreate, a frame doesn't allocate anything:
+//	labellerBegin, then labellerAddRow for rows 0, 1, 2, ... in order, then labellerFinish.
+//Each provisional label keeps running moments (area, sum x, sum y, bounding box), merged into the root at the end.
+
+typedef struct BlobMoments
+{
+	int area;
+	int sumX, sumY;
+	int minX, minY, maxX, maxY;
+} BlobMoments;
+
+typedef struct Run
+{
+	int left, right;			//inclusive columns
+	int label;
+} Run;
+
+typedef struct Labeller
+{
+	int width, height;
+	int maxLabels;				//a new label needs its own 2x2 cell, so at most ceil(w/2) * ceil(h/2)
+	int labelNum;				//provisional labels in use, 0 is background
+	bool full;					//a row needed a label past maxLabels, the frame is lost
+
+	int* parent;				//union-find, the root of a set is always its smallest label
+	int* remap;					//provisional label -> final label, filled by labellerFinish
+	BlobMoments* moments;
+	Run* runs[2];				//runs of the previous and the current row
+	int runNum[2];
+	int currRuns;				//index of the current row in runs
+	bitword* packedRow;			//scratch for byte rows
+
+	byte* arena;
+} Labeller;
+
+Labeller* labellerCreate(int width, int height);
+void labellerDestroy(Labeller* labeller);
+
+void labellerBegin(Labeller* labeller);
+//labelRow (optional) receives the provisional labels of the row, use labellerRelabel after finishing.
+//Returns -1 when the label table is full, the rest of the frame is ignored then and labellerFinish fails.
+int labellerAddRow(Labeller* labeller, const bitword* packedRow, int row, int* labelRow);
+int labellerAddByteRow(Labeller* labeller, const byte* row, int rowIndex, int* labelRow);
+
+//centroids (x, y) of the maxNum biggest blobs with at least minArea pixels, biggest first, ties in scan order.
+//returns the number of points, -1 when a row didn't fit the label table. momentsPtr (optional) receives the moments
+//of the same blobs.
+int labellerFinish(Labeller* labeller, int maxNum, int minArea, int* resultPtr, BlobMoments* momentsPtr);
+
+//turn provisional labels written by labellerAddRow into final ones: 0 background, blobs 1..n in scan order
+void labellerRelabel(Labeller* labeller, int* labelPtr, int height, int stride);
+
+#endif
@@ -1,77 +1,75 @@
 #include "dip.h"
+#include "packedMorphological.h"
+#include "fixedSize.h"
 
-proc_m dilate(proc_para)
+//3x3 square: dilation is the max of the neighbourhood, erosion the min, then any nonzero byte is foreground.
+//A neighbour outside the image is replaced by the centre pixel, which can't change a max or a min, so the result
+//is the same as skipping it. The first and the last column are peeled off, the columns between have no branch.
+struct MaxOp { static inline byte apply(byte a, byte b) { return a > b ? a : b; } };
+struct MinOp { static inline byte apply(byte a, byte b) { return a < b ? a : b; } };
+
+template <class Op>
+static inline byte column3(const byte* up, const byte* mid, const byte* down, int j)
 {
-	for (int i = 0; i < height; i++)
-	{
-		for (int j = 0; j < width; j++)
-		{
-			bool result = false;
-			for (int mi = 0; mi < 3; mi++)
-			{
-				for (int mj = 0; mj < 3; mj++)
-				{
-					int img_row = i + mi - 1;
-					int img_col = j + mj - 1;
-					if(img_row < 0 || img_row >= height || img_col < 0 || img_col >= width)
-					{
-						continue;	//TODO: How to?
-					}
+	return Op::apply(Op::apply(up[j], mid[j]), down[j]);
+}
 
-					if(*srcPixelBit(img_row, img_col))	
-					{
-						result = true;
-						break;
-					}
-				}
-				if(result)
-					break;
-			}
-			*dstPixelBit(i, j) = bwBit(result);
-		}
+//__restrict (MSVC and gcc): src and dst rows never overlap, without it the row loop isn't vectorized
+template <class Op>
+static inline void filterRow(const byte* __restrict up, const byte* __restrict mid, const byte* __restrict down, byte* __restrict dst, int width)
+{
+	if (width == 1)
+	{
+		dst[0] = bwBit(column3<Op>(up, mid, down, 0));
+		return;
 	}
 
-	return 0;
+	dst[0] = bwBit(Op::apply(column3<Op>(up, mid, down, 0), column3<Op>(up, mid, down, 1)));
+	for (int j = 1; j < width - 1; j++)
+	{
+		byte v = Op::apply(Op::apply(column3<Op>(up, mid, down, j - 1), column3<Op>(up, mid, down, j)), column3<Op>(up, mid, down, j + 1));
+		dst[j] = bwBit(v);
+	}
+	dst[width - 1] = bwBit(Op::apply(column3<Op>(up, mid, down, width - 2), column3<Op>(up, mid, down, width - 1)));
 }
 
-proc_m erose(proc_para)
+template <class Op, class Size>
+static void filter3x3(const byte* srcPtr, byte* dstPtr, Size size)
 {
-	bool mask[3][3] = { {1,1,1}, {1,1,1}, {1,1,1} };	
-
+	const int width = size.width(), height = size.height(), stride = size.stride();
 	for (int i = 0; i < height; i++)
 	{
-		for (int j = 0; j < width; j++)
-		{
-			bool result = true;
-			for (int mi = 0; mi < 3; mi++)
-			{
-				for (int mj = 0; mj < 3; mj++)
-				{
-					int img_row = i + mi - 1;
-					int img_col = j + mj - 1;
-					if(img_row < 0 || img_row >= height || img_col < 0 || img_col >= width)
-					{
-						continue;	//TODO: How to?
-					}
-
-					if(!*srcPixelBit(img_row, img_col))	//TODO: (efficiency) TOBW 9 times more!
-					{
-						result = false;
-						break;
-					}
-				}
-				if(!result)
-					break;
-			}
-			*dstPixelBit(i, j) = bwBit(result);
-		}
+		filterRow<Op>(srcPixelBit(i > 0 ? i - 1 : i, 0), srcPixelBit(i, 0), srcPixelBit(i + 1 < height ? i + 1 : i, 0), dstPixelBit(i, 0), width);
 	}
+}
+
+proc_m dilate(proc_para)
+{
+	dispatchFixedSize(width, height, stride, filter3x3<MaxOp>(srcPtr, dstPtr, size));
+	return 0;
+}
 
+proc_m erose(proc_para)
+{
+	dispatchFixedSize(width, height, stride, filter3x3<MinOp>(srcPtr, dstPtr, size));
 	return 0;
 }
 
 proc_m open(proc_para, byte* switchPtr)
 {
+	//bit packed path: the packed images live in switchPtr and dstPtr while they are not needed as bytes.
+	//Falls back to the byte version when a packed image doesn't fit in a byte buffer.
+	if (packedStride(width) * sizeof(bitword) <= (size_t)stride && width <= PACKED_MAX_WIDTH)
+	{
+		bitword* packedSrc = (bitword*)switchPtr;
+		bitword* packedEroded = (bitword*)dstPtr;
+		packRows(srcPtr, packedSrc, width, 0, height, stride);
+		packedErode(packedSrc, packedEroded, width, height, StructSquare, 1);
+		packedDilate(packedEroded, packedSrc, width, height, StructSquare, 1);
+		unpackRows(packedSrc, dstPtr, width, 0, height, stride);
+		return 0;
+	}
+
 	erose(srcPtr, switchPtr, width, height, stride);
 	dilate(switchPtr, dstPtr, width, height, stride);
 	return 0;
@@ -0,0 +1,233 @@
+#include "packedMorphological.h"
+#include "simd.h"
+
+#define PACKED_MAX_WORDS (PACKED_MAX_WIDTH / 64)
+
+static const bitword allOnes = ~(bitword)0;
+
+static bitword lastWordMask(int width)
+{
+	return (width & 63) ? (((bitword)1 << (width & 63)) - 1) : allOnes;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//packing
+
+static void packRowScalar(const byte* src, bitword* dst, int width)
+{
+	int words = packedStride(width);
+	for (int w = 0; w < words; w++)
+	{
+		bitword bits = 0;
+		int count = width - w * 64 < 64 ? width - w * 64 : 64;
+		for (int k = 0; k < count; k++)
+		{
+			bits |= (bitword)(src[w * 64 + k] != 0) << k;
+		}
+		dst[w] = bits;
+	}
+}
+
+#ifdef SIMD_X86
+SIMD_TARGET_SSE2 static void packRowSSE2(const byte* src, bitword* dst, int width)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	int w = 0;
+	for (; (w + 1) * 64 <= width; w++)
+	{
+		bitword bits = 0;
+		for (int k = 0; k < 4; k++)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(src + w * 64 + k * 16));
+			bitword background = (bitword)_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+			bits |= (~background & 0xFFFF) << (k * 16);
+		}
+		dst[w] = bits;
+	}
+
+	if (w * 64 < width)
+	{
+		packRowScalar(src + w * 64, dst + w, width - w * 64);
+	}
+}
+#endif
+
+void packRows(const byte* srcPtr, bitword* packedPtr, int width, int rowBegin, int rowEnd, int stride)
+{
+	static SimdLevel level = simdDetect();
+
+	for (int i = rowBegin; i < rowEnd; i++)
+	{
+#ifdef SIMD_X86
+		if (level >= SimdSSE2)
+		{
+			packRowSSE2(srcPixelBit(i, 0), packedRow(packedPtr, i), width);
+			continue;
+		}
+#endif
+		packRowScalar(srcPixelBit(i, 0), packedRow(packedPtr, i), width);
+	}
+}
+
+void unpackRows(const bitword* packedPtr, byte* dstPtr, int width, int rowBegin, int rowEnd, int stride)
+{
+	for (int i = rowBegin; i < rowEnd; i++)
+	{
+		const bitword* src = packedRow(packedPtr, i);
+		byte* dst = dstPixelBit(i, 0);
+		for (int j = 0; j < width; j++)
+		{
+			dst[j] = bwBit((src[j >> 6] >> (j & 63)) & 1);
+		}
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//kernels
+
+//pixel (col + k) for every col of the word, from a row with one guard word on each side
+#define neighborWord(guarded, w, k) \
+	((k) == 0 ? (guarded)[(w) + 1] : \
+	 (k) > 0 ? (((guarded)[(w) + 1] >> (k)) | ((guarded)[(w) + 2] << (64 - (k)))) : \
+			   (((guarded)[(w) + 1] << -(k)) | ((guarded)[(w)] >> (64 + (k)))))
+
+//horizontal line of length 2r+1 over a guarded row: AND for erosion, OR for dilation
+static void horizontalLine(const bitword* guarded, bitword* dstRow, int words, int radius, bool erode)
+{
+	for (int w = 0; w < words; w++)
+	{
+		bitword acc = guarded[w + 1];
+		for (int k = 1; k <= radius; k++)
+		{
+			if (erode)
+			{
+				acc &= neighborWord(guarded, w, k) & neighborWord(guarded, w, -k);
+			}
+			else
+			{
+				acc |= neighborWord(guarded, w, k) | neighborWord(guarded, w, -k);
+			}
+		}
+		dstRow[w] = acc;
+	}
+}
+
+static void morphRow(const bitword* const* rows, bitword* dstRow, int width, int shape, int radius, bool erode)
+{
+	int words = packedStride(width);
+	bitword fill = erode ? allOnes : 0;		//what the pixels outside the image read as
+	bitword lastMask = lastWordMask(width);
+
+	//vertical line: AND / OR of the rows in the window, on words directly
+	bitword vertical[PACKED_MAX_WORDS];
+	for (int w = 0; w < words; w++)
+	{
+		bitword acc = fill;
+		for (int k = 0; k <= 2 * radius; k++)
+		{
+			if (rows[k] != NULL)
+			{
+				acc = erode ? (acc & rows[k][w]) : (acc | rows[k][w]);
+			}
+		}
+		vertical[w] = acc;
+	}
+
+	//square = horizontal line over the vertical result, cross = horizontal line over the center row AND/OR vertical
+	bitword guarded[PACKED_MAX_WORDS + 2];
+	const bitword* horizontalSrc = shape == StructSquare ? vertical : rows[radius];
+	guarded[0] = fill;
+	for (int w = 0; w < words; w++)
+	{
+		guarded[w + 1] = horizontalSrc[w];
+	}
+	guarded[words] = (guarded[words] & lastMask) | (fill & ~lastMask);
+	guarded[words + 1] = fill;
+
+	horizontalLine(guarded, dstRow, words, radius, erode);
+
+	if (shape == StructCross)
+	{
+		for (int w = 0; w < words; w++)
+		{
+			dstRow[w] = erode ? (dstRow[w] & vertical[w]) : (dstRow[w] | vertical[w]);
+		}
+	}
+
+	dstRow[words - 1] &= lastMask;
+}
+
+void packedErodeRow(const bitword* const* rows, bitword* dstRow, int width, int shape, int radius)
+{
+	morphRow(rows, dstRow, width, shape, radius, true);
+}
+
+void packedDilateRow(const bitword* const* rows, bitword* dstRow, int width, int shape, int radius)
+{
+	morphRow(rows, dstRow, width, shape, radius, false);
+}
+
+static int packedMorph(const bitword* srcPtr, bitword* dstPtr, int width, int height, int shape, int radius, bool erode)
+{
+	if (radius < 1 || radius > PACKED_MAX_RADIUS || width > PACKED_MAX_WIDTH || (shape != StructSquare && shape != StructCross))
+	{
+		return -1;
+	}
+
+	const bitword* rows[2 * PACKED_MAX_RADIUS + 1];
+	for (int i = 0; i < height; i++)
+	{
+		for (int k = 0; k <= 2 * radius; k++)
+		{
+			int row = i - radius + k;
+			rows[k] = (row >= 0 && row < height) ? packedRow(srcPtr, row) : NULL;
+		}
+		morphRow(rows, packedRow(dstPtr, i), width, shape, radius, erode);
+	}
+
+	return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//exports
+
+proc_m packBits(byte* srcPtr, bitword* packedPtr, int width, int height, int stride)
+{
+	packRows(srcPtr, packedPtr, width, 0, height, stride);
+	return 0;
+}
+
+proc_m unpackBits(bitword* packedPtr, byte* dstPtr, int width, int height, int stride)
+{
+	unpackRows(packedPtr, dstPtr, width, 0, height, stride);
+	return 0;
+}
+
+proc_m packedErode(bitword* srcPtr, bitword* dstPtr, int width, int height, int shape, int radius)
+{
+	return packedMorph(srcPtr, dstPtr, width, height, shape, radius, true);
+}
+
+proc_m packedDilate(bitword* srcPtr, bitword* dstPtr, int width, int height, int shape, int radius)
+{
+	return packedMorph(srcPtr, dstPtr, width, height, shape, radius, false);
+}
+
+proc_m packedOpen(bitword* srcPtr, bitword* dstPtr, int width, int height, int shape, int radius, bitword* switchPtr)
+{
+	if (packedErode(srcPtr, switchPtr, width, height, shape, radius) != 0)
+	{
+		return -1;
+	}
+	return packedDilate(switchPtr, dstPtr, width, height, shape, radius);
+}
+
+proc_m packedClose(bitword* srcPtr, bitword* dstPtr, int width, int height, int shape, int radius, bitword* switchPtr)
+{
+	if (packedDilate(srcPtr, switchPtr, width, height, shape, radius) != 0)
+	{
+		return -1;
+	}
+	return packedErode(switchPtr, dstPtr, width, height, shape, radius);
+}
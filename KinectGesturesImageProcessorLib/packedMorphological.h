@@ -0,0 +1,64 @@
+#ifndef _PACKED_MORPHOLOGICAL_H_
+#define _PACKED_MORPHOLOGICAL_H_
+
+#include "dip.h"
+
+//Bit packed black & white images: 64 pixels per word, bit k of word w in a row is column w * 64 + k.
+//Rows are packedStride(width) words apart and the bits past width are always 0.
+//Erosion reads pixels outside the image as foreground and dilation reads them as background, the same as the
+//byte versions in morphological.cpp, so both give identical results for the 3x3 square.
+
+typedef unsigned long long bitword;
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//index of the lowest set bit, bits must not be 0
+inline int lowestBit(bitword bits)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return (int)index;
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanForward(&index, (unsigned long)bits))
+	{
+		return (int)index;
+	}
+	_BitScanForward(&index, (unsigned long)(bits >> 32));
+	return (int)index + 32;
+#else
+	return __builtin_ctzll(bits);
+#endif
+}
+
+#define packedStride(width) (((width) + 63) / 64)
+#define packedRow(ptr, row) ((ptr) + (row) * packedStride(width))
+
+#define PACKED_MAX_RADIUS 7			//structuring element up to 15x15
+#define PACKED_MAX_WIDTH 4096
+
+typedef enum
+{
+	StructSquare = 0,				//(2r+1) x (2r+1) square
+	StructCross = 1					//horizontal and vertical line of length 2r+1
+} StructShape;
+
+void packRows(const byte* srcPtr, bitword* packedPtr, int width, int rowBegin, int rowEnd, int stride);
+void unpackRows(const bitword* packedPtr, byte* dstPtr, int width, int rowBegin, int rowEnd, int stride);
+
+//one output row of a packed erosion / dilation. rows[k] is image row (row - radius + k), NULL when outside the image.
+void packedErodeRow(const bitword* const* rows, bitword* dstRow, int width, int shape, int radius);
+void packedDilateRow(const bitword* const* rows, bitword* dstRow, int width, int shape, int radius);
+
+//whole images, packed buffers hold height * packedStride(width) words. Return -1 for an unsupported shape / size.
+proc_m packBits(byte* srcPtr, bitword* packedPtr, int width, int height, int stride);
+proc_m unpackBits(bitword* packedPtr, byte* dstPtr, int width, int height, int stride);
+proc_m packedErode(bitword* srcPtr, bitword* dstPtr, int width, int height, int shape, int radius);
+proc_m packedDilate(bitword* srcPtr, bitword* dstPtr, int width, int height, int shape, int radius);
+proc_m packedOpen(bitword* srcPtr, bitword* dstPtr, int width, int height, int shape, int radius, bitword* switchPtr);
+proc_m packedClose(bitword* srcPtr, bitword* dstPtr, int width, int height, int shape, int radius, bitword* switchPtr);
+
+#endif
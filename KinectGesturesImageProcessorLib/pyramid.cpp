@@ -0,0 +1,66 @@
+#include "pyramid.h"
+
+static void downsampleRowScalar(const ushort* top, const ushort* bottom, ushort* dst, int dstWidth)
+{
+	for (int j = 0; j < dstWidth; j++)
+	{
+		int a = top[2 * j], b = top[2 * j + 1], c = bottom[2 * j], d = bottom[2 * j + 1];
+		int count = (a != 0) + (b != 0) + (c != 0) + (d != 0);
+		dst[j] = count == 0 ? 0 : (ushort)((a + b + c + d) / count);
+	}
+}
+
+#ifdef SIMD_X86
+//8 coarse pixels per step. The sums stay below 2^18, so they are exact as floats and the truncated float quotient is
+//the integer one. A block without depth has sum 0 and is divided by 1.
+SIMD_TARGET_SSE2 static inline __m128i blockMean(__m128i top, __m128i bottom)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one16 = _mm_set1_epi16(1);
+	const __m128i low = _mm_set1_epi32(0xFFFF);
+
+	//pairs of 16 bit lanes into 32 bit lanes: the left pixel is the low half
+	__m128i sum = _mm_add_epi32(_mm_add_epi32(_mm_and_si128(top, low), _mm_srli_epi32(top, 16)),
+								_mm_add_epi32(_mm_and_si128(bottom, low), _mm_srli_epi32(bottom, 16)));
+	__m128i valid = _mm_add_epi16(_mm_add_epi16(_mm_cmpeq_epi16(top, zero), one16), _mm_add_epi16(_mm_cmpeq_epi16(bottom, zero), one16));
+	__m128i count = _mm_madd_epi16(valid, one16);
+	count = _mm_max_epi16(count, _mm_set1_epi32(1));	//counts are 0..4, the high halves stay 0
+
+	return _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(sum), _mm_cvtepi32_ps(count)));
+}
+
+SIMD_TARGET_SSE2 static void downsampleRowSSE2(const ushort* top, const ushort* bottom, ushort* dst, int dstWidth)
+{
+	int j = 0;
+	for (; j + 8 <= dstWidth; j += 8)
+	{
+		__m128i mean0 = blockMean(_mm_loadu_si128((const __m128i*)(top + 2 * j)), _mm_loadu_si128((const __m128i*)(bottom + 2 * j)));
+		__m128i mean1 = blockMean(_mm_loadu_si128((const __m128i*)(top + 2 * j + 8)), _mm_loadu_si128((const __m128i*)(bottom + 2 * j + 8)));
+
+		//means fit 16 bits unsigned, pack through a signed bias
+		const __m128i bias = _mm_set1_epi32(32768);
+		__m128i packed = _mm_packs_epi32(_mm_sub_epi32(mean0, bias), _mm_sub_epi32(mean1, bias));
+		_mm_storeu_si128((__m128i*)(dst + j), _mm_add_epi16(packed, _mm_set1_epi16(-32768)));
+	}
+
+	downsampleRowScalar(top + 2 * j, bottom + 2 * j, dst + j, dstWidth - j);
+}
+#endif
+
+void downsampleDepth(SimdLevel level, const ushort* srcDepthPtr, int width, int height, int depthStride, ushort* dstPtr, int dstStride)
+{
+	int dstWidth = width / 2, dstHeight = height / 2;
+	for (int i = 0; i < dstHeight; i++)
+	{
+		const ushort* top = srcDepth(2 * i, 0);
+		const ushort* bottom = srcDepth(2 * i + 1, 0);
+#ifdef SIMD_X86
+		if (level >= SimdSSE2)
+		{
+			downsampleRowSSE2(top, bottom, dstPtr + i * dstStride, dstWidth);
+			continue;
+		}
+#endif
+		downsampleRowScalar(top, bottom, dstPtr + i * dstStride, dstWidth);
+	}
+}
@@ -0,0 +1,18 @@
+#ifndef _PYRAMID_H_
+#define _PYRAMID_H_
+
+#include "depth.h"
+#include "simd.h"
+
+//Depth pyramid for the coarse to fine mode of the derivative finger detector. A coarse pixel is the mean of the
+//non-zero depths of its 2x2 block and 0 only when all four are 0, so holes neither pull the depth towards 0 nor grow.
+//An odd last row or column is dropped.
+
+//Strips need FINGER_EDGE_THRESHOLD and 4 columns at any level, a 16 mm finger is about 3 px wide at 160x120 and
+//level 2 finds next to nothing, so only the half resolution level is offered.
+#define PYRAMID_MAX_LEVEL 1
+
+//dst gets (width / 2) x (height / 2) pixels, dstStride ushorts per row
+void downsampleDepth(SimdLevel level, const ushort* srcDepthPtr, int width, int height, int depthStride, ushort* dstPtr, int dstStride);
+
+#endif
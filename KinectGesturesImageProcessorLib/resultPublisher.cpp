@@ -0,0 +1,651 @@
+#include "resultPublisher.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>			//before windows.h in threading.h
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+#include "threading.h"
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+
+typedef SOCKET Socket;
+#define SEND_FLAGS 0
+inline void closeSocket(Socket s) { closesocket(s); }
+inline bool socketWouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+inline bool setNonBlocking(Socket s) { u_long on = 1; return ioctlsocket(s, FIONBIO, &on) == 0; }
+
+#else
+
+typedef int Socket;
+#define INVALID_SOCKET (-1)
+#define SEND_FLAGS MSG_NOSIGNAL		//a closed client is an error code, not a SIGPIPE
+inline void closeSocket(Socket s) { close(s); }
+inline bool socketWouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+inline bool setNonBlocking(Socket s) { int flags = fcntl(s, F_GETFL, 0); return flags >= 0 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0; }
+
+#endif
+
+#define MAX_PACKET_SIZE (sizeof(PublisherPacketHeader) + PUBLISHER_MAX_FINGERS * sizeof(PublisherFinger) + PUBLISHER_MAX_EVENTS * sizeof(PublisherHandEvent))
+
+//tags of the poll loop, client slot k is TAG_CLIENT + k
+#define TAG_LISTENER 0
+#define TAG_WAKE 1
+#define TAG_CLIENT 2
+
+typedef struct Client
+{
+	Socket socket;				//INVALID_SOCKET for a free slot
+	byte* queue;				//queueBytes, whole packets from sentBytes to queuedBytes
+	int sentBytes, queuedBytes;
+	int skipStreak;				//packets skipped in a row
+	bool polledOut;				//registered for writability
+} Client;
+
+typedef struct Ready
+{
+	int tag;
+	bool readable, writable, failed;
+} Ready;
+
+typedef struct Publisher
+{
+	Socket listener;
+	Socket wakeSocket;			//UDP to itself, the producer sends a byte when it queues into an empty pending buffer
+	int port;
+	int maxClients, queueBytes, dropAfter;
+
+	//producer side, pending is handed to the thread as a whole under pendingMutex
+	Mutex pendingMutex;
+	byte* pending;
+	int pendingBytes;
+	PublisherHandEvent events[PUBLISHER_MAX_EVENTS];
+	int eventNum;
+	long long published, overflowed, lostEvents;
+
+	//publisher thread side
+	byte* taken;				//the previous pending buffer
+	Client* clients;
+	Ready* ready;				//maxClients + 2
+	PublisherStats threadStats;
+#ifdef _WIN32
+	WSAPOLLFD* pollFds;
+	int* pollTags;
+#else
+	int epoll;
+	struct epoll_event* epollEvents;
+#endif
+
+	Mutex statsMutex;
+	PublisherStats stats;		//threadStats as of the end of the last loop
+
+	Thread thread;
+	volatile long stopRequested;
+} Publisher;
+
+//---------------------------------------------------------------------------------------------------------------------
+//poll loop
+
+static bool pollAdd(Publisher* p, Socket s, int tag)
+{
+#ifdef _WIN32
+	return true;				//WSAPoll gets the whole set every time
+#else
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.u32 = tag;
+	return epoll_ctl(p->epoll, EPOLL_CTL_ADD, s, &ev) == 0;
+#endif
+}
+
+static void pollWantWrite(Publisher* p, Client* client, int tag, bool want)
+{
+	if (client->polledOut == want)
+	{
+		return;
+	}
+	client->polledOut = want;
+#ifndef _WIN32
+	struct epoll_event ev;
+	ev.events = want ? EPOLLIN | EPOLLOUT : EPOLLIN;
+	ev.data.u32 = tag;
+	epoll_ctl(p->epoll, EPOLL_CTL_MOD, client->socket, &ev);
+#endif
+}
+
+//blocks until a socket is ready, returns the number of p->ready entries filled
+static int pollWait(Publisher* p)
+{
+	int readyNum = 0;
+
+#ifdef _WIN32
+	int fdNum = 0;
+	p->pollFds[fdNum].fd = p->listener;
+	p->pollFds[fdNum].events = POLLRDNORM;
+	p->pollTags[fdNum++] = TAG_LISTENER;
+	p->pollFds[fdNum].fd = p->wakeSocket;
+	p->pollFds[fdNum].events = POLLRDNORM;
+	p->pollTags[fdNum++] = TAG_WAKE;
+	for (int k = 0; k < p->maxClients; k++)
+	{
+		Client* client = &p->clients[k];
+		if (client->socket != INVALID_SOCKET)
+		{
+			p->pollFds[fdNum].fd = client->socket;
+			p->pollFds[fdNum].events = client->polledOut ? POLLRDNORM | POLLWRNORM : POLLRDNORM;
+			p->pollTags[fdNum++] = TAG_CLIENT + k;
+		}
+	}
+
+	if (WSAPoll(p->pollFds, fdNum, -1) <= 0)
+	{
+		return 0;
+	}
+
+	for (int i = 0; i < fdNum; i++)
+	{
+		short revents = p->pollFds[i].revents;
+		if (revents != 0)
+		{
+			Ready* r = &p->ready[readyNum++];
+			r->tag = p->pollTags[i];
+			r->readable = (revents & POLLRDNORM) != 0;
+			r->writable = (revents & POLLWRNORM) != 0;
+			r->failed = (revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+		}
+	}
+#else
+	int eventNum = epoll_wait(p->epoll, p->epollEvents, p->maxClients + 2, -1);
+	for (int i = 0; i < eventNum; i++)
+	{
+		unsigned int events = p->epollEvents[i].events;
+		Ready* r = &p->ready[readyNum++];
+		r->tag = p->epollEvents[i].data.u32;
+		r->readable = (events & EPOLLIN) != 0;
+		r->writable = (events & EPOLLOUT) != 0;
+		r->failed = (events & (EPOLLERR | EPOLLHUP)) != 0;
+	}
+#endif
+
+	return readyNum;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//clients
+
+static void disconnectClient(Publisher* p, Client* client)
+{
+	//closing removes it from the epoll set as well
+	closeSocket(client->socket);
+	client->socket = INVALID_SOCKET;
+	client->sentBytes = client->queuedBytes = 0;
+	client->skipStreak = 0;
+	client->polledOut = false;
+	p->threadStats.clients--;
+	p->threadStats.disconnected++;
+}
+
+static void acceptClients(Publisher* p)
+{
+	for (;;)
+	{
+		Socket s = accept(p->listener, NULL, NULL);
+		if (s == INVALID_SOCKET)
+		{
+			return;
+		}
+
+		int slot = 0;
+		while (slot < p->maxClients && p->clients[slot].socket != INVALID_SOCKET)
+		{
+			slot++;
+		}
+
+		//no Nagle delay, and a kernel buffer about the size of the queue: what a slow client can't take should be skipped
+		//here, not pile up in the kernel and reach it late
+		int noDelay = 1;
+		if (slot == p->maxClients || !setNonBlocking(s) ||
+			setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay)) != 0 ||
+			setsockopt(s, SOL_SOCKET, SO_SNDBUF, (const char*)&p->queueBytes, sizeof(p->queueBytes)) != 0 || !pollAdd(p, s, TAG_CLIENT + slot))
+		{
+			closeSocket(s);
+			p->threadStats.refused++;
+			continue;
+		}
+
+		p->clients[slot].socket = s;
+		p->threadStats.clients++;
+		p->threadStats.accepted++;
+	}
+}
+
+//sends what the socket takes without blocking, false when the client is gone
+static bool flushClient(Publisher* p, Client* client)
+{
+	while (client->sentBytes < client->queuedBytes)
+	{
+		int n = send(client->socket, (const char*)client->queue + client->sentBytes, client->queuedBytes - client->sentBytes, SEND_FLAGS);
+		if (n > 0)
+		{
+			client->sentBytes += n;
+			p->threadStats.bytes += n;
+		}
+		else if (n < 0 && socketWouldBlock())
+		{
+			break;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	if (client->sentBytes == client->queuedBytes)
+	{
+		client->sentBytes = client->queuedBytes = 0;
+	}
+	return true;
+}
+
+//clients only talk by closing, anything else they send is dropped
+static bool drainClient(Client* client)
+{
+	char buffer[256];
+	for (;;)
+	{
+		int n = recv(client->socket, buffer, sizeof(buffer), 0);
+		if (n > 0)
+		{
+			continue;
+		}
+		return n < 0 && socketWouldBlock();
+	}
+}
+
+//queues the packet whole or skips it for this client, false when the client skipped too many
+static bool queuePacket(Publisher* p, Client* client, const byte* packet, int size)
+{
+	if (client->queuedBytes - client->sentBytes + size > p->queueBytes)
+	{
+		p->threadStats.skipped++;
+		client->skipStreak++;
+		return p->dropAfter <= 0 || client->skipStreak < p->dropAfter;
+	}
+
+	if (client->queuedBytes + size > p->queueBytes)
+	{
+		memmove(client->queue, client->queue + client->sentBytes, client->queuedBytes - client->sentBytes);
+		client->queuedBytes -= client->sentBytes;
+		client->sentBytes = 0;
+	}
+
+	memcpy(client->queue + client->queuedBytes, packet, size);
+	client->queuedBytes += size;
+	client->skipStreak = 0;
+	p->threadStats.sent++;
+	return true;
+}
+
+static void distributePending(Publisher* p)
+{
+	mutexLock(&p->pendingMutex);
+	byte* packets = p->pending;
+	int size = p->pendingBytes;
+	p->pending = p->taken;
+	p->pendingBytes = 0;
+	p->taken = packets;
+	mutexUnlock(&p->pendingMutex);
+
+	for (int offset = 0; offset < size; )
+	{
+		int packetSize = ((const PublisherPacketHeader*)(packets + offset))->packetSize;
+		for (int k = 0; k < p->maxClients; k++)
+		{
+			Client* client = &p->clients[k];
+			if (client->socket != INVALID_SOCKET && !queuePacket(p, client, packets + offset, packetSize))
+			{
+				disconnectClient(p, client);
+			}
+		}
+		offset += packetSize;
+	}
+}
+
+static THREAD_PROC(publisherProc)
+{
+	Publisher* p = (Publisher*)threadArg;
+
+	while (!p->stopRequested)
+	{
+		int readyNum = pollWait(p);
+
+		for (int i = 0; i < readyNum; i++)
+		{
+			Ready* r = &p->ready[i];
+			if (r->tag == TAG_LISTENER)
+			{
+				acceptClients(p);
+			}
+			else if (r->tag == TAG_WAKE)
+			{
+				char buffer[64];
+				while (recv(p->wakeSocket, buffer, sizeof(buffer), 0) > 0) { }
+			}
+			else
+			{
+				Client* client = &p->clients[r->tag - TAG_CLIENT];
+				if (client->socket == INVALID_SOCKET)
+				{
+					continue;
+				}
+				if (r->failed || (r->readable && !drainClient(client)) || (r->writable && !flushClient(p, client)))
+				{
+					disconnectClient(p, client);
+				}
+			}
+		}
+
+		distributePending(p);
+
+		for (int k = 0; k < p->maxClients; k++)
+		{
+			Client* client = &p->clients[k];
+			if (client->socket == INVALID_SOCKET)
+			{
+				continue;
+			}
+			if (!flushClient(p, client))
+			{
+				disconnectClient(p, client);
+				continue;
+			}
+			pollWantWrite(p, client, TAG_CLIENT + k, client->queuedBytes > 0);
+		}
+
+		mutexLock(&p->statsMutex);
+		p->stats = p->threadStats;
+		mutexUnlock(&p->statsMutex);
+	}
+
+	return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//setup
+
+static void freePublisher(Publisher* p)
+{
+	if (p->clients != NULL)
+	{
+		for (int k = 0; k < p->maxClients; k++)
+		{
+			if (p->clients[k].socket != INVALID_SOCKET)
+			{
+				closeSocket(p->clients[k].socket);
+			}
+			free(p->clients[k].queue);
+		}
+	}
+	if (p->listener != INVALID_SOCKET)
+	{
+		closeSocket(p->listener);
+	}
+	if (p->wakeSocket != INVALID_SOCKET)
+	{
+		closeSocket(p->wakeSocket);
+	}
+#ifdef _WIN32
+	free(p->pollFds);
+	free(p->pollTags);
+	WSACleanup();
+#else
+	if (p->epoll >= 0)
+	{
+		close(p->epoll);
+	}
+	free(p->epollEvents);
+#endif
+	free(p->clients);
+	free(p->ready);
+	free(p->pending);
+	free(p->taken);
+	mutexDestroy(&p->pendingMutex);
+	mutexDestroy(&p->statsMutex);
+	delete p;
+}
+
+//a UDP socket on loopback connected to itself
+static Socket openWakeSocket()
+{
+	Socket s = socket(AF_INET, SOCK_DGRAM, 0);
+	if (s == INVALID_SOCKET)
+	{
+		return s;
+	}
+
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t length = sizeof(addr);
+	if (bind(s, (sockaddr*)&addr, sizeof(addr)) != 0 || getsockname(s, (sockaddr*)&addr, &length) != 0 ||
+		connect(s, (sockaddr*)&addr, sizeof(addr)) != 0 || !setNonBlocking(s))
+	{
+		closeSocket(s);
+		return INVALID_SOCKET;
+	}
+	return s;
+}
+
+static bool openListener(Publisher* p, const char* address, int port)
+{
+	p->listener = socket(AF_INET, SOCK_STREAM, 0);
+	if (p->listener == INVALID_SOCKET)
+	{
+		return false;
+	}
+
+	int reuse = 1;
+	setsockopt(p->listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons((unsigned short)port);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (address != NULL && inet_pton(AF_INET, address, &addr.sin_addr) != 1)
+	{
+		return false;
+	}
+
+	socklen_t length = sizeof(addr);
+	if (bind(p->listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(p->listener, 16) != 0 ||
+		getsockname(p->listener, (sockaddr*)&addr, &length) != 0 || !setNonBlocking(p->listener))
+	{
+		return false;
+	}
+
+	p->port = ntohs(addr.sin_port);
+	return true;
+}
+
+DLL_EXPORT void* resultPublisherCreate(const char* address, int port, int maxClients, int queueBytes, int dropAfter)
+{
+	if (maxClients <= 0 || port < 0 || port > 65535)
+	{
+		return NULL;
+	}
+
+	Publisher* p = new Publisher();
+	memset(p, 0, sizeof(Publisher));
+	p->listener = p->wakeSocket = INVALID_SOCKET;
+	p->maxClients = maxClients;
+	p->queueBytes = queueBytes > (int)MAX_PACKET_SIZE ? queueBytes : (int)MAX_PACKET_SIZE;
+	p->dropAfter = dropAfter;
+	mutexInit(&p->pendingMutex);
+	mutexInit(&p->statsMutex);
+
+#ifdef _WIN32
+	WSADATA wsaData;
+	WSAStartup(MAKEWORD(2, 2), &wsaData);
+	p->pollFds = (WSAPOLLFD*)malloc((maxClients + 2) * sizeof(WSAPOLLFD));
+	p->pollTags = (int*)malloc((maxClients + 2) * sizeof(int));
+	bool ok = p->pollFds != NULL && p->pollTags != NULL;
+#else
+	p->epoll = epoll_create1(EPOLL_CLOEXEC);
+	p->epollEvents = (struct epoll_event*)malloc((maxClients + 2) * sizeof(struct epoll_event));
+	bool ok = p->epoll >= 0 && p->epollEvents != NULL;
+#endif
+
+	p->clients = (Client*)calloc(maxClients, sizeof(Client));
+	p->ready = (Ready*)malloc((maxClients + 2) * sizeof(Ready));
+	p->pending = (byte*)malloc(p->queueBytes);
+	p->taken = (byte*)malloc(p->queueBytes);
+	ok = ok && p->clients != NULL && p->ready != NULL && p->pending != NULL && p->taken != NULL;
+	for (int k = 0; ok && k < maxClients; k++)
+	{
+		p->clients[k].socket = INVALID_SOCKET;
+		p->clients[k].queue = (byte*)malloc(p->queueBytes);
+		ok = p->clients[k].queue != NULL;
+	}
+
+	ok = ok && openListener(p, address, port);
+	ok = ok && (p->wakeSocket = openWakeSocket()) != INVALID_SOCKET;
+	ok = ok && pollAdd(p, p->listener, TAG_LISTENER) && pollAdd(p, p->wakeSocket, TAG_WAKE);
+	if (!ok || !threadStart(&p->thread, publisherProc, p))
+	{
+		freePublisher(p);
+		return NULL;
+	}
+
+	return p;
+}
+
+proc_m resultPublisherDestroy(void* publisher)
+{
+	Publisher* p = (Publisher*)publisher;
+	if (p == NULL)
+	{
+		return 0;
+	}
+
+	p->stopRequested = 1;
+	memoryBarrier();
+	char wake = 0;
+	send(p->wakeSocket, &wake, 1, 0);
+	threadJoin(&p->thread);
+
+	freePublisher(p);
+	return 0;
+}
+
+proc_m resultPublisherGetPort(void* publisher)
+{
+	return ((Publisher*)publisher)->port;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//producer
+
+proc_m resultPublisherAddHandEvent(void* publisher, int type, int userId, int x, int y, int z)
+{
+	Publisher* p = (Publisher*)publisher;
+	if (p->eventNum == PUBLISHER_MAX_EVENTS)
+	{
+		p->lostEvents++;
+		return -1;
+	}
+
+	PublisherHandEvent* ev = &p->events[p->eventNum++];
+	ev->type = (unsigned short)type;
+	ev->userId = (unsigned short)userId;
+	ev->x = x;
+	ev->y = y;
+	ev->z = z;
+	return 0;
+}
+
+proc_m resultPublisherPublishFrame(void* publisher, long long frame, long long timestamp, int* fingers, int fingerNum, int* handHint)
+{
+	Publisher* p = (Publisher*)publisher;
+	fingerNum = fingerNum < 0 ? 0 : fingerNum > PUBLISHER_MAX_FINGERS ? PUBLISHER_MAX_FINGERS : fingerNum;
+	int size = sizeof(PublisherPacketHeader) + fingerNum * sizeof(PublisherFinger) + p->eventNum * sizeof(PublisherHandEvent);
+
+	p->published++;
+
+	mutexLock(&p->pendingMutex);
+	if (p->pendingBytes + size > p->queueBytes)
+	{
+		//the thread is that far behind, its clients will see a gap. The events wait for the next frame.
+		mutexUnlock(&p->pendingMutex);
+		p->overflowed++;
+		return -1;
+	}
+
+	bool wasEmpty = p->pendingBytes == 0;
+	byte* packet = p->pending + p->pendingBytes;
+	p->pendingBytes += size;
+
+	PublisherPacketHeader* header = (PublisherPacketHeader*)packet;
+	header->magic = PUBLISHER_MAGIC;
+	header->version = PUBLISHER_VERSION;
+	header->headerSize = sizeof(PublisherPacketHeader);
+	header->packetSize = size;
+	header->fingerNum = (unsigned short)fingerNum;
+	header->eventNum = (unsigned short)p->eventNum;
+	header->frame = frame;
+	header->timestamp = timestamp;
+	for (int i = 0; i < 4; i++)
+	{
+		header->handHint[i] = handHint != NULL ? handHint[i] : 0;
+	}
+
+	PublisherFinger* finger = (PublisherFinger*)(header + 1);
+	for (int i = 0; i < fingerNum; i++)
+	{
+		finger[i].x = (short)fingers[2 * i];
+		finger[i].y = (short)fingers[2 * i + 1];
+	}
+	memcpy(finger + fingerNum, p->events, p->eventNum * sizeof(PublisherHandEvent));
+	mutexUnlock(&p->pendingMutex);
+
+	p->eventNum = 0;
+	if (wasEmpty)
+	{
+		char wake = 0;
+		send(p->wakeSocket, &wake, 1, 0);
+	}
+	return 0;
+}
+
+proc_m resultPublisherGetStats(void* publisher, PublisherStats* statsPtr)
+{
+	Publisher* p = (Publisher*)publisher;
+
+	mutexLock(&p->statsMutex);
+	*statsPtr = p->stats;
+	mutexUnlock(&p->statsMutex);
+
+	statsPtr->published = p->published;
+	statsPtr->overflowed = p->overflowed;
+	statsPtr->lostEvents = p->lostEvents;
+	return 0;
+}
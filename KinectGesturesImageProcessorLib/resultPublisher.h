@@ -0,0 +1,84 @@
+#ifndef _RESULT_PUBLISHER_H_
+#define _RESULT_PUBLISHER_H_
+
+#include "depth.h"
+
+//Sends the result of every frame to any number of TCP clients as one binary packet:
+//	header		PublisherPacketHeader
+//	fingers		fingerNum PublisherFinger
+//	events		eventNum PublisherHandEvent, the hand events since the previous packet
+//Everything is little endian, the structs are naturally aligned and go on the wire as they are.
+//
+//The producer only builds the packet and queues it, a thread of the publisher does all the socket work in a non-blocking
+//poll loop (epoll on Linux, WSAPoll on Windows). Every client has a send queue of queueBytes: a packet that doesn't fit
+//any more is skipped for that client, it gets the next one that fits, whole. Packets are never split between clients
+//or interleaved, so a client that falls behind sees gaps in the frame numbers and nothing else. A client that skipped
+//dropAfter packets in a row is disconnected.
+
+#define PUBLISHER_MAGIC 0x5052474b			//"KGRP"
+#define PUBLISHER_VERSION 1
+#define PUBLISHER_MAX_FINGERS 64
+#define PUBLISHER_MAX_EVENTS 64				//per packet, further events before the next frame are counted and lost
+
+typedef enum HandEventType
+{
+	HandCreate = 1,
+	HandUpdate = 2,
+	HandDestroy = 3
+} HandEventType;
+
+typedef struct PublisherPacketHeader
+{
+	unsigned int magic;
+	unsigned short version;
+	unsigned short headerSize;		//sizeof(PublisherPacketHeader), the fingers follow
+	unsigned int packetSize;		//bytes, header included
+	unsigned short fingerNum;
+	unsigned short eventNum;
+	long long frame;
+	long long timestamp;
+	int handHint[4];				//x, y, z, confidence, as derivativeFingerDetectorWork returns it
+} PublisherPacketHeader;
+
+typedef struct PublisherFinger
+{
+	short x, y;						//pixels
+} PublisherFinger;
+
+typedef struct PublisherHandEvent
+{
+	unsigned short type;			//HandEventType
+	unsigned short userId;
+	int x, y, z;					//millimetres, real world, 0 for HandCreate / HandDestroy
+} PublisherHandEvent;
+
+typedef struct PublisherStats
+{
+	long long published;			//packets given to resultPublisherPublishFrame
+	long long sent;					//packets queued to a client, summed over the clients
+	long long skipped;				//packets a client had no room for, summed over the clients
+	long long overflowed;			//packets resultPublisherPublishFrame couldn't queue at all
+	long long lostEvents;			//hand events beyond PUBLISHER_MAX_EVENTS of a packet
+	long long bytes;				//written to the sockets
+	int clients;					//connected right now
+	int accepted;					//clients so far
+	int refused;					//over maxClients
+	int disconnected;				//by the client, on an error, or for skipping dropAfter packets in a row
+} PublisherStats;
+
+//address: the IPv4 address to listen on, NULL for all. port 0 picks a free one, see resultPublisherGetPort.
+//queueBytes: send queue per client, at least one packet of PUBLISHER_MAX_FINGERS fingers and PUBLISHER_MAX_EVENTS events.
+//Returns NULL when the socket can't be opened or bound.
+DLL_EXPORT void* resultPublisherCreate(const char* address, int port, int maxClients, int queueBytes, int dropAfter);
+proc_m resultPublisherDestroy(void* publisher);
+proc_m resultPublisherGetPort(void* publisher);
+
+//one producer thread, the same for both. Events are held until the next frame and go out in its packet.
+proc_m resultPublisherAddHandEvent(void* publisher, int type, int userId, int x, int y, int z);
+//fingers: fingerNum (x, y) pairs as derivativeFingerDetectorWork fills them, handHint: 4 ints or NULL. Returns 0, or -1
+//when the packet couldn't be queued because the publisher thread is more than queueBytes behind.
+proc_m resultPublisherPublishFrame(void* publisher, long long frame, long long timestamp, int* fingers, int fingerNum, int* handHint);
+
+proc_m resultPublisherGetStats(void* publisher, PublisherStats* statsPtr);
+
+#endif
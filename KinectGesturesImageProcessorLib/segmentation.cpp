@@ -1,103 +1,60 @@
 #include "dip.h"
+#include "labeller.h"
 
-#include <deque>
-#include <vector>
-#include <algorithm>
-using namespace std;
+static Labeller* defaultLabeller = NULL;	//used by extractPoints, recreated when the frame size changes
 
-typedef pair<int, int> pos;
-
-bool sortComparator(const vector<pos>& a, const vector<pos>& b)
+//find all continuous (8-connected) blocks from a black&white bitmap, and return the center point of each block. If blocks are more than maxNum, return the first maxNum bigger ones.
+//blocks smaller than minArea pixels are ignored. dstPtr won't be used. Set it to 0.
+//labelPtr (optional) receives the label image: 0 for background, blocks numbered 1..n in scan order, stride ints per row.
+//return the num of points, along with an integer array with coordinate pairs (x, y) stored in resultPtr; -1 when
+//the labeller doesn't fit the frame or runs out of labels, labelPtr is incomplete then.
+proc_m extractPointsEx(void* labeller, proc_para, int maxNum, int minArea, int* resultPtr, int* labelPtr)
 {
-	return a.size() > b.size();
-}
+	Labeller* lab = (Labeller*)labeller;
+	if (lab == NULL || lab->width != width || lab->height != height)
+	{
+		return -1;
+	}
 
-//find all continuous blocks from a black&white bitmap, and return the center point of each block. If blocks are more than maxNum, return the first maxNum bigger ones. 
-//dstPtr won't be used. Set it to 0.
-//return the num of points, along with an integer array with coordinate pairs (x, y) stored in resultPtr;
-proc_m extractPoints(proc_para, byte* switchPtr, int maxNum, int maxArea, int* resultPtr)
-{
-	vector<vector<pos> > blocks; 
-	deque<pos> searchingQueue;
-	
-	memset(switchPtr, 0, height * stride * sizeof(byte));	//use switchPtr as visit flag
-	
-	//find blocks
+	labellerBegin(lab);
 	for (int i = 0; i < height; i++)
 	{
-		for (int j = 0; j < width; j++)
+		if (labellerAddByteRow(lab, srcPixelBit(i, 0), i, labelPtr != NULL ? labelPtr + i * stride : NULL) < 0)
 		{
-			if (*bufferPixelBit(switchPtr, i, j))
-			{
-				continue;
-			}
-
-			*bufferPixelBit(switchPtr, i, j) = 0xFF;	
-			
-			if (!*srcPixelBit(i, j))
-			{
-				continue;
-			}
-
-			//create a new block
-			blocks.push_back(vector<pair<int, int> >());
-			blocks[blocks.size() - 1].push_back(pos(i, j));
-			searchingQueue.push_back(pos(i, j));
-
-			while(!searchingQueue.empty())
-			{
-				pos curr = searchingQueue.front();
-				searchingQueue.pop_front();
-
-				//search the neighbor, BFS
-				for (int ni = curr.first - 1; ni <= curr.first + 1; ni++)	//we only need to search neighbors "behind" the current point
-				{
-					 if (ni < 0 || ni >= height)
-					 {
-						 continue;
-					 }
-
-					 for (int nj = curr.second - 1; nj <= curr.second + 1; nj++)
-					 {
-						 if ( (ni == 0 && nj == 0) || (nj < 0 || nj >= width) || *bufferPixelBit(switchPtr, ni, nj))
-						 {
-							 continue;	//skip self, out of bound point and visited point
-						 }
-
-						 *bufferPixelBit(switchPtr, ni, nj) = 0xFF;	//visited
-						 
-						 if (*srcPixelBit(ni, nj))
-						 {
-							 blocks[blocks.size() - 1].push_back(pos(ni, nj));
-							 searchingQueue.push_back(pos(ni, nj));
-						 }
-					 }
-				}
-			}
+			return -1;
 		}
 	}
 
-	//sort the blocks from max to min
-	sort(blocks.begin(), blocks.end(), sortComparator);
+	int pointNum = labellerFinish(lab, maxNum, minArea, resultPtr, NULL);
 
-	int pi;
-	for (pi = 0; pi < blocks.size() && pi < maxNum; pi++)
+	if (labelPtr != NULL)
 	{
-		if (blocks[pi].size() < maxArea)
-		{
-			break;	//then pi is the num of points
-		}
+		labellerRelabel(lab, labelPtr, height, stride);
+	}
 
-		int xSum = 0, ySum = 0;
-		for (int j = 0; j < blocks[pi].size(); j++)
-		{
-			xSum += blocks[pi][j].second;	//x = col = second
-			ySum += blocks[pi][j].first;
-		}
+	return pointNum;
+}
+
+//the tables of a labeller are allocated once, so extractPointsEx doesn't allocate anything per frame
+DLL_EXPORT void* extractPointsCreate(int width, int height)
+{
+	return labellerCreate(width, height);
+}
 
-		resultPtr[2 * pi] = xSum / blocks[pi].size();
-		resultPtr[2 * pi + 1] = ySum / blocks[pi].size(); 
+proc_m extractPointsDestroy(void* labeller)
+{
+	labellerDestroy((Labeller*)labeller);
+	return 0;
+}
+
+//switchPtr isn't used any more, it's kept for existing callers
+proc_m extractPoints(proc_para, byte* switchPtr, int maxNum, int minArea, int* resultPtr)
+{
+	if (defaultLabeller == NULL || defaultLabeller->width != width || defaultLabeller->height != height)
+	{
+		labellerDestroy(defaultLabeller);
+		defaultLabeller = labellerCreate(width, height);
 	}
 
-	return pi;
-}
\ No newline at end of file
+	return extractPointsEx(defaultLabeller, srcPtr, dstPtr, width, height, stride, maxNum, minArea, resultPtr, NULL);
+}
@@ -0,0 +1,76 @@
+#ifndef _SIMD_H_
+#define _SIMD_H_
+
+//Runtime cpu feature detection for the hand written kernels.
+//Every kernel is compiled for all instruction sets we know about and the best one is picked at runtime,
+//so the dll still loads on machines without AVX2.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#endif
+
+#ifdef SIMD_X86
+	#include <emmintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define SIMD_TARGET_SSE2
+		#define SIMD_TARGET_AVX2
+		#if _MSC_VER >= 1700	//AVX2 intrinsics are not available before VS2012
+			#include <immintrin.h>
+			#define SIMD_HAVE_AVX2 1
+		#endif
+	#else
+		#include <immintrin.h>
+		#define SIMD_TARGET_SSE2 __attribute__((target("sse2")))
+		#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+		#define SIMD_HAVE_AVX2 1
+	#endif
+#endif
+
+typedef enum
+{
+	SimdScalar = 0,
+	SimdSSE2,
+	SimdAVX2
+} SimdLevel;
+
+inline SimdLevel simdDetect()
+{
+#if defined(SIMD_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+
+	__cpuid(info, 1);
+	if (!(info[3] & (1 << 26)))		//SSE2
+	{
+		return SimdScalar;
+	}
+
+#ifdef SIMD_HAVE_AVX2
+	bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6);	//OSXSAVE, AVX, XMM|YMM state
+	if (osSavesYmm && maxLeaf >= 7)
+	{
+		__cpuidex(info, 7, 0);
+		if (info[1] & (1 << 5))		//AVX2
+		{
+			return SimdAVX2;
+		}
+	}
+#endif
+	return SimdSSE2;
+
+#elif defined(SIMD_X86) && defined(__GNUC__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return SimdAVX2;
+	}
+	return __builtin_cpu_supports("sse2") ? SimdSSE2 : SimdScalar;
+
+#else
+	return SimdScalar;
+#endif
+}
+
+#endif
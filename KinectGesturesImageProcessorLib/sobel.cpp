@@ -0,0 +1,329 @@
+#include "sobel.h"
+#include <memory.h>
+
+//The 5x5 template is split into a column pass over a ring of 5 converted source rows and a row pass over the
+//column results, which are padded with 2 zeros on each side. Missing rows at the top / bottom border point to a
+//zero row, so none of the inner loops check bounds.
+
+#define roundSobel(x) ((x) - ((x) >> 31))	//same as (int)((double)(x) + 0.5) for integers
+
+//---------------------------------------------------------------------------------------------------------------------
+//scalar
+
+static void convertRowScalar(const ushort* src, int* dst, int width, int deviceMaxDepth)
+{
+	for (int j = 0; j < width; j++)
+	{
+		dst[j] = src[j] == 0 ? deviceMaxDepth : src[j];
+	}
+}
+
+static void columnPassScalar(const int* const* rows, int* smooth, int* deriv, int width)
+{
+	const int *r0 = rows[0], *r1 = rows[1], *r2 = rows[2], *r3 = rows[3], *r4 = rows[4];
+	for (int j = 0; j < width; j++)
+	{
+		smooth[j] = r0[j] + r4[j] + 4 * (r1[j] + r3[j]) + 6 * r2[j];
+		deriv[j] = r0[j] - r4[j] + 2 * (r1[j] - r3[j]);
+	}
+}
+
+static void rowPassScalar(const int* smooth, const int* deriv, int* hDst, int* vDst, int width)
+{
+	for (int j = 0; j < width; j++)
+	{
+		int h = smooth[j - 2] - smooth[j + 2] + 2 * (smooth[j - 1] - smooth[j + 1]);
+		hDst[j] = roundSobel(h);
+	}
+
+	if (vDst != NULL)
+	{
+		for (int j = 0; j < width; j++)
+		{
+			int v = deriv[j - 2] + deriv[j + 2] + 4 * (deriv[j - 1] + deriv[j + 1]) + 6 * deriv[j];
+			vDst[j] = roundSobel(v);
+		}
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//SSE2
+
+#ifdef SIMD_X86
+
+SIMD_TARGET_SSE2 static void convertRowSSE2(const ushort* src, int* dst, int width, int deviceMaxDepth)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i maxDepth = _mm_set1_epi16((short)deviceMaxDepth);
+
+	int j = 0;
+	for (; j + 8 <= width; j += 8)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + j));
+		__m128i hole = _mm_cmpeq_epi16(v, zero);
+		v = _mm_or_si128(_mm_andnot_si128(hole, v), _mm_and_si128(hole, maxDepth));
+		_mm_storeu_si128((__m128i*)(dst + j), _mm_unpacklo_epi16(v, zero));
+		_mm_storeu_si128((__m128i*)(dst + j + 4), _mm_unpackhi_epi16(v, zero));
+	}
+	convertRowScalar(src + j, dst + j, width - j, deviceMaxDepth);
+}
+
+SIMD_TARGET_SSE2 static void columnPassSSE2(const int* const* rows, int* smooth, int* deriv, int width)
+{
+	const int *r0 = rows[0], *r1 = rows[1], *r2 = rows[2], *r3 = rows[3], *r4 = rows[4];
+
+	int j = 0;
+	for (; j + 4 <= width; j += 4)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(r0 + j));
+		__m128i b = _mm_loadu_si128((const __m128i*)(r1 + j));
+		__m128i c = _mm_loadu_si128((const __m128i*)(r2 + j));
+		__m128i d = _mm_loadu_si128((const __m128i*)(r3 + j));
+		__m128i e = _mm_loadu_si128((const __m128i*)(r4 + j));
+
+		__m128i c2 = _mm_add_epi32(c, c);
+		__m128i s = _mm_add_epi32(_mm_add_epi32(a, e), _mm_slli_epi32(_mm_add_epi32(_mm_add_epi32(b, d), c), 2));
+		s = _mm_add_epi32(s, c2);
+		__m128i bd = _mm_sub_epi32(b, d);
+		__m128i dv = _mm_add_epi32(_mm_sub_epi32(a, e), _mm_add_epi32(bd, bd));
+
+		_mm_storeu_si128((__m128i*)(smooth + j), s);
+		_mm_storeu_si128((__m128i*)(deriv + j), dv);
+	}
+
+	const int* tailRows[5] = { r0 + j, r1 + j, r2 + j, r3 + j, r4 + j };
+	columnPassScalar(tailRows, smooth + j, deriv + j, width - j);
+}
+
+SIMD_TARGET_SSE2 static void rowPassSSE2(const int* smooth, const int* deriv, int* hDst, int* vDst, int width)
+{
+	int j = 0;
+	for (; j + 4 <= width; j += 4)
+	{
+		__m128i m2 = _mm_loadu_si128((const __m128i*)(smooth + j - 2));
+		__m128i m1 = _mm_loadu_si128((const __m128i*)(smooth + j - 1));
+		__m128i p1 = _mm_loadu_si128((const __m128i*)(smooth + j + 1));
+		__m128i p2 = _mm_loadu_si128((const __m128i*)(smooth + j + 2));
+
+		__m128i d1 = _mm_sub_epi32(m1, p1);
+		__m128i h = _mm_add_epi32(_mm_sub_epi32(m2, p2), _mm_add_epi32(d1, d1));
+		_mm_storeu_si128((__m128i*)(hDst + j), _mm_sub_epi32(h, _mm_srai_epi32(h, 31)));
+	}
+	rowPassScalar(smooth + j, deriv + j, hDst + j, NULL, width - j);
+
+	if (vDst != NULL)
+	{
+		for (j = 0; j + 4 <= width; j += 4)
+		{
+			__m128i m2 = _mm_loadu_si128((const __m128i*)(deriv + j - 2));
+			__m128i m1 = _mm_loadu_si128((const __m128i*)(deriv + j - 1));
+			__m128i c = _mm_loadu_si128((const __m128i*)(deriv + j));
+			__m128i p1 = _mm_loadu_si128((const __m128i*)(deriv + j + 1));
+			__m128i p2 = _mm_loadu_si128((const __m128i*)(deriv + j + 2));
+
+			__m128i v = _mm_add_epi32(_mm_add_epi32(m2, p2), _mm_slli_epi32(_mm_add_epi32(_mm_add_epi32(m1, p1), c), 2));
+			v = _mm_add_epi32(v, _mm_add_epi32(c, c));
+			_mm_storeu_si128((__m128i*)(vDst + j), _mm_sub_epi32(v, _mm_srai_epi32(v, 31)));
+		}
+		for (; j < width; j++)
+		{
+			int v = deriv[j - 2] + deriv[j + 2] + 4 * (deriv[j - 1] + deriv[j + 1]) + 6 * deriv[j];
+			vDst[j] = roundSobel(v);
+		}
+	}
+}
+
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+//AVX2
+
+#ifdef SIMD_HAVE_AVX2
+
+SIMD_TARGET_AVX2 static void convertRowAVX2(const ushort* src, int* dst, int width, int deviceMaxDepth)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i maxDepth = _mm256_set1_epi16((short)deviceMaxDepth);
+
+	int j = 0;
+	for (; j + 16 <= width; j += 16)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)(src + j));
+		v = _mm256_blendv_epi8(v, maxDepth, _mm256_cmpeq_epi16(v, zero));
+		_mm256_storeu_si256((__m256i*)(dst + j), _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v)));
+		_mm256_storeu_si256((__m256i*)(dst + j + 8), _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1)));
+	}
+	convertRowScalar(src + j, dst + j, width - j, deviceMaxDepth);
+}
+
+SIMD_TARGET_AVX2 static void columnPassAVX2(const int* const* rows, int* smooth, int* deriv, int width)
+{
+	const int *r0 = rows[0], *r1 = rows[1], *r2 = rows[2], *r3 = rows[3], *r4 = rows[4];
+
+	int j = 0;
+	for (; j + 8 <= width; j += 8)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i*)(r0 + j));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(r1 + j));
+		__m256i c = _mm256_loadu_si256((const __m256i*)(r2 + j));
+		__m256i d = _mm256_loadu_si256((const __m256i*)(r3 + j));
+		__m256i e = _mm256_loadu_si256((const __m256i*)(r4 + j));
+
+		__m256i s = _mm256_add_epi32(_mm256_add_epi32(a, e), _mm256_slli_epi32(_mm256_add_epi32(_mm256_add_epi32(b, d), c), 2));
+		s = _mm256_add_epi32(s, _mm256_add_epi32(c, c));
+		__m256i bd = _mm256_sub_epi32(b, d);
+		__m256i dv = _mm256_add_epi32(_mm256_sub_epi32(a, e), _mm256_add_epi32(bd, bd));
+
+		_mm256_storeu_si256((__m256i*)(smooth + j), s);
+		_mm256_storeu_si256((__m256i*)(deriv + j), dv);
+	}
+
+	const int* tailRows[5] = { r0 + j, r1 + j, r2 + j, r3 + j, r4 + j };
+	columnPassScalar(tailRows, smooth + j, deriv + j, width - j);
+}
+
+SIMD_TARGET_AVX2 static void rowPassAVX2(const int* smooth, const int* deriv, int* hDst, int* vDst, int width)
+{
+	int j = 0;
+	for (; j + 8 <= width; j += 8)
+	{
+		__m256i m2 = _mm256_loadu_si256((const __m256i*)(smooth + j - 2));
+		__m256i m1 = _mm256_loadu_si256((const __m256i*)(smooth + j - 1));
+		__m256i p1 = _mm256_loadu_si256((const __m256i*)(smooth + j + 1));
+		__m256i p2 = _mm256_loadu_si256((const __m256i*)(smooth + j + 2));
+
+		__m256i d1 = _mm256_sub_epi32(m1, p1);
+		__m256i h = _mm256_add_epi32(_mm256_sub_epi32(m2, p2), _mm256_add_epi32(d1, d1));
+		_mm256_storeu_si256((__m256i*)(hDst + j), _mm256_sub_epi32(h, _mm256_srai_epi32(h, 31)));
+	}
+	rowPassScalar(smooth + j, deriv + j, hDst + j, NULL, width - j);
+
+	if (vDst != NULL)
+	{
+		for (j = 0; j + 8 <= width; j += 8)
+		{
+			__m256i m2 = _mm256_loadu_si256((const __m256i*)(deriv + j - 2));
+			__m256i m1 = _mm256_loadu_si256((const __m256i*)(deriv + j - 1));
+			__m256i c = _mm256_loadu_si256((const __m256i*)(deriv + j));
+			__m256i p1 = _mm256_loadu_si256((const __m256i*)(deriv + j + 1));
+			__m256i p2 = _mm256_loadu_si256((const __m256i*)(deriv + j + 2));
+
+			__m256i v = _mm256_add_epi32(_mm256_add_epi32(m2, p2), _mm256_slli_epi32(_mm256_add_epi32(_mm256_add_epi32(m1, p1), c), 2));
+			v = _mm256_add_epi32(v, _mm256_add_epi32(c, c));
+			_mm256_storeu_si256((__m256i*)(vDst + j), _mm256_sub_epi32(v, _mm256_srai_epi32(v, 31)));
+		}
+		for (; j < width; j++)
+		{
+			int v = deriv[j - 2] + deriv[j + 2] + 4 * (deriv[j - 1] + deriv[j + 1]) + 6 * deriv[j];
+			vDst[j] = roundSobel(v);
+		}
+	}
+}
+
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+
+static void selectKernels(SobelStream* stream, SimdLevel level)
+{
+	stream->convertRow = convertRowScalar;
+	stream->columnPass = columnPassScalar;
+	stream->rowPass = rowPassScalar;
+
+#ifdef SIMD_X86
+	if (level >= SimdSSE2)
+	{
+		stream->convertRow = convertRowSSE2;
+		stream->columnPass = columnPassSSE2;
+		stream->rowPass = rowPassSSE2;
+	}
+#endif
+
+#ifdef SIMD_HAVE_AVX2
+	if (level >= SimdAVX2)
+	{
+		stream->convertRow = convertRowAVX2;
+		stream->columnPass = columnPassAVX2;
+		stream->rowPass = rowPassAVX2;
+	}
+#endif
+}
+
+void sobelStreamBegin(SobelStream* stream, SimdLevel level, const ushort* srcDepthPtr, int width, int height, int depthStride, int deviceMaxDepth,
+					  int rowBegin, int* scratch)
+{
+	selectKernels(stream, level);
+	stream->srcDepthPtr = srcDepthPtr;
+	stream->width = width;
+	stream->height = height;
+	stream->depthStride = depthStride;
+	stream->deviceMaxDepth = deviceMaxDepth;
+	stream->row = rowBegin;
+
+	int scratchRow = sobelScratchRow(width);
+	for (int r = 0; r < 5; r++)
+	{
+		stream->ring[r] = scratch + r * scratchRow;
+	}
+
+	stream->zeroRow = scratch + 5 * scratchRow;
+	stream->smooth = scratch + 6 * scratchRow + 2;
+	stream->deriv = scratch + 7 * scratchRow + 2;
+	memset(stream->zeroRow, 0, width * sizeof(int));
+	memset(stream->smooth - 2, 0, scratchRow * sizeof(int));	//the padding is never written again
+	memset(stream->deriv - 2, 0, scratchRow * sizeof(int));
+
+	//rows [rowBegin - 2, rowBegin + 1] as halo
+	for (int r = rowBegin - 2; r < rowBegin + 2; r++)
+	{
+		if (r >= 0 && r < height)
+		{
+			stream->convertRow(srcDepth(r, 0), stream->ring[r % 5], width, deviceMaxDepth);
+		}
+	}
+}
+
+void sobelStreamRow(SobelStream* stream, int* hDst, int* vDst)
+{
+	const ushort* srcDepthPtr = stream->srcDepthPtr;
+	int height = stream->height, depthStride = stream->depthStride;
+	int i = stream->row++;
+
+	if (i + 2 < height)
+	{
+		stream->convertRow(srcDepth(i + 2, 0), stream->ring[(i + 2) % 5], stream->width, stream->deviceMaxDepth);
+	}
+
+	const int* rows[5];
+	for (int r = 0; r < 5; r++)
+	{
+		int neighborRow = i + r - 2;
+		rows[r] = (neighborRow >= 0 && neighborRow < height) ? stream->ring[neighborRow % 5] : stream->zeroRow;
+	}
+
+	stream->columnPass(rows, stream->smooth, stream->deriv, stream->width);
+	stream->rowPass(stream->smooth, stream->deriv, hDst, vDst, stream->width);
+}
+
+void sobelStreamSkipRow(SobelStream* stream)
+{
+	const ushort* srcDepthPtr = stream->srcDepthPtr;
+	int height = stream->height, depthStride = stream->depthStride;
+	int i = stream->row++;
+
+	if (i + 2 < height)
+	{
+		stream->convertRow(srcDepth(i + 2, 0), stream->ring[(i + 2) % 5], stream->width, stream->deviceMaxDepth);
+	}
+}
+
+void sobelRows(SimdLevel level, const ushort* srcDepthPtr, int width, int height, int depthStride, int deviceMaxDepth,
+			   int rowBegin, int rowEnd, int* hDst, int* vDst, int* scratch)
+{
+	SobelStream stream;
+	sobelStreamBegin(&stream, level, srcDepthPtr, width, height, depthStride, deviceMaxDepth, rowBegin, scratch);
+	for (int i = rowBegin; i < rowEnd; i++)
+	{
+		sobelStreamRow(&stream, bufferDepth(hDst, i, 0), vDst == NULL ? NULL : bufferDepth(vDst, i, 0));
+	}
+}
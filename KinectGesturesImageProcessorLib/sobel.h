@@ -0,0 +1,47 @@
+#ifndef _SOBEL_H_
+#define _SOBEL_H_
+
+#include "depth.h"
+#include "simd.h"
+
+//Integer separable version of the 5x5 sobel template of the derivative finger detector:
+//	horizontal = [1 4 6 4 1]' * [1 2 0 -2 -1], vertical is its transpose.
+//Zero depth is read as deviceMaxDepth and taps outside the frame are skipped, the same as the old double version.
+//The result also keeps its (int)(x + 0.5) rounding, which truncates negative values towards zero.
+
+#define sobelScratchRow(width) ((width) + 8)
+#define sobelScratchSize(width) (8 * sobelScratchRow(width))	//in ints
+
+typedef void (*SobelConvertRowFunc)(const ushort* src, int* dst, int width, int deviceMaxDepth);
+typedef void (*SobelColumnPassFunc)(const int* const* rows, int* smooth, int* deriv, int width);
+typedef void (*SobelRowPassFunc)(const int* smooth, const int* deriv, int* hDst, int* vDst, int width);
+
+//one derivative row at a time, top to bottom, for callers that consume a row while it is still in the cache
+typedef struct SobelStream
+{
+	SobelConvertRowFunc convertRow;
+	SobelColumnPassFunc columnPass;
+	SobelRowPassFunc rowPass;
+	const ushort* srcDepthPtr;
+	int width, height, depthStride, deviceMaxDepth;
+	int* ring[5];				//converted source rows, the slot of a row is row % 5
+	int *zeroRow, *smooth, *deriv;
+	int row;					//the next one sobelStreamRow computes
+} SobelStream;
+
+//starts at rowBegin, rows above it are read as halo. scratch must hold sobelScratchSize(width) ints and stay untouched
+//until the last row.
+void sobelStreamBegin(SobelStream* stream, SimdLevel level, const ushort* srcDepthPtr, int width, int height, int depthStride, int deviceMaxDepth,
+					  int rowBegin, int* scratch);
+//computes the next row into hDst / vDst, width ints each, vDst can be NULL
+void sobelStreamRow(SobelStream* stream, int* hDst, int* vDst);
+//goes past the next row without computing it, its source row still goes into the ring for the rows after it
+void sobelStreamSkipRow(SobelStream* stream);
+
+//compute derivative rows [rowBegin, rowEnd) of the frame into hDst / vDst (both use depthStride, vDst can be NULL).
+//Rows outside the range are read as halo, so bands of one frame can be computed independently.
+//scratch must hold sobelScratchSize(width) ints.
+void sobelRows(SimdLevel level, const ushort* srcDepthPtr, int width, int height, int depthStride, int deviceMaxDepth,
+			   int rowBegin, int rowEnd, int* hDst, int* vDst, int* scratch);
+
+#endif
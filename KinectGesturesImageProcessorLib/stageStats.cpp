@@ -0,0 +1,87 @@
+#include "stageStats.h"
+
+#include "threading.h"
+#include <memory.h>
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+long long stageClock()
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency = { 0 };
+	if (frequency.QuadPart == 0)
+	{
+		QueryPerformanceFrequency(&frequency);
+	}
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (long long)((double)counter.QuadPart * 1e9 / frequency.QuadPart);
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+#ifndef NO_STAGE_STATS
+
+void stageStatsReset(StageStatsRing* ring)
+{
+	memset(ring, 0, sizeof(StageStatsRing));
+}
+
+void stageStatsPublish(StageStatsRing* ring, const FrameStats* stats)
+{
+	long index = ring->published;
+	int slot = index % STAGE_STATS_FRAMES;
+
+	ring->sequence[slot]++;		//odd: being written
+	memoryBarrier();
+	ring->slots[slot] = *stats;
+	memoryBarrier();
+	ring->sequence[slot]++;
+	memoryBarrier();
+	ring->published = index + 1;
+}
+
+int stageStatsSnapshot(const StageStatsRing* ring, StageSnapshot* snapshot)
+{
+	memset(snapshot, 0, sizeof(StageSnapshot));
+
+	long published = ring->published;
+	memoryBarrier();
+	long first = published > STAGE_STATS_FRAMES ? published - STAGE_STATS_FRAMES : 0;
+	for (long index = first; index < published; index++)
+	{
+		int slot = index % STAGE_STATS_FRAMES;
+		long before = ring->sequence[slot];
+		memoryBarrier();
+		FrameStats stats = ring->slots[slot];
+		memoryBarrier();
+		long after = ring->sequence[slot];
+
+		//torn, or already the slot of a newer frame
+		if (before != after || (before & 1) != 0 || stats.frame != index + 1)
+		{
+			continue;
+		}
+		snapshot->frames[snapshot->frameNum++] = stats;
+	}
+
+	for (int s = 0; s < STAGE_NUM; s++)
+	{
+		long long sum = 0;
+		for (int k = 0; k < snapshot->frameNum; k++)
+		{
+			int nanos = snapshot->frames[k].nanos[s];
+			sum += nanos;
+			snapshot->maxNanos[s] = nanos > snapshot->maxNanos[s] ? nanos : snapshot->maxNanos[s];
+		}
+		snapshot->meanNanos[s] = snapshot->frameNum > 0 ? (int)(sum / snapshot->frameNum) : 0;
+	}
+
+	return snapshot->frameNum;
+}
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef _STAGE_STATS_H_
+#define _STAGE_STATS_H_
+
+#include "depth.h"
+
+//Hot path instrumentation: monotonic timings and counts of the detector stages for the last STAGE_STATS_FRAMES frames.
+//The detector thread publishes a frame into a ring, readers on any thread take a snapshot without locking: every slot
+//has a sequence number that is odd while the slot is written, a copy is kept only when the number didn't change.
+//Define NO_STAGE_STATS to compile all of it out, the query export then returns -1.
+
+#define STAGE_STATS_FRAMES 64
+
+typedef enum
+{
+	StageSobel = 0,				//summed over the bands, CPU time rather than wall time with several threads
+	StageStrips,				//summed over the bands as well. Streaming frames count sobel here, StageSobel is 0
+	StageFingers,
+	StageOutput,				//generateOutputImage, 0 without OutputImage
+	StageFrame,					//the whole frame, wall time
+	STAGE_NUM
+} Stage;
+
+typedef enum
+{
+	CountStrips = 0,
+	CountChains,				//candidate chains linked by findFingers
+	CountFingers,				//chains long enough to be fingers
+	CountReported,				//fingers returned
+	COUNT_NUM
+} StageCount;
+
+//int fields only, so the C# side can mirror it with fixed buffers
+typedef struct FrameStats
+{
+	int frame;					//frames since the detector was created, from 1
+	int frameMode;				//FrameMode
+	int quality;				//QualityLevel
+	int nanos[STAGE_NUM];
+	int counts[COUNT_NUM];
+} FrameStats;
+
+typedef struct StageSnapshot
+{
+	int frameNum;				//valid entries of frames, oldest first
+	FrameStats frames[STAGE_STATS_FRAMES];
+	int meanNanos[STAGE_NUM], maxNanos[STAGE_NUM];	//over those frames
+} StageSnapshot;
+
+long long stageClock();		//monotonic, nanoseconds; kept with NO_STAGE_STATS, the detector worker needs it too
+
+#ifndef NO_STAGE_STATS
+
+typedef struct StageStatsRing
+{
+	FrameStats slots[STAGE_STATS_FRAMES];
+	volatile long sequence[STAGE_STATS_FRAMES];
+	volatile long published;	//frames published so far
+} StageStatsRing;
+
+void stageStatsReset(StageStatsRing* ring);
+void stageStatsPublish(StageStatsRing* ring, const FrameStats* stats);	//one writer only
+int stageStatsSnapshot(const StageStatsRing* ring, StageSnapshot* snapshot);
+
+#define stageTime(var) long long var = stageClock()
+#define stageAdd(nanosField, start) ((nanosField) += (int)(stageClock() - (start)))
+#define stageCount(countField, n) ((countField) += (n))
+
+#else
+
+#define stageTime(var)
+#define stageAdd(nanosField, start) ((void)0)
+#define stageCount(countField, n) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,201 @@
+#include "syntheticScene.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#define SCENE_PI 3.14159265358979323846
+#define PALM_HALF_THICKNESS 12		//millimetres, the palm and the arm are flatter than wide
+#define ARM_LENGTH 300
+#define ARM_WIDTH_SHARE 0.7			//of the palm width
+#define FINGER_ROOT_SHARE 0.8		//fingers start this share of the palm radius away from its centre
+#define SCENE_PRIMITIVES (SCENE_MAX_HANDS * (SCENE_MAX_FINGERS + 2))
+
+//a capsule lying over the table: the segment a-b at elevation, radius across, halfThickness up
+typedef struct ScenePrimitive
+{
+	double ax, ay, bx, by;
+	double radius, halfThickness, elevation;
+	double left, bottom, right, top;	//real world bounds on the table
+} ScenePrimitive;
+
+//the scene's own generator, rand() differs between the C runtimes
+static unsigned int sceneRandom(unsigned int& state)
+{
+	state = state * 1664525u + 1013904223u;
+	return state >> 8;		//24 bits, the low ones of a power of 2 LCG are poor
+}
+
+static void direction(const SceneHand* hand, int finger, double& dx, double& dy)
+{
+	double angle = (hand->angle + (finger - (hand->fingerNum - 1) * 0.5) * hand->spread) * SCENE_PI / 180;
+	dx = cos(angle);
+	dy = sin(angle);
+}
+
+//the far end of the finger's axis and the tip of its round end
+static void fingerSegment(const SceneHand* hand, int finger, double& ax, double& ay, double& bx, double& by)
+{
+	double dx, dy;
+	direction(hand, finger, dx, dy);
+	double root = hand->palmWidth * 0.5 * FINGER_ROOT_SHARE;
+	ax = hand->x + dx * root;
+	ay = hand->y + dy * root;
+	bx = ax + dx * hand->fingerLength;
+	by = ay + dy * hand->fingerLength;
+}
+
+static void addPrimitive(ScenePrimitive* primitives, int& num, double ax, double ay, double bx, double by, double radius, double halfThickness, double elevation)
+{
+	ScenePrimitive p = { ax, ay, bx, by, radius, halfThickness, elevation,
+						 std::min(ax, bx) - radius, std::min(ay, by) - radius, std::max(ax, bx) + radius, std::max(ay, by) + radius };
+	primitives[num++] = p;
+}
+
+static int scenePrimitives(const SceneParams* params, ScenePrimitive* primitives)
+{
+	int num = 0;
+	for (int h = 0; h < params->handNum; h++)
+	{
+		const SceneHand* hand = &params->hands[h];
+		for (int f = 0; f < std::min(hand->fingerNum, SCENE_MAX_FINGERS); f++)
+		{
+			double ax, ay, bx, by;
+			fingerSegment(hand, f, ax, ay, bx, by);
+			double radius = hand->fingerWidth * 0.5;
+			addPrimitive(primitives, num, ax, ay, bx, by, radius, radius, hand->elevation);
+		}
+
+		if (hand->palmWidth > 0)
+		{
+			//the palm around its centre, the arm from the wrist away from the fingers
+			double angle = hand->angle * SCENE_PI / 180, dx = cos(angle), dy = sin(angle);
+			double radius = hand->palmWidth * 0.5;
+			double wristX = hand->x - dx * radius, wristY = hand->y - dy * radius;
+			addPrimitive(primitives, num, hand->x, hand->y, wristX, wristY, radius, PALM_HALF_THICKNESS, hand->elevation);
+			addPrimitive(primitives, num, wristX, wristY, wristX - dx * ARM_LENGTH, wristY - dy * ARM_LENGTH,
+						 radius * ARM_WIDTH_SHARE, PALM_HALF_THICKNESS, hand->elevation);
+		}
+	}
+	return num;
+}
+
+//millimetres above the table at real world x, y: the highest primitive there
+static double sceneHeight(const ScenePrimitive* primitives, int num, double x, double y)
+{
+	double height = 0;
+	for (int k = 0; k < num; k++)
+	{
+		const ScenePrimitive* p = &primitives[k];
+		if (x < p->left || x > p->right || y < p->bottom || y > p->top)
+		{
+			continue;
+		}
+
+		double abx = p->bx - p->ax, aby = p->by - p->ay;
+		double length2 = abx * abx + aby * aby;
+		double t = length2 > 0 ? ((x - p->ax) * abx + (y - p->ay) * aby) / length2 : 0;
+		t = std::min(std::max(t, 0.0), 1.0);
+		double dx = x - (p->ax + t * abx), dy = y - (p->ay + t * aby);
+		double d2 = (dx * dx + dy * dy) / (p->radius * p->radius);
+		if (d2 < 1)
+		{
+			height = std::max(height, p->elevation + p->halfThickness * sqrt(1 - d2));
+		}
+	}
+	return height;
+}
+
+void sceneParamsInit(SceneParams* params, int width, int height)
+{
+	memset(params, 0, sizeof(SceneParams));
+	params->width = width;
+	params->height = height;
+	params->realWorldXToZ = 1.12;
+	params->realWorldYToZ = 0.84;
+	params->tableDepth = 800;
+	params->noise = 1;
+	params->holeShare = 0.001;
+	params->seed = 1;
+}
+
+int sceneAddHand(SceneParams* params, double x, double y, int fingerNum)
+{
+	if (params->handNum >= SCENE_MAX_HANDS)
+	{
+		return -1;
+	}
+
+	SceneHand* hand = &params->hands[params->handNum];
+	hand->x = x;
+	hand->y = y;
+	hand->angle = 90;
+	hand->spread = 15;
+	hand->fingerNum = std::min(std::max(fingerNum, 0), SCENE_MAX_FINGERS);
+	hand->fingerWidth = 16;
+	hand->fingerLength = 70;
+	hand->palmWidth = 85;
+	hand->elevation = 40;
+	return params->handNum++;
+}
+
+void sceneRender(const SceneParams* params, ushort* depthPtr, int depthStride)
+{
+	ScenePrimitive primitives[SCENE_PRIMITIVES];
+	int num = scenePrimitives(params, primitives);
+
+	int width = params->width, height = params->height;
+	double fx = width / params->realWorldXToZ, fy = height / params->realWorldYToZ, cx = width * 0.5, cy = height * 0.5;
+	unsigned int holeLimit = (unsigned int)(std::min(std::max(params->holeShare, 0.0), 1.0) * (1 << 24));
+	unsigned int state = params->seed;
+	for (int i = 0; i < height; i++)
+	{
+		ushort* row = depthPtr + i * depthStride;
+		double ys = (cy - i) / fy;
+		for (int j = 0; j < width; j++)
+		{
+			//the ray of the pixel meets the table at tableDepth, the hand over it a little closer: a second step
+			//from the depth of the first is within a fraction of a millimetre
+			double xs = (j - cx) / fx;
+			double z = params->tableDepth;
+			for (int step = 0; step < 2 && num > 0; step++)
+			{
+				z = params->tableDepth - sceneHeight(primitives, num, xs * z, ys * z);
+			}
+
+			int depth = (int)(z + 0.5);
+			if (params->noise > 0)
+			{
+				depth += sceneRandom(state) % (params->noise + 1);
+			}
+			if (sceneRandom(state) < holeLimit)
+			{
+				depth = 0;
+			}
+			row[j] = (ushort)std::min(std::max(depth, 0), 65535);
+		}
+	}
+}
+
+int sceneFingerTips(const SceneParams* params, int* tipsPtr, int maxTips)
+{
+	double fx = params->width / params->realWorldXToZ, fy = params->height / params->realWorldYToZ, cx = params->width * 0.5, cy = params->height * 0.5;
+	int tipNum = 0;
+	for (int h = 0; h < params->handNum; h++)
+	{
+		const SceneHand* hand = &params->hands[h];
+		for (int f = 0; f < std::min(hand->fingerNum, SCENE_MAX_FINGERS) && tipNum < maxTips; f++)
+		{
+			//the end of the round tip, at the depth of the finger's top
+			double ax, ay, bx, by, dx, dy;
+			fingerSegment(hand, f, ax, ay, bx, by);
+			direction(hand, f, dx, dy);
+			double radius = hand->fingerWidth * 0.5;
+			double x = bx + dx * radius, y = by + dy * radius;
+			double z = params->tableDepth - hand->elevation - radius;
+			tipsPtr[2 * tipNum] = (int)floor(x * fx / z + cx + 0.5);
+			tipsPtr[2 * tipNum + 1] = (int)floor(cy - y * fy / z + 0.5);
+			tipNum++;
+		}
+	}
+	return tipNum;
+}
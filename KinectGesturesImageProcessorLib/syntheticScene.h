@@ -0,0 +1,49 @@
+#ifndef _SYNTHETIC_SCENE_H_
+#define _SYNTHETIC_SCENE_H_
+
+#include "depth.h"
+
+//Synthetic depth frames of a tabletop with hands over it, for the benchmarks and checks that have no sensor: a flat
+//table at tableDepth, hands of a palm and a fan of fingers held elevation millimetres above it. A finger is a capsule,
+//a cylinder with a round tip, of fingerWidth millimetres across, the palm a flattened one. Pixels are projected with
+//the centred camera of derivativeFingerDetectorCreate, fx = width / realWorldXToZ and cx = width / 2, so sizes in
+//millimetres come out the way the detector measures them.
+//Noise and holes come from a generator of the scene's own, the same seed gives the same frame on every platform.
+
+#define SCENE_MAX_HANDS 4
+#define SCENE_MAX_FINGERS 5			//per hand
+
+typedef struct SceneHand
+{
+	double x, y;					//real world millimetres of the palm centre on the table, 0, 0 under the camera, y up
+	double angle;					//degrees the middle finger points to, 0 right, 90 up the frame
+	double spread;					//degrees between two neighbouring fingers
+	int fingerNum;					//0..SCENE_MAX_FINGERS
+	double fingerWidth;				//millimetres
+	double fingerLength;			//millimetres from the palm edge to the tip
+	double palmWidth;				//millimetres, 0 for fingers without a hand
+	double elevation;				//millimetres from the table to the finger axes
+} SceneHand;
+
+typedef struct SceneParams
+{
+	int width, height;
+	double realWorldXToZ, realWorldYToZ;
+	int tableDepth;					//millimetres
+	int noise;						//every pixel gets up to noise millimetres added, 0 for none
+	double holeShare;				//share of the pixels that read 0, like the sensor's shadows and speckles
+	unsigned int seed;
+	SceneHand hands[SCENE_MAX_HANDS];
+	int handNum;
+} SceneParams;
+
+//a table 800 mm away with the Kinect's field of view, 1 mm of noise, one pixel in 1000 a hole, no hands
+void sceneParamsInit(SceneParams* params, int width, int height);
+//a hand at x, y pointing up, fingers of 16 mm by 70 mm 40 mm above the table. Returns the index, -1 when full.
+int sceneAddHand(SceneParams* params, double x, double y, int fingerNum);
+//depthStride ushorts per row
+void sceneRender(const SceneParams* params, ushort* depthPtr, int depthStride);
+//the projective (x, y) of every fingertip, hand after hand, into tipsPtr (maxTips pairs). Returns their num.
+int sceneFingerTips(const SceneParams* params, int* tipsPtr, int maxTips);
+
+#endif
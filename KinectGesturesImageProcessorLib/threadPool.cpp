@@ -0,0 +1,155 @@
+#include "threadPool.h"
+#include "threading.h"
+
+struct ThreadPool
+{
+	int threadNum;
+	Thread* workers;
+
+	Mutex mutex;
+	CondVar wake, done;
+	int generation;		//bumped for every run, workers sleep until it changes
+	int busyWorkers;
+	bool stopRequested;
+
+	ThreadPoolTask task;
+	void* arg;
+	int taskNum;
+	volatile long nextTask;
+};
+
+static void runTasks(ThreadPool* pool)
+{
+	for (;;)
+	{
+		long taskIndex = atomicIncrement(&pool->nextTask) - 1;
+		if (taskIndex >= pool->taskNum)
+		{
+			break;
+		}
+		pool->task(pool->arg, (int)taskIndex);
+	}
+}
+
+static THREAD_PROC(workerProc)
+{
+	ThreadPool* pool = (ThreadPool*)threadArg;
+	int seenGeneration = 0;
+
+	mutexLock(&pool->mutex);
+	for (;;)
+	{
+		while (pool->generation == seenGeneration && !pool->stopRequested)
+		{
+			condWait(&pool->wake, &pool->mutex);
+		}
+
+		if (pool->stopRequested)
+		{
+			break;
+		}
+
+		seenGeneration = pool->generation;
+		mutexUnlock(&pool->mutex);
+
+		runTasks(pool);
+
+		mutexLock(&pool->mutex);
+		if (--pool->busyWorkers == 0)
+		{
+			condBroadcast(&pool->done);
+		}
+	}
+	mutexUnlock(&pool->mutex);
+
+	return 0;
+}
+
+ThreadPool* threadPoolCreate(int threadNum)
+{
+	ThreadPool* pool = new ThreadPool();
+	pool->threadNum = threadNum < 1 ? 1 : threadNum;
+	pool->generation = 0;
+	pool->busyWorkers = 0;
+	pool->stopRequested = false;
+	pool->task = NULL;
+	pool->arg = NULL;
+	pool->taskNum = 0;
+	pool->nextTask = 0;
+
+	mutexInit(&pool->mutex);
+	condInit(&pool->wake);
+	condInit(&pool->done);
+
+	pool->workers = new Thread[pool->threadNum];
+	for (int i = 1; i < pool->threadNum; i++)	//slot 0 is the calling thread
+	{
+		if (!threadStart(&pool->workers[i], workerProc, pool))
+		{
+			pool->threadNum = i;	//run with what we got
+			break;
+		}
+	}
+
+	return pool;
+}
+
+void threadPoolDestroy(ThreadPool* pool)
+{
+	if (pool == NULL)
+	{
+		return;
+	}
+
+	mutexLock(&pool->mutex);
+	pool->stopRequested = true;
+	condBroadcast(&pool->wake);
+	mutexUnlock(&pool->mutex);
+
+	for (int i = 1; i < pool->threadNum; i++)
+	{
+		threadJoin(&pool->workers[i]);
+	}
+
+	condDestroy(&pool->done);
+	condDestroy(&pool->wake);
+	mutexDestroy(&pool->mutex);
+	delete [] pool->workers;
+	delete pool;
+}
+
+int threadPoolSize(const ThreadPool* pool)
+{
+	return pool == NULL ? 1 : pool->threadNum;
+}
+
+void threadPoolRun(ThreadPool* pool, ThreadPoolTask task, void* arg, int taskNum)
+{
+	if (pool == NULL || pool->threadNum <= 1 || taskNum <= 1)
+	{
+		for (int i = 0; i < taskNum; i++)
+		{
+			task(arg, i);
+		}
+		return;
+	}
+
+	mutexLock(&pool->mutex);
+	pool->task = task;
+	pool->arg = arg;
+	pool->taskNum = taskNum;
+	pool->nextTask = 0;
+	pool->busyWorkers = pool->threadNum - 1;
+	pool->generation++;
+	condBroadcast(&pool->wake);
+	mutexUnlock(&pool->mutex);
+
+	runTasks(pool);
+
+	mutexLock(&pool->mutex);
+	while (pool->busyWorkers > 0)
+	{
+		condWait(&pool->done, &pool->mutex);
+	}
+	mutexUnlock(&pool->mutex);
+}
@@ -0,0 +1,15 @@
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+//Persistent worker pool used as a parallel for: threadPoolRun hands out task indices [0, taskNum) to the workers
+//and to the calling thread, and returns when all of them are finished.
+
+typedef void (*ThreadPoolTask)(void* arg, int taskIndex);
+typedef struct ThreadPool ThreadPool;
+
+ThreadPool* threadPoolCreate(int threadNum);	//threadNum counts the calling thread, so 1 creates no worker
+void threadPoolDestroy(ThreadPool* pool);
+int threadPoolSize(const ThreadPool* pool);
+void threadPoolRun(ThreadPool* pool, ThreadPoolTask task, void* arg, int taskNum);
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef _THREADING_H_
+#define _THREADING_H_
+
+//Minimal portable wrappers over Win32 / pthread primitives.
+//Only include this from .cpp files: on Windows it pulls in windows.h.
+
+#ifdef _WIN32
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE CondVar;
+typedef HANDLE Thread;
+
+#define THREAD_PROC(name) DWORD WINAPI name(LPVOID threadArg)
+
+inline void mutexInit(Mutex* m) { InitializeCriticalSection(m); }
+inline void mutexDestroy(Mutex* m) { DeleteCriticalSection(m); }
+inline void mutexLock(Mutex* m) { EnterCriticalSection(m); }
+inline void mutexUnlock(Mutex* m) { LeaveCriticalSection(m); }
+
+inline void condInit(CondVar* c) { InitializeConditionVariable(c); }
+inline void condDestroy(CondVar* c) { }
+inline void condWait(CondVar* c, Mutex* m) { SleepConditionVariableCS(c, m, INFINITE); }
+inline void condBroadcast(CondVar* c) { WakeAllConditionVariable(c); }
+
+inline bool threadStart(Thread* t, LPTHREAD_START_ROUTINE proc, void* arg) { *t = CreateThread(NULL, 0, proc, arg, 0, NULL); return *t != NULL; }
+inline void threadJoin(Thread* t) { WaitForSingleObject(*t, INFINITE); CloseHandle(*t); }
+
+inline long atomicIncrement(volatile long* p) { return InterlockedIncrement(p); }		//returns the new value
+inline long atomicDecrement(volatile long* p) { return InterlockedDecrement(p); }		//returns the new value
+inline long atomicExchange(volatile long* p, long value) { return InterlockedExchange(p, value); }	//returns the old value
+inline void memoryBarrier() { MemoryBarrier(); }
+
+//counting semaphore, posting never blocks
+typedef HANDLE Semaphore;
+inline bool semaphoreInit(Semaphore* s) { *s = CreateSemaphore(NULL, 0, 0x7fffffff, NULL); return *s != NULL; }
+inline void semaphoreDestroy(Semaphore* s) { CloseHandle(*s); }
+inline void semaphorePost(Semaphore* s) { ReleaseSemaphore(*s, 1, NULL); }
+inline void semaphoreWait(Semaphore* s) { WaitForSingleObject(*s, INFINITE); }
+
+inline int cpuCount() { SYSTEM_INFO info; GetSystemInfo(&info); return (int)info.dwNumberOfProcessors; }
+
+#else
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <unistd.h>
+
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t CondVar;
+typedef pthread_t Thread;
+
+#define THREAD_PROC(name) void* name(void* threadArg)
+
+inline void mutexInit(Mutex* m) { pthread_mutex_init(m, NULL); }
+inline void mutexDestroy(Mutex* m) { pthread_mutex_destroy(m); }
+inline void mutexLock(Mutex* m) { pthread_mutex_lock(m); }
+inline void mutexUnlock(Mutex* m) { pthread_mutex_unlock(m); }
+
+inline void condInit(CondVar* c) { pthread_cond_init(c, NULL); }
+inline void condDestroy(CondVar* c) { pthread_cond_destroy(c); }
+inline void condWait(CondVar* c, Mutex* m) { pthread_cond_wait(c, m); }
+inline void condBroadcast(CondVar* c) { pthread_cond_broadcast(c); }
+
+inline bool threadStart(Thread* t, void* (*proc)(void*), void* arg) { return pthread_create(t, NULL, proc, arg) == 0; }
+inline void threadJoin(Thread* t) { pthread_join(*t, NULL); }
+
+inline long atomicIncrement(volatile long* p) { return __sync_add_and_fetch(p, 1); }		//returns the new value
+inline long atomicDecrement(volatile long* p) { return __sync_sub_and_fetch(p, 1); }		//returns the new value
+inline long atomicExchange(volatile long* p, long value) { return __atomic_exchange_n(p, value, __ATOMIC_SEQ_CST); }	//returns the old value
+inline void memoryBarrier() { __sync_synchronize(); }
+
+//counting semaphore, posting never blocks
+typedef sem_t Semaphore;
+inline bool semaphoreInit(Semaphore* s) { return sem_init(s, 0, 0) == 0; }
+inline void semaphoreDestroy(Semaphore* s) { sem_destroy(s); }
+inline void semaphorePost(Semaphore* s) { sem_post(s); }
+inline void semaphoreWait(Semaphore* s) { while (sem_wait(s) != 0) { } }		//EINTR
+
+inline int cpuCount() { long n = sysconf(_SC_NPROCESSORS_ONLN); return n > 0 ? (int)n : 1; }
+
+#endif
+
+#endif
@@ -0,0 +1,213 @@
+#include "touchPipeline.h"
+#include "arena.h"
+#include "simd.h"
+#include <math.h>
+
+//---------------------------------------------------------------------------------------------------------------------
+//threshold
+
+//finger when noise4 <= calibration - depth * 4 < finger4, noise4 comes from the noise map when there is one
+static void thresholdRowScalar(const ushort* depth, const ushort* calibration, const byte* noise, bitword* dst, int width, int noise4, int finger4)
+{
+	int words = packedStride(width);
+	for (int w = 0; w < words; w++)
+	{
+		bitword bits = 0;
+		int count = width - w * 64 < 64 ? width - w * 64 : 64;
+		for (int k = 0; k < count; k++)
+		{
+			int dist = (int)calibration[w * 64 + k] - ((int)depth[w * 64 + k] << TOUCH_CALIBRATION_SHIFT);
+			int pixelNoise4 = noise != NULL ? noise[w * 64 + k] : noise4;
+			bits |= (bitword)(dist >= pixelNoise4 && dist < finger4) << k;
+		}
+		dst[w] = bits;
+	}
+}
+
+#ifdef SIMD_X86
+//4 pixels in 32 bit lanes, the difference needs 17 bits
+SIMD_TARGET_SSE2 static inline __m128i thresholdLanes(__m128i depth, __m128i calibration, __m128i noiseMinus1, __m128i finger)
+{
+	__m128i dist = _mm_sub_epi32(calibration, _mm_slli_epi32(depth, TOUCH_CALIBRATION_SHIFT));
+	return _mm_and_si128(_mm_cmpgt_epi32(dist, noiseMinus1), _mm_cmplt_epi32(dist, finger));
+}
+
+SIMD_TARGET_SSE2 static void thresholdRowSSE2(const ushort* depth, const ushort* calibration, const byte* noise, bitword* dst, int width, int noise4, int finger4)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i minus1 = _mm_set1_epi32(-1);
+	const __m128i finger = _mm_set1_epi32(finger4);
+	__m128i noiseMinus1[4];
+	for (int q = 0; q < 4; q++)
+	{
+		noiseMinus1[q] = _mm_set1_epi32(noise4 - 1);
+	}
+
+	int w = 0;
+	for (; (w + 1) * 64 <= width; w++)
+	{
+		bitword bits = 0;
+		for (int k = 0; k < 64; k += 16)
+		{
+			const ushort* d = depth + w * 64 + k;
+			const ushort* c = calibration + w * 64 + k;
+			__m128i d0 = _mm_loadu_si128((const __m128i*)d);
+			__m128i d1 = _mm_loadu_si128((const __m128i*)(d + 8));
+			__m128i c0 = _mm_loadu_si128((const __m128i*)c);
+			__m128i c1 = _mm_loadu_si128((const __m128i*)(c + 8));
+
+			if (noise != NULL)
+			{
+				__m128i n = _mm_loadu_si128((const __m128i*)(noise + w * 64 + k));
+				__m128i n0 = _mm_unpacklo_epi8(n, zero), n1 = _mm_unpackhi_epi8(n, zero);
+				noiseMinus1[0] = _mm_add_epi32(_mm_unpacklo_epi16(n0, zero), minus1);
+				noiseMinus1[1] = _mm_add_epi32(_mm_unpackhi_epi16(n0, zero), minus1);
+				noiseMinus1[2] = _mm_add_epi32(_mm_unpacklo_epi16(n1, zero), minus1);
+				noiseMinus1[3] = _mm_add_epi32(_mm_unpackhi_epi16(n1, zero), minus1);
+			}
+
+			__m128i m0 = _mm_packs_epi32(thresholdLanes(_mm_unpacklo_epi16(d0, zero), _mm_unpacklo_epi16(c0, zero), noiseMinus1[0], finger),
+										 thresholdLanes(_mm_unpackhi_epi16(d0, zero), _mm_unpackhi_epi16(c0, zero), noiseMinus1[1], finger));
+			__m128i m1 = _mm_packs_epi32(thresholdLanes(_mm_unpacklo_epi16(d1, zero), _mm_unpacklo_epi16(c1, zero), noiseMinus1[2], finger),
+										 thresholdLanes(_mm_unpackhi_epi16(d1, zero), _mm_unpackhi_epi16(c1, zero), noiseMinus1[3], finger));
+			bits |= (bitword)(_mm_movemask_epi8(_mm_packs_epi16(m0, m1)) & 0xFFFF) << k;
+		}
+		dst[w] = bits;
+	}
+
+	if (w * 64 < width)
+	{
+		thresholdRowScalar(depth + w * 64, calibration + w * 64, noise != NULL ? noise + w * 64 : NULL, dst + w, width - w * 64, noise4, finger4);
+	}
+}
+#endif
+
+static void thresholdRow(SimdLevel level, const ushort* depth, const ushort* calibration, const byte* noise, bitword* dst, int width, int noise4, int finger4)
+{
+#ifdef SIMD_X86
+	if (level >= SimdSSE2)
+	{
+		thresholdRowSSE2(depth, calibration, noise, dst, width, noise4, finger4);
+		return;
+	}
+#endif
+	thresholdRowScalar(depth, calibration, noise, dst, width, noise4, finger4);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//pipeline
+
+static void carvePipeline(TouchPipeline* pipeline, Arena* arena)
+{
+	int words = packedStride(pipeline->width);
+	for (int k = 0; k < TOUCH_RING_SIZE; k++)
+	{
+		pipeline->thresholdRows[k] = arenaNew(arena, bitword, words);
+		pipeline->erodedRows[k] = arenaNew(arena, bitword, words);
+	}
+	pipeline->openedRow = arenaNew(arena, bitword, words);
+}
+
+DLL_EXPORT void* touchPipelineCreate(int width, int height)
+{
+	if (width <= 0 || height <= 0 || width > PACKED_MAX_WIDTH)
+	{
+		return NULL;
+	}
+
+	TouchPipeline* pipeline = new TouchPipeline();
+	pipeline->width = width;
+	pipeline->height = height;
+	pipeline->labeller = labellerCreate(width, height);
+
+	Arena arena = { NULL, 0 };
+	carvePipeline(pipeline, &arena);	//measure
+	pipeline->arena = arenaAllocate(&arena);
+	if (pipeline->arena == NULL || pipeline->labeller == NULL)
+	{
+		touchPipelineDestroy(pipeline);
+		return NULL;
+	}
+	carvePipeline(pipeline, &arena);
+
+	return pipeline;
+}
+
+proc_m touchPipelineDestroy(void* pipeline)
+{
+	TouchPipeline* touch = (TouchPipeline*)pipeline;
+	if (touch == NULL)
+	{
+		return 0;
+	}
+
+	labellerDestroy(touch->labeller);
+	arenaFree(touch->arena);
+	delete touch;
+	return 0;
+}
+
+proc_m touchPipelineWork(void* pipeline, ushort* srcDepthPtr, ushort* calibrationPtr, byte* noisePtr, int depthStride,
+						 double noiseThreshold, double fingerThreshold, int radius,
+						 int maxNum, int minArea, int* resultPtr, byte* dstPtr, int dstStride)
+{
+	static SimdLevel level = simdDetect();
+
+	TouchPipeline* touch = (TouchPipeline*)pipeline;
+	if (touch == NULL || radius < 1 || radius > PACKED_MAX_RADIUS)
+	{
+		return -1;
+	}
+
+	int width = touch->width, height = touch->height;
+	int ringSize = 2 * radius + 1;
+
+	//dist is a multiple of 1/4 mm, so these are exact: dist >= noise <=> dist4 >= ceil(noise * 4), the same for <
+	int noise4 = (int)ceil(noiseThreshold * (1 << TOUCH_CALIBRATION_SHIFT));
+	int finger4 = (int)ceil(fingerThreshold * (1 << TOUCH_CALIBRATION_SHIFT));
+
+	const bitword* rows[2 * PACKED_MAX_RADIUS + 1];
+	labellerBegin(touch->labeller);
+
+	for (int i = 0; i < height + 2 * radius; i++)
+	{
+		if (i < height)
+		{
+			thresholdRow(level, srcDepth(i, 0), calibrationPtr + i * depthStride, noisePtr != NULL ? noisePtr + i * depthStride : NULL,
+						 touch->thresholdRows[i % ringSize], width, noise4, finger4);
+		}
+
+		int erodeRow = i - radius;
+		if (erodeRow >= 0 && erodeRow < height)
+		{
+			for (int k = 0; k < ringSize; k++)
+			{
+				int row = erodeRow - radius + k;
+				rows[k] = (row >= 0 && row < height) ? touch->thresholdRows[row % ringSize] : NULL;
+			}
+			packedErodeRow(rows, touch->erodedRows[erodeRow % ringSize], width, StructSquare, radius);
+		}
+
+		int dilateRow = erodeRow - radius;
+		if (dilateRow >= 0 && dilateRow < height)
+		{
+			for (int k = 0; k < ringSize; k++)
+			{
+				int row = dilateRow - radius + k;
+				rows[k] = (row >= 0 && row < height) ? touch->erodedRows[row % ringSize] : NULL;
+			}
+			packedDilateRow(rows, touch->openedRow, width, StructSquare, radius);
+
+			if (labellerAddRow(touch->labeller, touch->openedRow, dilateRow, NULL) < 0)
+			{
+				return -1;
+			}
+			if (dstPtr != NULL)
+			{
+				unpackRows(touch->openedRow, dstPtr + dilateRow * dstStride, width, 0, 1, dstStride);
+			}
+		}
+	}
+
+	return labellerFinish(touch->labeller, maxNum, minArea, resultPtr, NULL);
+}
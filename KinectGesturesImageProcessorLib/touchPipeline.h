@@ -0,0 +1,40 @@
+#ifndef _TOUCH_PIPELINE_H_
+#define _TOUCH_PIPELINE_H_
+
+#include "depth.h"
+#include "labeller.h"
+
+//Multi-touch table pipeline: threshold against the calibrated table, open, then extract the finger blobs,
+//all in one streaming pass over the depth map. Only a few packed rows are alive at any time:
+//	threshold row i -> erode row i - r -> dilate row i - 2r -> label row i - 2r
+//The calibration map holds the table depth in Q14.2 fixed point (depth * 4), so it's 2 bytes per pixel.
+//backgroundModel.h builds it, together with an optional per pixel noise map.
+
+#define TOUCH_CALIBRATION_SHIFT 2
+#define TOUCH_RING_SIZE (2 * PACKED_MAX_RADIUS + 1)
+
+typedef struct TouchPipeline
+{
+	int width, height;
+	Labeller* labeller;
+
+	bitword* thresholdRows[TOUCH_RING_SIZE];	//ring of thresholded rows, row i in slot i % (2r+1)
+	bitword* erodedRows[TOUCH_RING_SIZE];		//ring of eroded rows
+	bitword* openedRow;
+
+	byte* arena;
+} TouchPipeline;
+
+DLL_EXPORT void* touchPipelineCreate(int width, int height);
+proc_m touchPipelineDestroy(void* pipeline);
+
+//calibrationPtr: table depth * 4, depthStride ushorts per row like srcDepthPtr. noisePtr (optional): per pixel noise
+//threshold * 4, depthStride bytes per row, see backgroundModel.h. It replaces noiseThreshold when given.
+//A pixel is finger when noiseThreshold <= table - depth < fingerThreshold (millimeters), then a (2r+1)x(2r+1) open
+//removes the speckles. Returns the num of fingers with centroid pairs (x, y) in resultPtr, biggest first, or -1.
+//dstPtr (optional) receives the opened black&white image, dstStride bytes per row.
+proc_m touchPipelineWork(void* pipeline, ushort* srcDepthPtr, ushort* calibrationPtr, byte* noisePtr, int depthStride,
+						 double noiseThreshold, double fingerThreshold, int radius,
+						 int maxNum, int minArea, int* resultPtr, byte* dstPtr, int dstStride);
+
+#endif
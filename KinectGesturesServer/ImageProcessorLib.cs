@@ -9,12 +9,75 @@ namespace KinectGesturesServer
         [DllImport("KinectGesturesImageProcessorLib.dll")]
         public static extern unsafe int open(byte* srcPtr, byte* dstPtr, int width, int height, int stride, byte* switchPtr);
 
+        //bit packed morphology: 64 pixels per ulong, rows are (width + 63) / 64 words apart. shape: 0 square, 1 cross; radius 1..7
         [DllImport("KinectGesturesImageProcessorLib.dll")]
-        public static extern unsafe int extractPoints(byte* srcPtr, byte* dstPtr, int width, int height, int stride, byte* switchPtr, int maxPointNum, int maxPointArea, int* resultPtr);
+        public static extern unsafe int packBits(byte* srcPtr, ulong* packedPtr, int width, int height, int stride);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int unpackBits(ulong* packedPtr, byte* dstPtr, int width, int height, int stride);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int packedErode(ulong* srcPtr, ulong* dstPtr, int width, int height, int shape, int radius);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int packedDilate(ulong* srcPtr, ulong* dstPtr, int width, int height, int shape, int radius);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int packedOpen(ulong* srcPtr, ulong* dstPtr, int width, int height, int shape, int radius, ulong* switchPtr);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int packedClose(ulong* srcPtr, ulong* dstPtr, int width, int height, int shape, int radius, ulong* switchPtr);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int extractPoints(byte* srcPtr, byte* dstPtr, int width, int height, int stride, byte* switchPtr, int maxPointNum, int minPointArea, int* resultPtr);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern IntPtr extractPointsCreate(int width, int height);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int extractPointsDestroy(IntPtr labeller);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int extractPointsEx(IntPtr labeller, byte* srcPtr, byte* dstPtr, int width, int height, int stride, int maxPointNum, int minPointArea, int* resultPtr, int* labelPtr);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern IntPtr touchPipelineCreate(int width, int height);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int touchPipelineDestroy(IntPtr pipeline);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int touchPipelineWork(IntPtr pipeline, ushort* srcDepthPtr, ushort* calibrationPtr, byte* noisePtr, int depthStride,
+                                                          double noiseThreshold, double fingerThreshold, int radius,
+                                                          int maxPointNum, int minPointArea, int* resultPtr, byte* dstPtr, int dstStride);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern IntPtr backgroundModelCreate(int width, int height, int depthStride);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int backgroundModelDestroy(IntPtr model);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int backgroundModelReset(IntPtr model);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int backgroundModelCalibrate(IntPtr model, ushort* srcDepthPtr);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int backgroundModelAdapt(IntPtr model, ushort* srcDepthPtr, int rateShift);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int backgroundModelSetNoise(IntPtr model, double noiseFactor, double minNoise);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int backgroundModelGetMaps(IntPtr model, ushort** meanPtr, byte** deviationPtr, byte** noisePtr);
 
         [DllImport("KinectGesturesImageProcessorLib.dll")]
         public static extern unsafe int derivativeFingerDetectorInit(ushort* srcDepthPtr, byte* dstPixelPtr, int width, int height, int depthStride, int pixelStride, int deviceMaxDepth, double realWorldXToZ, double realWorldYToZ);
 
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int derivativeFingerDetectorInitParallel(ushort* srcDepthPtr, byte* dstPixelPtr, int width, int height, int depthStride, int pixelStride, int deviceMaxDepth, double realWorldXToZ, double realWorldYToZ, int threadNum);
+
         [DllImport("KinectGesturesImageProcessorLib.dll")]
         public static extern unsafe int derivativeFingerDetectorDispose();
 
@@ -25,5 +88,316 @@ namespace KinectGesturesServer
 
         [DllImport("KinectGesturesImageProcessorLib.dll")]
         public static extern unsafe int derivativeFingerDetectorGetDerivativeFrame(int** hResPtr, int** vResPtr);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern IntPtr derivativeFingerDetectorCreate(int width, int height, int depthStride, int pixelStride, int deviceMaxDepth, double realWorldXToZ, double realWorldYToZ, int threadNum);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int derivativeFingerDetectorDestroy(IntPtr detector);
+
+        public const int FRAME_FULL = 0, FRAME_ROI = 1, FRAME_PYRAMID = 2;   //derivativeFingerDetectorGetFrameMode
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int derivativeFingerDetectorSetTracking(IntPtr detector, int enabled, int fullScanInterval, int padding);
+
+        //level 1: coarse pass at half resolution, 0: off
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int derivativeFingerDetectorSetPyramid(IntPtr detector, int level, int padding);
+
+        //camera: a camera model, see cameraModelCreate, the detector copies it
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int derivativeFingerDetectorSetCamera(IntPtr detector, IntPtr camera);
+
+        public const int QUALITY_FULL = 0, QUALITY_NO_IMAGE = 1, QUALITY_HALF_ROWS = 2, QUALITY_COARSE = 3;   //QualityLevel of detectorContext.h
+
+        //deadlineMillis 0: off, maxQuality: the lowest QUALITY_* level the detector may drop to
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int derivativeFingerDetectorSetDeadline(IntPtr detector, double deadlineMillis, int maxQuality);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int derivativeFingerDetectorGetQuality(IntPtr detector);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int derivativeFingerDetectorGetFrameMode(IntPtr detector, int* roiPtr);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int derivativeFingerDetectorSetLinking(IntPtr detector, int mode);    //0: first free overlap, 1: best overlap with branch / merge
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int derivativeFingerDetectorSetStreaming(IntPtr detector, int enabled);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int derivativeFingerDetectorRequestDerivativeFrame(IntPtr detector);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int derivativeFingerDetectorContextWork(IntPtr detector, ushort* srcDepthPtr, byte* dstPixelPtr,
+                                                                    double fingerWidthMin, double fingerWidthMax, double fingerLengthMin, double fingerLengthMax,
+                                                                    int maxPointNum, int* resultPtr, int* handHint);
+
+        public const int OUTPUT_NONE = 0, OUTPUT_IMAGE = 1, OUTPUT_OVERLAY = 2;  //outputFlags of derivativeFingerDetectorContextWorkEx
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int derivativeFingerDetectorContextWorkEx(IntPtr detector, ushort* srcDepthPtr, byte* dstPixelPtr,
+                                                                    double fingerWidthMin, double fingerWidthMax, double fingerLengthMin, double fingerLengthMax,
+                                                                    int maxPointNum, int* resultPtr, int* handHint, int outputFlags);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int derivativeFingerDetectorSetVisualization(IntPtr detector, int histogramInterval);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int derivativeFingerDetectorGetStrips(IntPtr detector, int* spanPtr, int maxSpans);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int derivativeFingerDetectorGetFingerPolylines(IntPtr detector, int* pointPtr, int maxPoints, int* pointNumPtr, int maxFingers);
+
+        public const int STAGE_STATS_FRAMES = 64, STAGE_NUM = 5, COUNT_NUM = 4;
+        public const int STAGE_SOBEL = 0, STAGE_STRIPS = 1, STAGE_FINGERS = 2, STAGE_OUTPUT = 3, STAGE_FRAME = 4;
+        public const int COUNT_STRIPS = 0, COUNT_CHAINS = 1, COUNT_FINGERS = 2, COUNT_REPORTED = 3;
+        public const int FRAME_STATS_SIZE = 3 + STAGE_NUM + COUNT_NUM;    //ints: frame, frameMode, quality, nanos, counts
+
+        //StageSnapshot of stageStats.h, Frames holds FrameNum FrameStats of FRAME_STATS_SIZE ints, oldest first
+        [StructLayout(LayoutKind.Sequential)]
+        public unsafe struct StageSnapshot
+        {
+            public int FrameNum;
+            public fixed int Frames[STAGE_STATS_FRAMES * FRAME_STATS_SIZE];
+            public fixed int MeanNanos[STAGE_NUM];
+            public fixed int MaxNanos[STAGE_NUM];
+        }
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int derivativeFingerDetectorGetStageStats(IntPtr detector, StageSnapshot* snapshotPtr);
+
+        //histogram equalized display images (histogram.h)
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern IntPtr depthHistogramCreate(int width, int height, int depthStride, int deviceMaxDepth, int threadNum);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int depthHistogramDestroy(IntPtr histogram);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int depthHistogramUpdate(IntPtr histogram, ushort* srcDepthPtr);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int depthHistogramColorize(IntPtr histogram, ushort* srcDepthPtr, byte* dstPixelPtr, int pixelStride);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int depthHistogramColorizeTable(IntPtr histogram, ushort* srcDepthPtr, ushort* calibrationPtr, byte* noisePtr,
+                                                                    double noiseThreshold, double fingerThreshold, byte* dstPixelPtr, int pixelStride);
+
+        //finger tracks with stable ids (fingerTracker.h)
+        public const int TRACKER_MAX_TRACKS = 16;
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct FingerTrack
+        {
+            public long Timestamp;      //microseconds
+            public double X;
+            public double Y;
+            public double Vx;           //pixels per second
+            public double Vy;
+            public int Id;
+            public int Age;
+            public int Missed;
+            public int Detection;       //index into the fingers of the frame, -1 when missed
+        }
+
+        //detector worker thread with triple-buffered frames and results (detectorWorker.h)
+        [StructLayout(LayoutKind.Sequential)]
+        public unsafe struct DetectorResult
+        {
+            public long Sequence;
+            public long Timestamp;
+            public long SubmitNanos;
+            public long DoneNanos;
+            public int FingerNum;
+            public int FrameMode;
+            public int OutputFlags;
+            public int TrackNum;
+            public int Quality;         //QUALITY_*, OutputFlags lacks OUTPUT_IMAGE from QUALITY_NO_IMAGE on
+            public int Reserved;
+            public fixed int HandHint[4];
+            public int* Fingers;
+            public byte* Image;
+            public FingerTrack* Tracks;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct DetectorWorkerStats
+        {
+            public long Submitted;
+            public long Processed;
+            public long Overwritten;
+            public long Dropped;
+            public long LatencyLastNanos;
+            public long LatencyAvgNanos;
+            public long LatencyMaxNanos;
+        }
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern IntPtr detectorWorkerCreate(IntPtr detector, int maxFingers);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int detectorWorkerDestroy(IntPtr worker);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int detectorWorkerSetMaxAge(IntPtr worker, int maxAgeMillis);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int detectorWorkerSubmit(IntPtr worker, ushort* srcDepthPtr, long timestamp,
+                                                                    double fingerWidthMin, double fingerWidthMax, double fingerLengthMin, double fingerLengthMax, int outputFlags);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe DetectorResult* detectorWorkerAcquire(IntPtr worker);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int detectorWorkerRelease(IntPtr worker, DetectorResult* result);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int detectorWorkerGetStats(IntPtr worker, DetectorWorkerStats* statsPtr);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int detectorWorkerPredict(IntPtr worker, DetectorResult* result, long timestamp, FingerTrack* tracksPtr);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int detectorWorkerSetTracker(IntPtr worker, double gate, double alpha, double beta, int maxMissed, int maxPredictMillis);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int detectorWorkerLockDetector(IntPtr worker);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int detectorWorkerUnlockDetector(IntPtr worker);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int detectorWorkerSnapshot(IntPtr worker, IntPtr capture, [MarshalAs(UnmanagedType.LPStr)] string path);
+
+        //debug snapshots written by a native thread (debugCapture.h), KinectGesturesTools/snapshotDump reads them
+        [StructLayout(LayoutKind.Sequential)]
+        public struct DebugCaptureStats
+        {
+            public int Taken;
+            public int Written;
+            public int Dropped;
+            public int Failed;
+        }
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern IntPtr debugCaptureCreate(int width, int height, int slotNum);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int debugCaptureDestroy(IntPtr capture);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int debugCaptureGetStats(IntPtr capture, DebugCaptureStats* statsPtr);
+
+        //binary result publisher (resultPublisher.h), KinectGesturesTools/publisherClient reads it
+        public const int HAND_CREATE = 1, HAND_UPDATE = 2, HAND_DESTROY = 3;
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct PublisherStats
+        {
+            public long Published;
+            public long Sent;
+            public long Skipped;
+            public long Overflowed;
+            public long LostEvents;
+            public long Bytes;
+            public int Clients;
+            public int Accepted;
+            public int Refused;
+            public int Disconnected;
+        }
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern IntPtr resultPublisherCreate([MarshalAs(UnmanagedType.LPStr)] string address, int port, int maxClients, int queueBytes, int dropAfter);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int resultPublisherDestroy(IntPtr publisher);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int resultPublisherGetPort(IntPtr publisher);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int resultPublisherAddHandEvent(IntPtr publisher, int type, int userId, int x, int y, int z);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int resultPublisherPublishFrame(IntPtr publisher, long frame, long timestamp, int* fingers, int fingerNum, int* handHint);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int resultPublisherGetStats(IntPtr publisher, PublisherStats* statsPtr);
+
+        //offline reprocessing across frames and parameter sets (batchDetector.h), job k = frame * paramNum + param
+        [StructLayout(LayoutKind.Sequential)]
+        public struct BatchParams
+        {
+            public double FingerWidthMin, FingerWidthMax;
+            public double FingerLengthMin, FingerLengthMax;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public unsafe struct BatchResults
+        {
+            public int* FingerNum;
+            public int* Fingers;            //2 * maxFingers per job
+            public int* HandHint;           //4 per job, or null
+            public int* FrameNanos;         //or null
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct BatchStats
+        {
+            public long Jobs;
+            public long WallNanos;
+            public long BusyNanos;
+            public int ThreadNum;
+            public int Reserved;
+        }
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern IntPtr batchDetectorCreate(int width, int height, int depthStride, int deviceMaxDepth, double realWorldXToZ, double realWorldYToZ, int threadNum);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int batchDetectorDestroy(IntPtr batch);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int batchDetectorSetCamera(IntPtr batch, IntPtr camera);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int batchDetectorRun(IntPtr batch, ushort** frames, int frameNum, BatchParams* parameters, int paramNum, int maxFingers, BatchResults* results);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int batchDetectorGetStats(IntPtr batch, BatchStats* statsPtr);
+
+        //pinhole model of the depth camera (cameraModel.h), points are (x, y, depth) projective and (x, y, z) real world triplets
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern IntPtr cameraModelCreate(int width, int height, double fx, double fy, double cx, double cy);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern IntPtr cameraModelFit(int width, int height, double[] projective, double[] realWorld, int pointNum);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int cameraModelDestroy(IntPtr camera);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int cameraModelGetIntrinsics(IntPtr camera, [Out] double[] intrinsics);  //fx, fy, cx, cy
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int cameraModelProjectiveToRealWorld(IntPtr camera, int* pointPtr, int pointNum, double* resultPtr);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int cameraModelDistSquared(IntPtr camera, int* firstPtr, int* secondPtr, int pointNum, double* resultPtr);
+
+        //raw depth sequence files (depthSequence.h), replayed by KinectGesturesTools/replayBench
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern IntPtr depthSequenceCreate([MarshalAs(UnmanagedType.LPStr)] string path, int width, int height, int deviceMaxDepth, double realWorldXToZ, double realWorldYToZ, int maxFrames);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int depthSequenceWrite(IntPtr sequence, ushort* srcDepthPtr, int depthStride, long timestamp);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern int depthSequenceClose(IntPtr sequence);
+
+        [DllImport("KinectGesturesImageProcessorLib.dll")]
+        public static extern unsafe int derivativeFingerDetectorContextGetDerivativeFrame(IntPtr detector, int** hResPtr, int** vResPtr);
     }
 }
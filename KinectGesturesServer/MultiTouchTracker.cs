@@ -23,14 +23,15 @@ namespace KinectGesturesServer
         private long calibrationDuration;
         private long calibrationStartTime;
         private int calibratedFrame;
-        private double[,] calibrationMap;
+        private IntPtr backgroundModel;     //native table model: depth * 4 (Q14.2) and noise threshold * 4 per pixel
 
         public CalibrationState CalibrationState { get; private set; }
         #endregion
 
         #region buffers for multi-touch sensing
-        //These 3 buffers are allocated for image processing.
-        private byte[] bufferSrc, bufferDst, bufferSwitch;
+        //Threshold, open and extraction run natively in one pass, bufferDst only receives the opened image for display.
+        private IntPtr touchPipeline;
+        private byte[] bufferDst;
         private int[] fingersRaw;   //data returned from native side
 
         public List<Point3D> Fingers { get; private set; }
@@ -50,6 +51,11 @@ namespace KinectGesturesServer
         public double BlindThreshold { get; set; }
         public double FingerThreshold { get; set; }
         public double NoiseThreshold { get; set; }
+
+        //per pixel noise threshold = max(NoiseThreshold, NoiseDeviationFactor * mean deviation of the pixel while calibrating)
+        public double NoiseDeviationFactor { get; set; }
+        //after calibration the table model follows slow drift with weight 2^-BackgroundAdaptationShift per frame, 0 = off
+        public int BackgroundAdaptationShift { get; set; }
         #endregion
 
         #region Bitmap
@@ -65,45 +71,13 @@ namespace KinectGesturesServer
                     unsafe
                     {
                         ushort* pDepth = (ushort*)sensor.DepthGenerator.DepthMapPtr.ToPointer();
+                        ushort* pTable;
+                        byte* pNoise;
+                        ImageProcessorLib.backgroundModelGetMaps(backgroundModel, &pTable, null, &pNoise);
 
-                        for (int y = 0; y < sensor.DepthMetaData.YRes; ++y)
-                        {
-                            byte* pDest = (byte*)bitmap.BackBuffer.ToPointer() + y * bitmap.BackBufferStride;
-                            for (int x = 0; x < sensor.DepthMetaData.XRes; ++x, ++pDepth, pDest += 3)
-                            {
-                                if (CalibrationState == CalibrationState.Finished)
-                                {
-                                    double dist = calibrationMap[y, x] - *pDepth;
-                                    byte gray = (byte)sensor.Histogram[*pDepth];
-
-                                    //pDest[0] = pDest[1] = pDest[2] = (byte)sensor.Histogram[(int)calibrationMap[y, x]];
-                                    pDest[0] = pDest[1] = pDest[2] = 0;
-
-                                    if (dist < NoiseThreshold)
-                                    {
-                                        pDest[2] = 0xFF;    //to near: blue
-                                    }
-                                    else if (dist < FingerThreshold)
-                                    {
-                                        pDest[0] = 0xFF;    //finger: red
-                                    }
-                                    else if (dist < BlindThreshold)
-                                    {
-                                        pDest[1] = 0xFF;    //too far: green
-                                    }
-                                    else
-                                    {
-                                        pDest[1] = 0xFF;
-                                    }
-
-                                }
-                                else
-                                {
-                                    pDest[0] = pDest[1] = pDest[2] = (byte)sensor.Histogram[*pDepth];
-                                    //pDest[0] = pDest[1] = pDest[2] = 0;
-                                }
-                            }
-                        }
+                        //too near: blue, finger: red, too far: green. The gray depth view until the table is calibrated.
+                        ImageProcessorLib.depthHistogramColorizeTable(sensor.DepthHistogram, pDepth, CalibrationState == CalibrationState.Finished ? pTable : null,
+                            pNoise, NoiseThreshold, FingerThreshold, (byte*)bitmap.BackBuffer.ToPointer(), bitmap.BackBufferStride);
                     }
 
                     bitmap.AddDirtyRect(new Int32Rect(0, 0, sensor.DepthMetaData.XRes, sensor.DepthMetaData.YRes));
@@ -133,7 +107,7 @@ namespace KinectGesturesServer
                         unsafe
                         {
                             byte* pDest = (byte*)resultBitmap.BackBuffer.ToPointer();
-                            for (int i = 0; i < calibrationMap.Length; i++, pDest += 3)
+                            for (int i = 0; i < bufferDst.Length; i++, pDest += 3)
                             {
                                 pDest[0] = pDest[1] = pDest[2] = bufferDst[i];
                             }
@@ -162,10 +136,18 @@ namespace KinectGesturesServer
             bitmap = new WriteableBitmap(width, height, NuiSensor.DPI_X, NuiSensor.DPI_Y, PixelFormats.Rgb24, null);
             resultBitmap = new WriteableBitmap(width, height, NuiSensor.DPI_X, NuiSensor.DPI_Y, PixelFormats.Rgb24, null);
 
-            int bufferSize = width * height;
-            bufferSrc = new byte[bufferSize];
-            bufferSwitch = new byte[bufferSize];
-            bufferDst = new byte[bufferSize];
+            bufferDst = new byte[width * height];
+            touchPipeline = ImageProcessorLib.touchPipelineCreate(width, height);
+            if (touchPipeline == IntPtr.Zero)
+            {
+                throw new OutOfMemoryException("Failed to create the native touch pipeline");
+            }
+            backgroundModel = ImageProcessorLib.backgroundModelCreate(width, height, width);
+            if (backgroundModel == IntPtr.Zero)
+            {
+                throw new OutOfMemoryException("Failed to create the native background model");
+            }
+            NoiseDeviationFactor = 3;
 
             fingersRaw = new int[MAX_FINGERS * 2];
             Fingers = new List<Point3D>(MAX_FINGERS);
@@ -194,20 +176,10 @@ namespace KinectGesturesServer
             if (CalibrationState == CalibrationState.Requested)
             {
                 calibrationStartTime = e.DepthMetaData.Timestamp;
-                calibrationMap = new double[e.DepthMetaData.YRes, e.DepthMetaData.XRes];
-
+                ImageProcessorLib.backgroundModelReset(backgroundModel);
                 unsafe
                 {
-                    ushort* pDepth = (ushort*)e.DepthMetaData.DepthMapPtr.ToPointer();
-
-                    fixed (double* calibrationMapPtr = calibrationMap)
-                    {
-                        double* pDest = calibrationMapPtr;
-                        for (int i = 0; i < calibrationMap.Length; ++i, ++pDepth, ++pDest)
-                        {
-                            *pDest = *pDepth;
-                        }
-                    }
+                    ImageProcessorLib.backgroundModelCalibrate(backgroundModel, (ushort*)e.DepthMetaData.DepthMapPtr.ToPointer());
                 }
 
                 calibratedFrame = 1;
@@ -217,20 +189,13 @@ namespace KinectGesturesServer
             {
                 unsafe
                 {
-                    ushort* pDepth = (ushort*)e.DepthMetaData.DepthMapPtr.ToPointer();
-
-                    fixed (double* calibrationMapPtr = calibrationMap)
-                    {
-                        double* pDest = calibrationMapPtr;
-                        for (int i = 0; i < calibrationMap.Length; ++i, ++pDepth, ++pDest)
-                        {
-                            *pDest = (*pDest * calibratedFrame + *pDepth) / (double)(calibratedFrame + 1);
-                        }
-                    }
+                    ImageProcessorLib.backgroundModelCalibrate(backgroundModel, (ushort*)e.DepthMetaData.DepthMapPtr.ToPointer());
                 }
 
                 if (e.DepthMetaData.Timestamp - calibrationStartTime >= calibrationDuration)
                 {
+                    ImageProcessorLib.backgroundModelSetNoise(backgroundModel, NoiseDeviationFactor, NoiseThreshold);
+
                     CalibrationState = CalibrationState.Finished;
                     if (calibrationFinishedHandler != null)
                     {
@@ -243,52 +208,35 @@ namespace KinectGesturesServer
             else if (CalibrationState == CalibrationState.Finished)
             {
                 recognizeFingers(e.DepthMetaData);
-            }
-        }
 
-        private void recognizeFingers(OpenNI.DepthMetaData depthMetaData)
-        {
-            //filter bitmap and save it to bufferSrc
-            lock (bufferSrc)
-            {
-                unsafe
+                if (BackgroundAdaptationShift > 0)
                 {
-                    ushort* pDepth = (ushort*)depthMetaData.DepthMapPtr.ToPointer();
-
-                    fixed (double* calibrationMapPtr = calibrationMap)
+                    unsafe
                     {
-                        double* pCal = calibrationMapPtr;
-                        for (int i = 0; i < calibrationMap.Length; ++i, ++pDepth, ++pCal)
-                        {
-                            double dist = *pCal - (double)*pDepth;
-                            bufferSrc[i] = (byte)(dist >= NoiseThreshold && dist < FingerThreshold ? 0xFF : 0);
-                        }
+                        ImageProcessorLib.backgroundModelAdapt(backgroundModel, (ushort*)e.DepthMetaData.DepthMapPtr.ToPointer(), BackgroundAdaptationShift);
                     }
                 }
             }
+        }
 
-            //do open operation
+        private void recognizeFingers(OpenNI.DepthMetaData depthMetaData)
+        {
+            //threshold against the table, open and extract points, all in one native pass
+            int fingersNum;
             lock (bufferDst)
             {
                 unsafe
                 {
-                    fixed (byte* bufferSrcPtr = bufferSrc, bufferDstPtr = bufferDst, bufferSwitchPtr = bufferSwitch)
-                    {
-                        ImageProcessorLib.open(bufferSrcPtr, bufferDstPtr,width, height, width, bufferSwitchPtr);
-                    }
-                }
-            }
+                    ushort* pDepth = (ushort*)depthMetaData.DepthMapPtr.ToPointer();
+                    ushort* pTable;
+                    byte* pNoise;
+                    ImageProcessorLib.backgroundModelGetMaps(backgroundModel, &pTable, null, &pNoise);
 
-            //extract point!
-            int fingersNum;
-            unsafe
-            {
-                fixed (byte* bufferSrcPtr = bufferSrc, bufferDstPtr = bufferDst, bufferSwitchPtr = bufferSwitch)
-                {
+                    fixed (byte* bufferDstPtr = bufferDst)
                     fixed (int* fingersRawPtr = fingersRaw)
                     {
-                        fingersNum = ImageProcessorLib.extractPoints(bufferDstPtr, null, width, height, width, 
-                            bufferSwitchPtr, MAX_FINGERS, 20, fingersRawPtr);
+                        fingersNum = ImageProcessorLib.touchPipelineWork(touchPipeline, pDepth, pTable, pNoise, width,
+                            NoiseThreshold, FingerThreshold, 1, MAX_FINGERS, 20, fingersRawPtr, bufferDstPtr, width);
                     }
                 }
             }
@@ -299,6 +247,14 @@ namespace KinectGesturesServer
                 Fingers.Add(new Point3D(fingersRaw[2 * i], fingersRaw[2 * i + 1], 0));  //TODO: depth
             }
         }
+
+        public void Dispose()
+        {
+            ImageProcessorLib.touchPipelineDestroy(touchPipeline);
+            touchPipeline = IntPtr.Zero;
+            ImageProcessorLib.backgroundModelDestroy(backgroundModel);
+            backgroundModel = IntPtr.Zero;
+        }
     }
 
     public enum CalibrationState
@@ -6,7 +6,6 @@ using OpenNI;
 using System.Windows.Media.Imaging;
 using System.Windows;
 using System.Windows.Media;
-using System.IO;
 using System.Runtime.InteropServices;
 using System.Diagnostics;
 
@@ -16,25 +15,115 @@ namespace KinectGesturesServer
     {
         private const int MAX_FINGERS = 10;
         private const int HAND_CHANGE_CONFIDENCE_THRESHOLD = 20;
+        private const int TRACKING_FULL_SCAN_INTERVAL = 30;    //frames between full scans while fingers are tracked
+        private const int TRACKING_PADDING = 32;               //pixels around the last fingers
+        private const int CAPTURE_SLOTS = 2;                   //debug snapshots waiting for the native writer at a time
+        private const double FRAME_DEADLINE_MILLIS = 33;       //one frame at 30 fps, the detector degrades past it
+        private static readonly string[] STAGE_NAMES = { "sobel", "strips", "fingers", "output", "frame" };
 
         private NuiSensor sensor;
         private int width, height;
 
         private int lastHandDetectConfidence = 0;
 
-        #region buffers for multi-touch sensing
-        private byte[] bufferOutputColored; 
-        private int[] fingersRaw;   //data returned from native side
-        #endregion
+        private IntPtr detector;    //native detector context, one per tracker
+        private IntPtr worker;      //runs the detector off the camera thread
+        private IntPtr capture;     //writes the debug snapshots of sensor_CaptureRequested
+        private long lastResultSequence = 0;
+        private readonly int[] handHint = new int[4];   //of the last result, camera thread only
+
+        //the last result, written on the camera thread under resultLock: a frame allocates nothing managed
+        private readonly object resultLock = new object();
+        private readonly int[] fingersRaw = new int[2 * MAX_FINGERS];
+        private int fingerNum = 0;
+        private readonly ImageProcessorLib.FingerTrack[] tracks = new ImageProcessorLib.FingerTrack[ImageProcessorLib.TRACKER_MAX_TRACKS];
+        private int trackNum = 0;
+        private readonly ResultEventArgs resultArgs = new ResultEventArgs();
 
         private WriteableBitmap outputImageSource;
 
-        public List<Point3D> Fingers { get; private set; }
+        //raised on the camera thread for every new result of the detector. The arguments are reused for the next result,
+        //copy what a handler keeps.
+        public event EventHandler<ResultEventArgs> ResultUpdated;
+
+        //a new list of the last result on every get, for the readers on other threads
+        public List<Point3D> Fingers
+        {
+            get
+            {
+                lock (resultLock)
+                {
+                    List<Point3D> fingers = new List<Point3D>(fingerNum);
+                    for (int i = 0; i < fingerNum; i++)
+                    {
+                        fingers.Add(new Point3D(fingersRaw[2 * i], fingersRaw[2 * i + 1], 0));
+                    }
+                    return fingers;
+                }
+            }
+        }
+
+        //the fingers with stable ids, extrapolated to when the result was picked up: the worker's latency is hidden.
+        //A new array on every get, like Fingers.
+        public ImageProcessorLib.FingerTrack[] Tracks
+        {
+            get
+            {
+                lock (resultLock)
+                {
+                    ImageProcessorLib.FingerTrack[] copy = new ImageProcessorLib.FingerTrack[trackNum];
+                    Array.Copy(tracks, copy, trackNum);
+                    return copy;
+                }
+            }
+        }
         public double FingerWidthMin { get; set; }
         public double FingerWidthMax { get; set; }
         public double FingerLengthMax { get; set; }
         public double FingerLengthMin { get; set; }
 
+        //projective to real world factors of the camera model fitted by fitCameraModel, width / fx and height / fy
+        public double RealWorldXToZ { get; private set; }
+        public double RealWorldYToZ { get; private set; }
+
+        //draw the debug image for OutputImageSource, detecting alone is several times faster
+        public bool Visualize { get; set; }
+
+        //how often the detector could stay on the region around the last fingers
+        public long FullFrames { get; private set; }
+        public long RoiFrames { get; private set; }
+        //frames the detector ran below full quality to keep up with the sensor
+        public long DegradedFrames { get; private set; }
+
+        //frames between two traces of the native stage timings, 0 for none
+        public int StageLogInterval { get; set; }
+
+        //frames older than this when the detector gets to them are skipped, 0 for none
+        public int MaxFrameAgeMillis
+        {
+            get { return maxFrameAgeMillis; }
+            set
+            {
+                maxFrameAgeMillis = value;
+                ImageProcessorLib.detectorWorkerSetMaxAge(worker, value);
+            }
+        }
+        private int maxFrameAgeMillis;
+
+        //frames submitted / detected / replaced by newer ones / skipped as stale, and the capture to result latency
+        public ImageProcessorLib.DetectorWorkerStats WorkerStats
+        {
+            get
+            {
+                ImageProcessorLib.DetectorWorkerStats stats;
+                unsafe
+                {
+                    ImageProcessorLib.detectorWorkerGetStats(worker, &stats);
+                }
+                return stats;
+            }
+        }
+
         public WriteableBitmap OutputImageSource
         {
             get
@@ -43,12 +132,15 @@ namespace KinectGesturesServer
 
                 unsafe
                 {
-                    lock (bufferOutputColored)
+                    //straight from the native result slot, the worker doesn't touch it until released
+                    ImageProcessorLib.DetectorResult* result = ImageProcessorLib.detectorWorkerAcquire(worker);
+                    if (result != null)
                     {
-                        fixed (byte* bufferOutputColoredPtr = bufferOutputColored)
+                        if ((result->OutputFlags & ImageProcessorLib.OUTPUT_IMAGE) != 0)
                         {
-                            outputImageSource.WritePixels(new Int32Rect(0, 0, width, height), (IntPtr)bufferOutputColoredPtr, width * height * 3, width * 3);
+                            outputImageSource.WritePixels(new Int32Rect(0, 0, width, height), (IntPtr)result->Image, width * height * 3, width * 3);
                         }
+                        ImageProcessorLib.detectorWorkerRelease(worker, result);
                     }
                 }
 
@@ -69,91 +161,141 @@ namespace KinectGesturesServer
 
             outputImageSource = new WriteableBitmap(width, height, NuiSensor.DPI_X, NuiSensor.DPI_Y, PixelFormats.Rgb24, null);
 
-            fingersRaw = new int[MAX_FINGERS * 2];
-            Fingers = new List<Point3D>(MAX_FINGERS);
-
-            int bufferSize = width * height * 3;
-            bufferOutputColored = new byte[bufferSize];
+            Visualize = true;
+            StageLogInterval = 300;
 
             sensor.CaptureRequested += new EventHandler<NuiSensor.CaptureEventArgs>(sensor_CaptureRequested);
 
-            double realWorldXToZ, realWorldYToZ;
-            hackXnConvertProjectiveToRealWorld(out realWorldXToZ, out realWorldYToZ);
+            IntPtr camera = fitCameraModel();
+            double[] intrinsics = new double[4];    //fx, fy, cx, cy
+            ImageProcessorLib.cameraModelGetIntrinsics(camera, intrinsics);
+            RealWorldXToZ = width / intrinsics[0];
+            RealWorldYToZ = height / intrinsics[1];
 
-            unsafe
+            detector = ImageProcessorLib.derivativeFingerDetectorCreate(width, height, width, width * 3, sensor.DepthGenerator.DeviceMaxDepth, RealWorldXToZ, RealWorldYToZ, Environment.ProcessorCount);
+            if (detector == IntPtr.Zero)
             {
-                ImageProcessorLib.derivativeFingerDetectorInit(null, null, width, height, width, width * 3, sensor.DepthGenerator.DeviceMaxDepth, realWorldXToZ, realWorldYToZ);
+                ImageProcessorLib.cameraModelDestroy(camera);
+                throw new OutOfMemoryException("Failed to create the native finger detector");
+            }
+            //the fitted centre as well, the factors alone assume the frame centre
+            ImageProcessorLib.derivativeFingerDetectorSetCamera(detector, camera);
+            ImageProcessorLib.cameraModelDestroy(camera);
+            ImageProcessorLib.derivativeFingerDetectorSetTracking(detector, 1, TRACKING_FULL_SCAN_INTERVAL, TRACKING_PADDING);
+            //without the half resolution level when it can't be had, the other levels still help
+            if (ImageProcessorLib.derivativeFingerDetectorSetDeadline(detector, FRAME_DEADLINE_MILLIS, ImageProcessorLib.QUALITY_COARSE) < 0)
+            {
+                ImageProcessorLib.derivativeFingerDetectorSetDeadline(detector, FRAME_DEADLINE_MILLIS, ImageProcessorLib.QUALITY_HALF_ROWS);
+            }
+
+            worker = ImageProcessorLib.detectorWorkerCreate(detector, MAX_FINGERS);
+            if (worker == IntPtr.Zero)
+            {
+                ImageProcessorLib.derivativeFingerDetectorDestroy(detector);
+                throw new OutOfMemoryException("Failed to create the native detector worker");
+            }
+
+            capture = ImageProcessorLib.debugCaptureCreate(width, height, CAPTURE_SLOTS);
+            if (capture == IntPtr.Zero)
+            {
+                ImageProcessorLib.detectorWorkerDestroy(worker);
+                ImageProcessorLib.derivativeFingerDetectorDestroy(detector);
+                throw new OutOfMemoryException("Failed to create the native debug capture");
             }
         }
 
+        //the worker copies its next frame with the derivative, strips and fingers, a native thread writes the file:
+        //detection goes on meanwhile. KinectGesturesTools/snapshotDump turns the snapshot into CSV and PNG files.
         void sensor_CaptureRequested(object sender, NuiSensor.CaptureEventArgs e)
         {
-            string fileNameH = e.Folder + e.FileNamePrefix + "derivativeH.csv";
-            string fileNameV = e.Folder + e.FileNamePrefix + "derivativeV.csv";
-            string fileNameBmp = e.Folder + e.FileNamePrefix + "derivative.bmp";
-
-            StreamWriter swH = new StreamWriter(fileNameH);
-            StreamWriter swV = new StreamWriter(fileNameV);
-
-            lock (bufferOutputColored)
+            string fileName = e.Folder + e.FileNamePrefix + "snapshot.kgs";
+            if (ImageProcessorLib.detectorWorkerSnapshot(worker, capture, fileName) != 0)
             {
-                unsafe
-                {
-                    int* hDerivativeRes, vDerivativeRes;
-                    ImageProcessorLib.derivativeFingerDetectorGetDerivativeFrame(&hDerivativeRes, &vDerivativeRes);
-
-                    for (int i = 0; i < height; i++)
-                    {
-                        for (int j = 0; j < width; j++)
-                        {
-                            swH.Write(hDerivativeRes[i * width + j].ToString() + ", ");
-                            swV.Write(vDerivativeRes[i * width + j].ToString() + ", ");
-                        }
-                        swH.WriteLine();
-                        swV.WriteLine();
-                    }
-                }
+                Trace.WriteLine("Snapshot " + fileName + " skipped, the previous one is still pending");
             }
 
-            swH.Close();
-            swV.Close();
-
-            BmpBitmapEncoder bmpEncoder = new BmpBitmapEncoder();
-            bmpEncoder.Frames.Add(BitmapFrame.Create(outputImageSource));
-            FileStream fs = new FileStream(fileNameBmp, FileMode.Create);
-            bmpEncoder.Save(fs);
-            fs.Close();
+            ImageProcessorLib.DebugCaptureStats captureStats;
+            unsafe
+            {
+                ImageProcessorLib.debugCaptureGetStats(capture, &captureStats);
+            }
+            Trace.WriteLine(string.Format("Snapshots: {0} taken, {1} written, {2} dropped, {3} failed",
+                captureStats.Taken, captureStats.Written, captureStats.Dropped, captureStats.Failed));
         }
 
+        //the camera thread only hands the frame over, then picks up whatever the worker finished since the last frame
         void sensor_FrameUpdate(object sender, NuiSensor.FrameUpdateEventArgs e)
         {
-            int fingersNum = 0;
-            int[] handHint = new int[4];
+            bool updated = false;
 
-            lock (bufferOutputColored)
+            unsafe
             {
-                unsafe
+                ushort* pDepth = (ushort*)e.DepthMetaData.DepthMapPtr.ToPointer();
+                ImageProcessorLib.detectorWorkerSubmit(worker, pDepth, (long)e.DepthMetaData.Timestamp,
+                    FingerWidthMin, FingerWidthMax, FingerLengthMin, FingerLengthMax,
+                    Visualize ? ImageProcessorLib.OUTPUT_IMAGE : ImageProcessorLib.OUTPUT_NONE);
+
+                ImageProcessorLib.DetectorResult* result = ImageProcessorLib.detectorWorkerAcquire(worker);
+                if (result == null)
                 {
-                    fixed (byte* bufferOutputColorPtr = bufferOutputColored)
+                    return;
+                }
+
+                if (result->Sequence != lastResultSequence)
+                {
+                    lastResultSequence = result->Sequence;
+                    updated = true;
+                    for (int i = 0; i < 4; i++)
                     {
-                        fixed (int* fingerRawPtr = fingersRaw, handHintPtr = handHint)
+                        handHint[i] = result->HandHint[i];
+                    }
+
+                    lock (resultLock)
+                    {
+                        fingerNum = Math.Min(result->FingerNum, MAX_FINGERS);
+                        Marshal.Copy((IntPtr)result->Fingers, fingersRaw, 0, 2 * fingerNum);
+                        fixed (ImageProcessorLib.FingerTrack* tracksPtr = tracks)
                         {
-                            ushort* pDepth = (ushort*)sensor.DepthMetaData.DepthMapPtr.ToPointer();
-                            fingersNum = ImageProcessorLib.derivativeFingerDetectorWork(pDepth, bufferOutputColorPtr, width, height, width, width * 3, 
-                                FingerWidthMin, FingerWidthMax, FingerLengthMin, FingerLengthMax, 
-                                MAX_FINGERS, fingerRawPtr, handHintPtr);
+                            trackNum = ImageProcessorLib.detectorWorkerPredict(worker, result, 0, tracksPtr);
                         }
                     }
+                    resultArgs.Set(result->Sequence, result->Timestamp, fingersRaw, fingerNum, handHint, tracks, trackNum);
+
+                    if (result->FrameMode == ImageProcessorLib.FRAME_ROI)
+                    {
+                        RoiFrames++;
+                    }
+                    else
+                    {
+                        FullFrames++;
+                    }
+                    if (result->Quality != ImageProcessorLib.QUALITY_FULL)
+                    {
+                        DegradedFrames++;
+                    }
                 }
+
+                ImageProcessorLib.detectorWorkerRelease(worker, result);
+            }
+
+            if (!updated)
+            {
+                return;
+            }
+
+            //only the camera thread writes the buffers, so the handlers read them without the lock
+            EventHandler<ResultEventArgs> resultUpdated = ResultUpdated;
+            if (resultUpdated != null)
+            {
+                resultUpdated(this, resultArgs);
             }
 
-            Fingers.Clear();
-            for (int i = 0; i < fingersNum; i++)
+            if (StageLogInterval > 0 && (FullFrames + RoiFrames) % StageLogInterval == 0)
             {
-                Fingers.Add(new Point3D(fingersRaw[2 * i], fingersRaw[2 * i + 1], 0)); 
+                TraceStageStats();
             }
 
-            if (Fingers.Count > 0 && (!sensor.HandTracker.IsTracking || handHint[3] - lastHandDetectConfidence > HAND_CHANGE_CONFIDENCE_THRESHOLD))
+            if (fingerNum > 0 && (!sensor.HandTracker.IsTracking || handHint[3] - lastHandDetectConfidence > HAND_CHANGE_CONFIDENCE_THRESHOLD))
             {
                 sensor.HandTracker.HandDestroy += new EventHandler<HandDestroyEventArgs>(HandTracker_HandDestroy);
                 sensor.HandTracker.StartTrackingAt(new Point3D(handHint[0], handHint[1], handHint[2]));
@@ -162,6 +304,32 @@ namespace KinectGesturesServer
             }
         }
 
+        //rolling stage budgets over the last frames, mean / max in milliseconds
+        private unsafe void TraceStageStats()
+        {
+            ImageProcessorLib.StageSnapshot snapshot;
+            if (ImageProcessorLib.derivativeFingerDetectorGetStageStats(detector, &snapshot) <= 0)
+            {
+                return;
+            }
+
+            StringBuilder sb = new StringBuilder("Stages over " + snapshot.FrameNum + " frames:");
+            for (int s = 0; s < ImageProcessorLib.STAGE_NUM; s++)
+            {
+                sb.AppendFormat(" {0} {1:F2}/{2:F2}", STAGE_NAMES[s], snapshot.MeanNanos[s] / 1e6, snapshot.MaxNanos[s] / 1e6);
+            }
+
+            int* lastFrame = snapshot.Frames + (snapshot.FrameNum - 1) * ImageProcessorLib.FRAME_STATS_SIZE;
+            int* last = lastFrame + 3 + ImageProcessorLib.STAGE_NUM;
+            sb.AppendFormat(", last frame {0} strips {1} chains {2} fingers at quality {3}, {4} degraded frames",
+                last[ImageProcessorLib.COUNT_STRIPS], last[ImageProcessorLib.COUNT_CHAINS], last[ImageProcessorLib.COUNT_FINGERS], lastFrame[2], DegradedFrames);
+            Trace.WriteLine(sb.ToString());
+
+            ImageProcessorLib.DetectorWorkerStats stats = WorkerStats;
+            Trace.WriteLine(string.Format("Worker: {0} submitted, {1} detected, {2} overwritten, {3} dropped, latency {4:F2}/{5:F2} ms",
+                stats.Submitted, stats.Processed, stats.Overwritten, stats.Dropped, stats.LatencyAvgNanos / 1e6, stats.LatencyMaxNanos / 1e6));
+        }
+
         void HandTracker_HandDestroy(object sender, HandDestroyEventArgs e)
         {
             lastHandDetectConfidence = 0;
@@ -169,38 +337,72 @@ namespace KinectGesturesServer
         }
 
         /// <summary>
-        /// We need to call xnConvertProjectiveToRealWorld in the native side, but impossible. In this function, 2 internal parameters are used. We use this hack to solve the 2 unknown parameter.
+        /// xnConvertProjectiveToRealWorld can't be called on the native side, so the intrinsics of the depth camera are fitted
+        /// to what it returns for some sample points. Returns the native camera model, the caller destroys it.
         /// </summary>
-        private void hackXnConvertProjectiveToRealWorld(out double realWorldXToZ, out double realWorldYToZ)
+        private IntPtr fitCameraModel()
         {
+            const int SAMPLES = 100;
             Random random = new Random(0);
-            Point3D[] testPoints = new Point3D[100];
+            Point3D[] testPoints = new Point3D[SAMPLES];
 
-            for (int i = 0; i < 100; i++)
+            for (int i = 0; i < SAMPLES; i++)
             {
                 testPoints[i] = new Point3D(random.Next(0, width - 1), random.Next(0, height - 1), random.Next(0, sensor.DepthGenerator.DeviceMaxDepth - 1));
             }
 
             Point3D[] testResults = sensor.DepthGenerator.ConvertProjectiveToRealWorld(testPoints);
-            realWorldXToZ = 0;
-            realWorldYToZ = 0;
-            for (int i = 0; i < testPoints.Length; i++)
+            double[] projective = new double[3 * SAMPLES];
+            double[] realWorld = new double[3 * SAMPLES];
+            for (int i = 0; i < SAMPLES; i++)
             {
-                realWorldXToZ += testResults[i].X / (testPoints[i].X / width - 0.5) / testResults[i].Z;
-                realWorldYToZ += testResults[i].Y / (0.5 - testPoints[i].Y / height) / testResults[i].Z;
+                projective[3 * i] = testPoints[i].X;
+                projective[3 * i + 1] = testPoints[i].Y;
+                projective[3 * i + 2] = testPoints[i].Z;
+                realWorld[3 * i] = testResults[i].X;
+                realWorld[3 * i + 1] = testResults[i].Y;
+                realWorld[3 * i + 2] = testResults[i].Z;
             }
 
-            realWorldXToZ /= testPoints.Length;
-            realWorldYToZ /= testPoints.Length;
+            IntPtr camera = ImageProcessorLib.cameraModelFit(width, height, projective, realWorld, SAMPLES);
+            if (camera == IntPtr.Zero)
+            {
+                throw new InvalidOperationException("Failed to fit the depth camera model");
+            }
+            return camera;
         }
 
-        public void Dispose()
+        public class ResultEventArgs : EventArgs
         {
-            unsafe
+            public long Sequence { get; private set; }
+            public long Timestamp { get; private set; }
+            public int[] FingersRaw { get; private set; }     //(x, y) pairs, FingerNum of them used
+            public int FingerNum { get; private set; }
+            public int[] HandHint { get; private set; }       //x, y, z, confidence
+            public ImageProcessorLib.FingerTrack[] Tracks { get; private set; }   //see MultiTouchTrackerOmni.Tracks, TrackNum used
+            public int TrackNum { get; private set; }
+
+            internal void Set(long sequence, long timestamp, int[] fingersRaw, int fingerNum, int[] handHint, ImageProcessorLib.FingerTrack[] tracks, int trackNum)
             {
-                ImageProcessorLib.derivativeFingerDetectorDispose();
+                this.Sequence = sequence;
+                this.Timestamp = timestamp;
+                this.FingersRaw = fingersRaw;
+                this.FingerNum = fingerNum;
+                this.HandHint = handHint;
+                this.Tracks = tracks;
+                this.TrackNum = trackNum;
             }
         }
+
+        public void Dispose()
+        {
+            ImageProcessorLib.detectorWorkerDestroy(worker);
+            worker = IntPtr.Zero;
+            ImageProcessorLib.debugCaptureDestroy(capture);     //after the worker, which may still take a snapshot
+            capture = IntPtr.Zero;
+            ImageProcessorLib.derivativeFingerDetectorDestroy(detector);
+            detector = IntPtr.Zero;
+        }
     }
 }
 
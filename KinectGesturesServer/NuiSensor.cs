@@ -65,6 +65,12 @@ namespace KinectGesturesServer
         /// </summary>
         private DepthMetaData depthMD = new DepthMetaData();
 
+        /// <summary>
+        /// Native depth sequence being recorded, IntPtr.Zero when not recording.
+        /// </summary>
+        private IntPtr recording = IntPtr.Zero;
+        private object recordingLock = new object();
+
         #endregion
 
         #region Properties
@@ -103,18 +109,8 @@ namespace KinectGesturesServer
 
                     unsafe
                     {
-                        ushort* pDepth = (ushort*)DepthGenerator.DepthMapPtr.ToPointer();
-
-                        for (int y = 0; y < depthMD.YRes; ++y)
-                        {
-                            byte* pDest = (byte*)depthBitmap.BackBuffer.ToPointer() + y * depthBitmap.BackBufferStride;
-                            for (int x = 0; x < depthMD.XRes; ++x, ++pDepth, pDest += 3)
-                            {
-                                byte pixel;
-                                pixel = (byte)Histogram[*pDepth];
-                                pDest[0] = pDest[1] = pDest[2] = pixel;
-                            }
-                        }
+                        ImageProcessorLib.depthHistogramColorize(DepthHistogram, (ushort*)DepthGenerator.DepthMapPtr.ToPointer(),
+                            (byte*)depthBitmap.BackBuffer.ToPointer(), depthBitmap.BackBufferStride);
                     }
 
                     depthBitmap.AddDirtyRect(new Int32Rect(0, 0, depthMD.XRes, depthMD.YRes));
@@ -148,9 +144,9 @@ namespace KinectGesturesServer
         public ImageMetaData ImageMetaData { get {return imgMD;}}
 
         /// <summary>
-        /// OpenNI histogram.
+        /// Native depth histogram with its lookup table (histogram.h), shared by the depth views.
         /// </summary>
-        public int[] Histogram { get; private set; }
+        public IntPtr DepthHistogram { get; private set; }
         #endregion
 
         public HandTracker HandTracker { get; private set; }
@@ -205,8 +201,12 @@ namespace KinectGesturesServer
 
             ImageGenerator = Context.FindExistingNode(NodeType.Image) as ImageGenerator;
             DepthGenerator = Context.FindExistingNode(NodeType.Depth) as DepthGenerator;
-            //Histogram = new int[DepthGenerator.GetDeviceMaxDepth()];
-            Histogram = new int[DepthGenerator.DeviceMaxDepth];
+            MapOutputMode mapMode = DepthGenerator.MapOutputMode;
+            DepthHistogram = ImageProcessorLib.depthHistogramCreate(mapMode.XRes, mapMode.YRes, mapMode.XRes, DepthGenerator.DeviceMaxDepth, 0);
+            if (DepthHistogram == IntPtr.Zero)
+            {
+                throw new OutOfMemoryException("Failed to create the native depth histogram");
+            }
         }
 
         /// <summary>
@@ -247,6 +247,16 @@ namespace KinectGesturesServer
                 ImageGenerator.GetMetaData(imgMD);
                 DepthGenerator.GetMetaData(depthMD);
 
+                lock (recordingLock)
+                {
+                    if (recording != IntPtr.Zero && ImageProcessorLib.depthSequenceWrite(recording, (ushort*)depthMD.DepthMapPtr.ToPointer(), depthMD.XRes, (long)depthMD.Timestamp) < 0)
+                    {
+                        Trace.WriteLine("Depth recording stopped: file full or write error");
+                        ImageProcessorLib.depthSequenceClose(recording);
+                        recording = IntPtr.Zero;
+                    }
+                }
+
                 if (FrameUpdate != null)
                 {
                     FrameUpdate(this, new FrameUpdateEventArgs(imgMD, depthMD));
@@ -282,38 +292,7 @@ namespace KinectGesturesServer
         /// <param name="depthMD"></param>
         public unsafe void UpdateHistogram(DepthMetaData depthMD)
         {
-            // Reset.
-            for (int i = 0; i < Histogram.Length; ++i)
-                Histogram[i] = 0;
-
-            ushort* pDepth = (ushort*)depthMD.DepthMapPtr.ToPointer();
-
-            int points = 0;
-            for (int y = 0; y < depthMD.YRes; ++y)
-            {
-                for (int x = 0; x < depthMD.XRes; ++x, ++pDepth)
-                {
-                    ushort depthVal = *pDepth;
-                    if (depthVal != 0)
-                    {
-                        Histogram[depthVal]++;
-                        points++;
-                    }
-                }
-            }
-
-            for (int i = 1; i < Histogram.Length; i++)
-            {
-                Histogram[i] += Histogram[i - 1];
-            }
-
-            if (points > 0)
-            {
-                for (int i = 1; i < Histogram.Length; i++)
-                {
-                    Histogram[i] = (int)(256 * (1.0f - (Histogram[i] / (float)points)));
-                }
-            }
+            ImageProcessorLib.depthHistogramUpdate(DepthHistogram, (ushort*)depthMD.DepthMapPtr.ToPointer());
         }
 
         /// <summary>
@@ -321,12 +300,16 @@ namespace KinectGesturesServer
         /// </summary>
         public void Dispose()
         {
-            MultiTouchTrackerOmni.Dispose();
+            StopRecording();
 
             imageBitmap = null;
             depthBitmap = null;
             isRunning = false;
             cameraThread.Join();
+            //after the join, a frame in progress still submits to the tracker's native worker
+            MultiTouchTrackerOmni.Dispose();
+            ImageProcessorLib.depthHistogramDestroy(DepthHistogram);
+            DepthHistogram = IntPtr.Zero;
             Context.Dispose();
             cameraThread = null;
             Context = null;
@@ -341,6 +324,46 @@ namespace KinectGesturesServer
             }
         }
 
+        /// <summary>
+        /// Records the raw depth frames into a depth sequence file for replaying without the sensor.
+        /// </summary>
+        /// <param name="path">File to create, replaces an existing one.</param>
+        /// <param name="maxFrames">Most frames to record, the recording stops by itself after them.</param>
+        public void StartRecording(string path, int maxFrames)
+        {
+            StopRecording();
+
+            MapOutputMode mapMode = DepthGenerator.MapOutputMode;
+            IntPtr sequence = ImageProcessorLib.depthSequenceCreate(path, mapMode.XRes, mapMode.YRes, DepthGenerator.DeviceMaxDepth,
+                MultiTouchTrackerOmni.RealWorldXToZ, MultiTouchTrackerOmni.RealWorldYToZ, maxFrames);
+            if (sequence == IntPtr.Zero)
+            {
+                throw new System.IO.IOException("Failed to create the depth sequence " + path);
+            }
+
+            lock (recordingLock)
+            {
+                recording = sequence;
+            }
+        }
+
+        public void StopRecording()
+        {
+            lock (recordingLock)
+            {
+                if (recording != IntPtr.Zero)
+                {
+                    ImageProcessorLib.depthSequenceClose(recording);
+                    recording = IntPtr.Zero;
+                }
+            }
+        }
+
+        public bool IsRecording
+        {
+            get { lock (recordingLock) { return recording != IntPtr.Zero; } }
+        }
+
         #endregion
 
         public class FrameUpdateEventArgs : EventArgs
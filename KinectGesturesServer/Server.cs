@@ -12,7 +12,16 @@ namespace KinectGesturesServer
 {
     public class Server
     {
+        private static readonly byte[] ADDRESS = { 192, 168, 53, 130 };
+        private const int PORT = 2011;
+        private const int BINARY_PORT = 2012;               //fingers, hand hint and hand events per frame, see resultPublisher.h
+        private const int BINARY_MAX_CLIENTS = 16;
+        private const int BINARY_QUEUE_BYTES = 64 * 1024;
+        private const int BINARY_DROP_AFTER = 90;           //frames a client may fall behind in a row, 3 s at 30 fps
+
         private TcpListener tcpServer;
+        private IntPtr publisher;                           //native, sends from its own thread
+        private readonly object publisherLock = new object();   //Stop destroys it while the camera thread may publish
         private Thread tcpServerThread;
         private NuiSensor sensor;
 
@@ -32,7 +41,7 @@ namespace KinectGesturesServer
 
         public Server(NuiSensor sensor)
         {
-            tcpServer = new TcpListener(new IPAddress(new byte[] { 192, 168, 53, 130 }), 2011);
+            tcpServer = new TcpListener(new IPAddress(ADDRESS), PORT);
             tcpServerThread = new Thread(tcpServerThreadWorker);
             clients = new List<TcpClient>();
             clientStreamWriters = new List<StreamWriter>();
@@ -42,6 +51,35 @@ namespace KinectGesturesServer
             sensor.HandTracker.HandCreate += new EventHandler<OpenNI.HandCreateEventArgs>(HandTracker_HandCreate);
             sensor.HandTracker.HandUpdate += new EventHandler<OpenNI.HandUpdateEventArgs>(HandTracker_HandUpdate);
             sensor.HandTracker.HandDestroy += new EventHandler<OpenNI.HandDestroyEventArgs>(HandTracker_HandDestroy);
+
+            publisher = ImageProcessorLib.resultPublisherCreate(new IPAddress(ADDRESS).ToString(), BINARY_PORT, BINARY_MAX_CLIENTS, BINARY_QUEUE_BYTES, BINARY_DROP_AFTER);
+            if (publisher == IntPtr.Zero)
+            {
+                Trace.WriteLine("Binary publisher could not listen on port " + BINARY_PORT.ToString());
+            }
+            else
+            {
+                sensor.MultiTouchTrackerOmni.ResultUpdated += new EventHandler<MultiTouchTrackerOmni.ResultEventArgs>(MultiTouchTrackerOmni_ResultUpdated);
+            }
+        }
+
+        public ImageProcessorLib.PublisherStats PublisherStats
+        {
+            get
+            {
+                ImageProcessorLib.PublisherStats stats = new ImageProcessorLib.PublisherStats();
+                lock (publisherLock)
+                {
+                    if (publisher != IntPtr.Zero)
+                    {
+                        unsafe
+                        {
+                            ImageProcessorLib.resultPublisherGetStats(publisher, &stats);
+                        }
+                    }
+                }
+                return stats;
+            }
         }
 
         public void Start()
@@ -57,6 +95,17 @@ namespace KinectGesturesServer
             }
 
             stopRequested = true;
+
+            //the camera thread keeps running until the sensor is disposed, its handlers see either the publisher or zero
+            sensor.MultiTouchTrackerOmni.ResultUpdated -= MultiTouchTrackerOmni_ResultUpdated;
+            lock (publisherLock)
+            {
+                if (publisher != IntPtr.Zero)
+                {
+                    ImageProcessorLib.resultPublisherDestroy(publisher);
+                    publisher = IntPtr.Zero;
+                }
+            }
         }
 
         private void tcpServerThreadWorker()
@@ -127,19 +176,59 @@ namespace KinectGesturesServer
 
         #region event handler
 
+        //the hand events come on the camera thread, like the results, so they are queued into the next frame's packet
         void HandTracker_HandCreate(object sender, OpenNI.HandCreateEventArgs e)
         {
             broadcast("HC " + e.UserID.ToString());
+            lock (publisherLock)
+            {
+                if (publisher != IntPtr.Zero)
+                {
+                    ImageProcessorLib.resultPublisherAddHandEvent(publisher, ImageProcessorLib.HAND_CREATE, e.UserID, 0, 0, 0);
+                }
+            }
         }
 
         void HandTracker_HandUpdate(object sender, OpenNI.HandUpdateEventArgs e)
         {
             broadcast(string.Format("HU {0},{1},{2},{3}", e.UserID, e.Position.X, e.Position.Y, e.Position.Z));
+            lock (publisherLock)
+            {
+                if (publisher != IntPtr.Zero)
+                {
+                    ImageProcessorLib.resultPublisherAddHandEvent(publisher, ImageProcessorLib.HAND_UPDATE, e.UserID, (int)e.Position.X, (int)e.Position.Y, (int)e.Position.Z);
+                }
+            }
         }
 
         void HandTracker_HandDestroy(object sender, OpenNI.HandDestroyEventArgs e)
         {
             broadcast("HD " + e.UserID.ToString());
+            lock (publisherLock)
+            {
+                if (publisher != IntPtr.Zero)
+                {
+                    ImageProcessorLib.resultPublisherAddHandEvent(publisher, ImageProcessorLib.HAND_DESTROY, e.UserID, 0, 0, 0);
+                }
+            }
+        }
+
+        void MultiTouchTrackerOmni_ResultUpdated(object sender, MultiTouchTrackerOmni.ResultEventArgs e)
+        {
+            lock (publisherLock)
+            {
+                if (publisher == IntPtr.Zero)
+                {
+                    return;
+                }
+                unsafe
+                {
+                    fixed (int* fingersPtr = e.FingersRaw, handHintPtr = e.HandHint)
+                    {
+                        ImageProcessorLib.resultPublisherPublishFrame(publisher, e.Sequence, e.Timestamp, fingersPtr, e.FingerNum, handHintPtr);
+                    }
+                }
+            }
         }
 
         #endregion
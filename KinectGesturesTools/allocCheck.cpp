@@ -0,0 +1,276 @@
+//Checks that the per frame paths of the native library don't touch the heap once they are warmed up: counts every
+//operator new of the process while synthetic frames go through them and fails when a frame after the warm-up allocated.
+//
+//	allocCheck [--threads n] [--warmup n] [--frames n]
+//		--threads		threads of the derivative detector, 4 by default
+//		--warmup		frames before counting, 10 by default
+//		--frames		frames counted per configuration, 200 by default
+//
+//Exits with 1 when any configuration allocated after the warm-up.
+//
+//Build on Linux from this directory:
+//	g++ -std=c++11 -O2 -pthread -I../KinectGesturesImageProcessorLib allocCheck.cpp ../KinectGesturesImageProcessorLib/*.cpp -o allocCheck
+
+#include "derivativeFingerDetector.h"
+#include "detectorContext.h"
+#include "detectorWorker.h"
+#include "touchPipeline.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <new>
+#include <vector>
+
+#define WIDTH 640
+#define HEIGHT 480
+#define MAX_FINGERS 10
+#define TABLE_DEPTH 800
+
+//---------------------------------------------------------------------------------------------------------------------
+//the hook: every allocation of the process goes through here, whatever thread makes it
+
+static volatile long allocations = 0;
+
+void* operator new(size_t size)
+{
+	__sync_fetch_and_add(&allocations, 1);
+	void* ptr = malloc(size > 0 ? size : 1);
+	if (ptr == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+static long allocationCount()
+{
+	return __sync_fetch_and_add(&allocations, 0);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+
+//a flat table with 1 to 5 fingers lying on it and some holes, different for every seed
+static void syntheticFrame(ushort* depth, int seed)
+{
+	srand(seed);
+	for (int p = 0; p < WIDTH * HEIGHT; p++)
+	{
+		depth[p] = (ushort)(TABLE_DEPTH + rand() % 3);
+	}
+	int fingerNum = 1 + rand() % 5;
+	for (int f = 0; f < fingerNum; f++)
+	{
+		int cx = 80 + rand() % 480, top = 60 + rand() % 200, length = 60 + rand() % 80;
+		double radius = 6 + rand() % 3;
+		for (int y = top; y < top + length && y < HEIGHT; y++)
+		{
+			for (int x = (int)(cx - radius); x <= cx + radius; x++)
+			{
+				double dx = (x - cx) / radius;
+				if (fabs(dx) <= 1)
+				{
+					depth[y * WIDTH + x] = (ushort)(TABLE_DEPTH - 18 * sqrt(1 - dx * dx));
+				}
+			}
+		}
+	}
+	for (int k = 0; k < 300; k++)
+	{
+		depth[rand() % (WIDTH * HEIGHT)] = 0;
+	}
+}
+
+typedef struct Check
+{
+	long allocations;			//after the warm-up
+	int framesAllocating;
+} Check;
+
+static bool report(const char* name, const Check& check, int frames)
+{
+	bool ok = check.allocations == 0;
+	printf("%-28s %d frames, %ld allocations in %d of them  %s\n", name, frames, check.allocations, check.framesAllocating, ok ? "ok" : "FAILED");
+	return ok;
+}
+
+static void countFrame(Check& check, long before)
+{
+	long n = allocationCount() - before;
+	check.allocations += n;
+	check.framesAllocating += n > 0;
+}
+
+typedef struct DetectorConfig
+{
+	const char* name;
+	int outputFlags;
+	int tracking, pyramidLevel, linking, streaming;
+	int maxQuality;				//QualityFull: no deadline, else a deadline no frame makes, so the warm-up drops to it
+} DetectorConfig;
+
+static bool checkDetector(const DetectorConfig& config, std::vector<std::vector<ushort> >& frames, int threadNum, int warmup, int frameNum)
+{
+	void* detector = derivativeFingerDetectorCreate(WIDTH, HEIGHT, WIDTH, WIDTH * 3, 10000, 1.12, 0.84, threadNum);
+	derivativeFingerDetectorSetTracking(detector, config.tracking, 30, 32);
+	derivativeFingerDetectorSetPyramid(detector, config.pyramidLevel, 16);
+	derivativeFingerDetectorSetLinking(detector, config.linking);
+	derivativeFingerDetectorSetStreaming(detector, config.streaming);
+	if (config.maxQuality != QualityFull)
+	{
+		derivativeFingerDetectorSetDeadline(detector, 1e-6, config.maxQuality);
+	}
+
+	std::vector<byte> image(WIDTH * HEIGHT * 3);
+	int result[2 * MAX_FINGERS], handHint[4];
+	Check check = { 0, 0 };
+	for (int k = 0; k < warmup + frameNum; k++)
+	{
+		//tracking needs a few frames of the same scene to stay on the region
+		ushort* depth = &frames[(k / 5) % frames.size()][0];
+		long before = allocationCount();
+		derivativeFingerDetectorContextWorkEx(detector, depth, &image[0], 5, 30, 20, 150, MAX_FINGERS, result, handHint, config.outputFlags);
+		if (k >= warmup)
+		{
+			countFrame(check, before);
+		}
+	}
+
+	derivativeFingerDetectorDestroy(detector);
+	return report(config.name, check, frameNum);
+}
+
+static void sleepMillis(int millis)
+{
+	timespec ts = { millis / 1000, (millis % 1000) * 1000000L };
+	nanosleep(&ts, NULL);
+}
+
+//submit, wait for the result, acquire and release: counts the worker thread as well
+static bool checkWorker(std::vector<std::vector<ushort> >& frames, int threadNum, int warmup, int frameNum)
+{
+	void* detector = derivativeFingerDetectorCreate(WIDTH, HEIGHT, WIDTH, WIDTH * 3, 10000, 1.12, 0.84, threadNum);
+	derivativeFingerDetectorSetTracking(detector, 1, 30, 32);
+	void* worker = detectorWorkerCreate(detector, MAX_FINGERS);
+
+	Check check = { 0, 0 };
+	for (int k = 0; k < warmup + frameNum; k++)
+	{
+		long before = allocationCount();
+		long long sequence = detectorWorkerSubmit(worker, &frames[(k / 5) % frames.size()][0], k, 5, 30, 20, 150, OutputImage);
+		for (bool done = false; !done; )
+		{
+			DetectorResult* result = detectorWorkerAcquire(worker);
+			done = result != NULL && result->sequence >= sequence;
+			if (result != NULL)
+			{
+				detectorWorkerRelease(worker, result);
+			}
+			if (!done)
+			{
+				sleepMillis(1);
+			}
+		}
+		if (k >= warmup)
+		{
+			countFrame(check, before);
+		}
+	}
+
+	detectorWorkerDestroy(worker);
+	derivativeFingerDetectorDestroy(detector);
+	return report("detector worker", check, frameNum);
+}
+
+static bool checkTouch(std::vector<std::vector<ushort> >& frames, int warmup, int frameNum)
+{
+	void* pipeline = touchPipelineCreate(WIDTH, HEIGHT);
+	std::vector<ushort> calibration(WIDTH * HEIGHT, (ushort)((TABLE_DEPTH + 1) << TOUCH_CALIBRATION_SHIFT));
+	int result[2 * MAX_FINGERS];
+
+	Check check = { 0, 0 };
+	for (int k = 0; k < warmup + frameNum; k++)
+	{
+		long before = allocationCount();
+		touchPipelineWork(pipeline, &frames[k % frames.size()][0], &calibration[0], NULL, WIDTH, 3, 20, 1, MAX_FINGERS, 20, result, NULL, 0);
+		if (k >= warmup)
+		{
+			countFrame(check, before);
+		}
+	}
+
+	touchPipelineDestroy(pipeline);
+	return report("touch pipeline", check, frameNum);
+}
+
+int main(int argc, char** argv)
+{
+	int threadNum = 4, warmup = 10, frameNum = 200;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "--threads") == 0) threadNum = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--warmup") == 0) warmup = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--frames") == 0) frameNum = atoi(argv[i + 1]);
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	std::vector<std::vector<ushort> > frames(50, std::vector<ushort>(WIDTH * HEIGHT));
+	for (size_t k = 0; k < frames.size(); k++)
+	{
+		syntheticFrame(&frames[k][0], (int)k);
+	}
+
+	static const DetectorConfig configs[] =
+	{
+		{ "detector", OutputNone, 0, 0, StripLinkFirst, 1, QualityFull },
+		{ "detector image", OutputImage, 0, 0, StripLinkFirst, 1, QualityFull },
+		{ "detector overlay", OutputOverlay, 0, 0, StripLinkFirst, 1, QualityFull },
+		{ "detector tracking", OutputNone, 1, 0, StripLinkFirst, 1, QualityFull },
+		{ "detector pyramid", OutputNone, 0, 1, StripLinkFirst, 1, QualityFull },
+		{ "detector best overlap", OutputOverlay, 0, 0, StripLinkBestOverlap, 1, QualityFull },
+		{ "detector no streaming", OutputNone, 0, 0, StripLinkFirst, 0, QualityFull },
+		{ "detector half rows", OutputImage, 1, 0, StripLinkFirst, 1, QualityHalfRows },
+		{ "detector coarse", OutputImage, 1, 0, StripLinkFirst, 1, QualityCoarse },
+	};
+
+	bool ok = true;
+	for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++)
+	{
+		ok = checkDetector(configs[c], frames, threadNum, warmup, frameNum) && ok;
+	}
+	ok = checkWorker(frames, threadNum, warmup, frameNum) && ok;
+	ok = checkTouch(frames, warmup, frameNum) && ok;
+
+	printf(ok ? "ok\n" : "FAILED\n");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,224 @@
+//Times the kernels that have resolution specialized instantiations (fixedSize.h) against their runtime sized ones,
+//at every specialized resolution, and checks that both give the same output.
+//
+//	kernelBench [--iterations n] [--threads n]
+//		--iterations	runs of every kernel per measurement, 200 by default
+//		--threads		threads of the derivative detector, 1 by default
+//
+//Kernels:
+//	dilate, erose	3x3 on a thresholded synthetic frame, also checked against a direct 3x3 loop
+//	output image	derivativeFingerDetectorContextWorkEx with OutputImage and the histogram rebuilt every frame
+//
+//Exits with 1 when an output differs.
+//
+//Build on Linux from this directory, -O3 because gcc's -O2 doesn't vectorize loops that need a remainder:
+//	g++ -std=c++11 -O3 -pthread -I../KinectGesturesImageProcessorLib kernelBench.cpp ../KinectGesturesImageProcessorLib/*.cpp -o kernelBench
+
+#include "derivativeFingerDetector.h"
+#include "detectorContext.h"
+#include "fixedSize.h"
+#include "dip.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <vector>
+
+#define MAX_FINGERS 10
+#define TABLE_DEPTH 800
+
+static double now()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//a flat table with fingers of a size that scales with the frame, and some holes
+static void syntheticFrame(ushort* depth, int width, int height, int seed)
+{
+	srand(seed);
+	double scale = width / 640.0;
+	for (int p = 0; p < width * height; p++)
+	{
+		depth[p] = (ushort)(TABLE_DEPTH + rand() % 3);
+	}
+	for (int f = 0; f < 5; f++)
+	{
+		int cx = (int)((80 + rand() % 480) * scale), top = (int)((60 + rand() % 200) * scale), length = (int)((60 + rand() % 80) * scale);
+		double radius = (6 + rand() % 3) * scale + 0.5;
+		for (int y = top; y < top + length && y < height; y++)
+		{
+			for (int x = (int)(cx - radius); x <= cx + radius; x++)
+			{
+				double dx = (x - cx) / radius;
+				if (x >= 0 && x < width && fabs(dx) <= 1)
+				{
+					depth[y * width + x] = (ushort)(TABLE_DEPTH - 18 * sqrt(1 - dx * dx));
+				}
+			}
+		}
+	}
+	for (int k = 0; k < width * height / 1000; k++)
+	{
+		depth[rand() % (width * height)] = 0;
+	}
+}
+
+//what dilate and erose did before they were specialized: neighbours outside the frame are skipped
+static void reference3x3(const byte* src, byte* dst, int width, int height, bool dilation)
+{
+	for (int i = 0; i < height; i++)
+	{
+		for (int j = 0; j < width; j++)
+		{
+			bool result = !dilation;
+			for (int mi = i - 1; mi <= i + 1; mi++)
+			{
+				for (int mj = j - 1; mj <= j + 1; mj++)
+				{
+					if (mi >= 0 && mi < height && mj >= 0 && mj < width && (src[mi * width + mj] != 0) == dilation)
+					{
+						result = dilation;
+					}
+				}
+			}
+			dst[i * width + j] = bwBit(result);
+		}
+	}
+}
+
+typedef struct Timing
+{
+	double fixedMs, runtimeMs;		//per run
+	bool same;
+} Timing;
+
+static void report(const char* kernel, int width, int height, const Timing& t)
+{
+	printf("%4dx%-4d %-14s fixed %8.4f ms  runtime %8.4f ms  speedup %5.2fx  %s\n", width, height, kernel,
+		   t.fixedMs, t.runtimeMs, t.runtimeMs / t.fixedMs, t.same ? "ok" : "DIFFERENT");
+}
+
+static Timing timeMorphology(bool dilation, const std::vector<byte>& bw, int width, int height, int iterations)
+{
+	std::vector<byte> out[2], reference(width * height);
+	double ms[2];
+	for (int mode = 0; mode < 2; mode++)
+	{
+		setFixedSizeKernels(mode == 0);
+		out[mode].assign(width * height, 0x55);
+		byte* src = (byte*)&bw[0];
+		double start = 0;
+		for (int k = -1; k < iterations; k++)		//k -1 warms up
+		{
+			if (k == 0)
+			{
+				start = now();
+			}
+			if (dilation)
+			{
+				dilate(src, &out[mode][0], width, height, width);
+			}
+			else
+			{
+				erose(src, &out[mode][0], width, height, width);
+			}
+		}
+		ms[mode] = (now() - start) * 1000 / iterations;
+	}
+	setFixedSizeKernels(1);
+
+	reference3x3(&bw[0], &reference[0], width, height, dilation);
+	Timing t = { ms[0], ms[1], out[0] == out[1] && out[0] == reference };
+	return t;
+}
+
+static Timing timeOutputImage(const std::vector<ushort>& depth, int width, int height, int threadNum, int iterations)
+{
+	std::vector<byte> image[2];
+	std::vector<int> fingers[2];
+	double ms[2];
+	for (int mode = 0; mode < 2; mode++)
+	{
+		setFixedSizeKernels(mode == 0);
+		void* detector = derivativeFingerDetectorCreate(width, height, width, width * 3, 10000, 1.12, 0.84, threadNum);
+		derivativeFingerDetectorSetVisualization(detector, 1);
+		image[mode].assign(width * height * 3, 0);
+		fingers[mode].assign(2 * MAX_FINGERS, 0);
+		int handHint[4];
+		double start = 0;
+		for (int k = -1; k < iterations; k++)
+		{
+			if (k == 0)
+			{
+				start = now();
+			}
+			derivativeFingerDetectorContextWorkEx(detector, (ushort*)&depth[0], &image[mode][0], 5, 30, 20, 150, MAX_FINGERS,
+												  &fingers[mode][0], handHint, OutputImage);
+		}
+		ms[mode] = (now() - start) * 1000 / iterations;
+		derivativeFingerDetectorDestroy(detector);
+	}
+	setFixedSizeKernels(1);
+
+	Timing t = { ms[0], ms[1], image[0] == image[1] && fingers[0] == fingers[1] };
+	return t;
+}
+
+int main(int argc, char** argv)
+{
+	int iterations = 200, threadNum = 1;
+	for (int a = 1; a < argc; a++)
+	{
+		if (strcmp(argv[a], "--iterations") == 0 && a + 1 < argc)
+		{
+			iterations = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "--threads") == 0 && a + 1 < argc)
+		{
+			threadNum = atoi(argv[++a]);
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--iterations n] [--threads n]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (iterations < 1 || threadNum < 1)
+	{
+		fprintf(stderr, "iterations and threads must be positive\n");
+		return 1;
+	}
+
+	static const int sizes[3][2] = { { 640, 480 }, { 320, 240 }, { 80, 60 } };
+	bool ok = true;
+	for (int s = 0; s < 3; s++)
+	{
+		int width = sizes[s][0], height = sizes[s][1];
+		std::vector<ushort> depth(width * height);
+		syntheticFrame(&depth[0], width, height, 1 + s);
+
+		//foreground: anything raised above the table, the way the touch path thresholds
+		std::vector<byte> bw(width * height);
+		for (int p = 0; p < width * height; p++)
+		{
+			bw[p] = bwBit(depth[p] != 0 && depth[p] < TABLE_DEPTH - 3);
+		}
+
+		Timing t = timeMorphology(true, bw, width, height, iterations);
+		report("dilate", width, height, t);
+		ok = ok && t.same;
+
+		t = timeMorphology(false, bw, width, height, iterations);
+		report("erose", width, height, t);
+		ok = ok && t.same;
+
+		t = timeOutputImage(depth, width, height, threadNum, iterations);
+		report("output image", width, height, t);
+		ok = ok && t.same;
+	}
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,250 @@
+//Times extractPointsEx, the run labeller, against the BFS extractPoints it replaced, kept here as the reference, and
+//checks that both find the same centroids.
+//
+//	labelBench [--frames n] [--width n] [--height n]
+//		--frames	frames per scene, 60 by default
+//		--width, --height	640x480 by default
+//
+//Scenes:
+//	disks		3..10 disks of 8..40 px radius plus 0, 2 or 4% salt noise, maxNum 10, minArea 20
+//	dense		50% salt noise, every blob of any size, the most blobs and unions a frame can have
+//
+//Centroids are compared as sets: the BFS sorted the blobs with an unstable sort, so blobs of the same size come out
+//in any order. Exits with 1 when they differ or the labeller fails.
+//
+//Build on Linux from this directory:
+//	g++ -std=c++11 -O2 -pthread -I../KinectGesturesImageProcessorLib labelBench.cpp ../KinectGesturesImageProcessorLib/*.cpp -o labelBench
+
+#include "dip.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <deque>
+#include <vector>
+#include <algorithm>
+
+typedef std::pair<int, int> pos;
+
+static double now()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool sortComparator(const std::vector<pos>& a, const std::vector<pos>& b)
+{
+	return a.size() > b.size();
+}
+
+//extractPoints before the labeller: a BFS from every unvisited foreground pixel, switchPtr as the visit flag, every
+//blob kept as a list of its pixels and all of them sorted
+static int extractPointsBfs(proc_para, byte* switchPtr, int maxNum, int minArea, int* resultPtr)
+{
+	std::vector<std::vector<pos> > blocks;
+	std::deque<pos> searchingQueue;
+
+	memset(switchPtr, 0, height * stride * sizeof(byte));
+
+	for (int i = 0; i < height; i++)
+		for (int j = 0; j < width; j++)
+		{
+			if (*bufferPixelBit(switchPtr, i, j))
+			{
+				continue;
+			}
+
+			*bufferPixelBit(switchPtr, i, j) = 0xFF;
+
+			if (!*srcPixelBit(i, j))
+			{
+				continue;
+			}
+
+			blocks.push_back(std::vector<pos>());
+			blocks[blocks.size() - 1].push_back(pos(i, j));
+			searchingQueue.push_back(pos(i, j));
+
+			while (!searchingQueue.empty())
+			{
+				pos curr = searchingQueue.front();
+				searchingQueue.pop_front();
+				for (int ni = curr.first - 1; ni <= curr.first + 1; ni++)
+				{
+					if (ni < 0 || ni >= height)
+					{
+						continue;
+					}
+					for (int nj = curr.second - 1; nj <= curr.second + 1; nj++)
+					{
+						if (nj < 0 || nj >= width || *bufferPixelBit(switchPtr, ni, nj))
+						{
+							continue;
+						}
+						*bufferPixelBit(switchPtr, ni, nj) = 0xFF;
+
+						if (*srcPixelBit(ni, nj))
+						{
+							blocks[blocks.size() - 1].push_back(pos(ni, nj));
+							searchingQueue.push_back(pos(ni, nj));
+						}
+					}
+				}
+			}
+		}
+
+	std::sort(blocks.begin(), blocks.end(), sortComparator);
+	int pi;
+	for (pi = 0; pi < (int)blocks.size() && pi < maxNum; pi++)
+	{
+		if ((int)blocks[pi].size() < minArea)
+		{
+			break;
+		}
+		int xSum = 0, ySum = 0;
+		for (int j = 0; j < (int)blocks[pi].size(); j++)
+		{
+			xSum += blocks[pi][j].second;
+			ySum += blocks[pi][j].first;
+		}
+		resultPtr[2 * pi] = xSum / (int)blocks[pi].size();
+		resultPtr[2 * pi + 1] = ySum / (int)blocks[pi].size();
+	}
+	return pi;
+}
+
+static void disksFrame(byte* bw, int width, int height, int frame)
+{
+	srand(frame + 1);
+	memset(bw, 0, width * height);
+	int diskNum = 3 + rand() % 8;
+	for (int d = 0; d < diskNum; d++)
+	{
+		int radius = 8 + rand() % 33, cx = rand() % width, cy = rand() % height;
+		for (int y = std::max(cy - radius, 0); y <= std::min(cy + radius, height - 1); y++)
+		{
+			for (int x = std::max(cx - radius, 0); x <= std::min(cx + radius, width - 1); x++)
+			{
+				if ((x - cx) * (x - cx) + (y - cy) * (y - cy) <= radius * radius)
+				{
+					bw[y * width + x] = bwBit(1);
+				}
+			}
+		}
+	}
+
+	int salt = (frame % 3) * 2;		//percent
+	for (int p = 0; p < width * height; p++)
+	{
+		if (rand() % 100 < salt)
+		{
+			bw[p] = bwBit(1);
+		}
+	}
+}
+
+static void denseFrame(byte* bw, int width, int height, int frame)
+{
+	srand(frame + 1000);
+	for (int p = 0; p < width * height; p++)
+	{
+		bw[p] = bwBit(rand() % 2);
+	}
+}
+
+//the centroids of both as sorted sets
+static bool sameCentroids(const int* a, int aNum, const int* b, int bNum)
+{
+	if (aNum != bNum)
+	{
+		return false;
+	}
+	std::vector<pos> sa, sb;
+	for (int k = 0; k < aNum; k++)
+	{
+		sa.push_back(pos(a[2 * k], a[2 * k + 1]));
+		sb.push_back(pos(b[2 * k], b[2 * k + 1]));
+	}
+	std::sort(sa.begin(), sa.end());
+	std::sort(sb.begin(), sb.end());
+	return sa == sb;
+}
+
+static bool runScene(const char* name, bool dense, int width, int height, int frames)
+{
+	int maxNum = dense ? width * height : 10, minArea = dense ? 1 : 20;
+	std::vector<byte> bw(width * height), visit(width * height);
+	std::vector<int> bfsPoints(2 * maxNum), labellerPoints(2 * maxNum);
+	void* labeller = extractPointsCreate(width, height);
+
+	double bfsSeconds = 0, labellerSeconds = 0;
+	long long blobs = 0;
+	int different = 0;
+	for (int f = 0; f < frames; f++)
+	{
+		if (dense)
+		{
+			denseFrame(&bw[0], width, height, f);
+		}
+		else
+		{
+			disksFrame(&bw[0], width, height, f);
+		}
+
+		double start = now();
+		int bfsNum = extractPointsBfs(&bw[0], NULL, width, height, width, &visit[0], maxNum, minArea, &bfsPoints[0]);
+		double middle = now();
+		int labellerNum = extractPointsEx(labeller, &bw[0], NULL, width, height, width, maxNum, minArea, &labellerPoints[0], NULL);
+		double end = now();
+		bfsSeconds += middle - start;
+		labellerSeconds += end - middle;
+		blobs += bfsNum;
+
+		if (labellerNum < 0 || !sameCentroids(&bfsPoints[0], bfsNum, &labellerPoints[0], labellerNum))
+		{
+			fprintf(stderr, "%s frame %d: BFS %d points, labeller %d\n", name, f, bfsNum, labellerNum);
+			different++;
+		}
+	}
+	extractPointsDestroy(labeller);
+
+	printf("%4dx%-4d %-6s %6.1f blobs/frame  BFS %8.3f ms  labeller %8.3f ms  speedup %5.2fx  %s\n", width, height, name,
+		   (double)blobs / frames, bfsSeconds * 1000 / frames, labellerSeconds * 1000 / frames, bfsSeconds / labellerSeconds,
+		   different == 0 ? "same centroid sets" : "DIFFERENT");
+	return different == 0;
+}
+
+int main(int argc, char** argv)
+{
+	int frames = 60, width = 640, height = 480;
+	for (int a = 1; a < argc; a++)
+	{
+		if (strcmp(argv[a], "--frames") == 0 && a + 1 < argc)
+		{
+			frames = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "--width") == 0 && a + 1 < argc)
+		{
+			width = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "--height") == 0 && a + 1 < argc)
+		{
+			height = atoi(argv[++a]);
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--frames n] [--width n] [--height n]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (frames < 1 || width < 1 || height < 1)
+	{
+		fprintf(stderr, "frames, width and height must be positive\n");
+		return 1;
+	}
+
+	bool ok = runScene("disks", false, width, height, frames);
+	ok = runScene("dense", true, width, height, frames) && ok;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,427 @@
+//Times the kernels of the native library one at a time on synthetic tabletop scenes (syntheticScene.h), across
+//resolutions and finger counts, and checks every output against golden hashes, so an optimisation can't change what
+//the library detects without anybody noticing.
+//
+//	microBench [--iterations n] [--threads n] [--golden file] [--write-golden file]
+//		--iterations	runs of every kernel per scene, 100 by default
+//		--threads		threads of the derivative detector, 1 by default
+//		--golden		compares every output with the hashes of file, microBench.golden is the one of gcc on x86-64
+//		--write-golden	writes the hashes of this build to file
+//
+//Scenes: 640x480 and 320x240, a hand without fingers, a hand with 1 and with 5, two hands with 5 each.
+//Kernels:
+//	dilate, erose, open		3x3 on the foreground, 3 to 100 mm above the table like the touch path
+//	extractPoints			blobs of the opened foreground, with a labeller of its own
+//	sobel					both derivative frames
+//	findStrips				the whole frame, from the derivative of sobel
+//	findFingers				the chains of the strips of findStrips, which runs untimed before every run
+//	generateOutputImage		the histogram rebuilt every frame, the overlay of both stages under it
+//	frame					derivativeFingerDetectorContextWorkEx without an image, for the sum of the stages
+//The found line of a scene counts the true fingertips with a detected finger close by.
+//
+//Exits with 1 when an output differs from the golden file or is missing from it. The hashes depend on the scene
+//generator's floating point too, so a golden file is of one compiler and CPU; write one for another.
+//
+//Build on Linux from this directory:
+//	g++ -std=c++11 -O2 -pthread -I../KinectGesturesImageProcessorLib microBench.cpp ../KinectGesturesImageProcessorLib/*.cpp -o microBench
+
+#include "derivativeFingerDetector.h"
+#include "detectorContext.h"
+#include "syntheticScene.h"
+#include "dip.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#define MAX_FINGERS 10
+#define MAX_POINTS 20
+#define MIN_AREA 20
+#define FOREGROUND_MIN 3			//millimetres above the table
+#define FOREGROUND_MAX 100
+#define TIP_TOLERANCE 8				//pixels at 640x480
+
+static double now()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//FNV-1a, 64 bits
+static unsigned long long hashBytes(const void* data, size_t size, unsigned long long hash = 14695981039346656037ULL)
+{
+	const byte* p = (const byte*)data;
+	for (size_t k = 0; k < size; k++)
+	{
+		hash = (hash ^ p[k]) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+typedef struct Scene
+{
+	int width, height, fingerNum;
+	SceneParams params;
+	std::vector<ushort> depth;
+	std::vector<byte> foreground;	//bwBit per pixel
+} Scene;
+
+static void buildScene(Scene& scene, int width, int height, int fingerNum)
+{
+	scene.width = width;
+	scene.height = height;
+	scene.fingerNum = fingerNum;
+	sceneParamsInit(&scene.params, width, height);
+	if (fingerNum <= SCENE_MAX_FINGERS)
+	{
+		sceneAddHand(&scene.params, -60, -200, fingerNum);
+	}
+	else
+	{
+		sceneAddHand(&scene.params, -200, -200, SCENE_MAX_FINGERS);
+		int right = sceneAddHand(&scene.params, 150, -220, fingerNum - SCENE_MAX_FINGERS);
+		scene.params.hands[right].angle = 110;
+	}
+
+	scene.depth.assign(width * height, 0);
+	sceneRender(&scene.params, &scene.depth[0], width);
+	scene.foreground.assign(width * height, 0);
+	for (int p = 0; p < width * height; p++)
+	{
+		int above = scene.params.tableDepth - scene.depth[p];
+		scene.foreground[p] = bwBit(scene.depth[p] != 0 && above >= FOREGROUND_MIN && above < FOREGROUND_MAX);
+	}
+}
+
+typedef struct Timing
+{
+	double total, best;				//seconds
+	int runs;
+	double start;
+} Timing;
+
+static Timing timingInit()
+{
+	Timing t = { 0, 1e30, 0, 0 };
+	return t;
+}
+
+static void timingBegin(Timing& t)
+{
+	t.start = now();
+}
+
+//run -1 warms up and isn't counted
+static void timingEnd(Timing& t, int run)
+{
+	double seconds = now() - t.start;
+	if (run >= 0)
+	{
+		t.total += seconds;
+		t.best = seconds < t.best ? seconds : t.best;
+		t.runs++;
+	}
+}
+
+typedef struct Golden
+{
+	std::string key;				//kernel widthxheight fingers
+	unsigned long long hash;
+} Golden;
+
+static std::vector<Golden> measured, golden;
+static bool ok = true;
+
+static void report(const char* kernel, const Scene& scene, const Timing& t, unsigned long long hash)
+{
+	char key[128];
+	sprintf(key, "%s %dx%d %d", kernel, scene.width, scene.height, scene.fingerNum);
+	Golden entry = { key, hash };
+	measured.push_back(entry);
+
+	const char* check = "";
+	if (!golden.empty())
+	{
+		check = "MISSING";
+		for (size_t k = 0; k < golden.size(); k++)
+		{
+			if (golden[k].key == key)
+			{
+				check = golden[k].hash == hash ? "ok" : "DIFFERENT";
+			}
+		}
+		ok = ok && strcmp(check, "ok") == 0;
+	}
+	printf("%4dx%-4d %2d fingers %-20s mean %8.4f ms  best %8.4f ms  %016llx %s\n", scene.width, scene.height, scene.fingerNum, kernel,
+		   t.total * 1000 / t.runs, t.best * 1000, hash, check);
+}
+
+static void benchMorphology(const Scene& scene, int iterations)
+{
+	int width = scene.width, height = scene.height;
+	byte* src = (byte*)&scene.foreground[0];
+	std::vector<byte> out(width * height), opened(width * height), switchBuffer(width * height);
+
+	Timing t = timingInit();
+	for (int run = -1; run < iterations; run++)
+	{
+		timingBegin(t);
+		dilate(src, &out[0], width, height, width);
+		timingEnd(t, run);
+	}
+	report("dilate", scene, t, hashBytes(&out[0], out.size()));
+
+	t = timingInit();
+	for (int run = -1; run < iterations; run++)
+	{
+		timingBegin(t);
+		erose(src, &out[0], width, height, width);
+		timingEnd(t, run);
+	}
+	report("erose", scene, t, hashBytes(&out[0], out.size()));
+
+	t = timingInit();
+	for (int run = -1; run < iterations; run++)
+	{
+		timingBegin(t);
+		open(src, &opened[0], width, height, width, &switchBuffer[0]);
+		timingEnd(t, run);
+	}
+	report("open", scene, t, hashBytes(&opened[0], opened.size()));
+
+	void* labeller = extractPointsCreate(width, height);
+	int points[2 * MAX_POINTS], pointNum = 0;
+	t = timingInit();
+	for (int run = -1; run < iterations; run++)
+	{
+		timingBegin(t);
+		pointNum = extractPointsEx(labeller, &opened[0], NULL, width, height, width, MAX_POINTS, MIN_AREA, points, NULL);
+		timingEnd(t, run);
+	}
+	extractPointsDestroy(labeller);
+	report("extractPoints", scene, t, hashBytes(points, 2 * pointNum * sizeof(int), hashBytes(&pointNum, sizeof(int))));
+}
+
+static unsigned long long hashStrips(const DetectorContext* ctx)
+{
+	unsigned long long hash = hashBytes(NULL, 0);
+	for (int i = 0; i < ctx->height; i++)
+	{
+		const Strip* rowStrips = ctx->strips + i * ctx->stripCapacity;
+		for (int k = 0; k < ctx->stripNum[i]; k++)
+		{
+			int strip[3] = { rowStrips[k].row, rowStrips[k].leftCol, rowStrips[k].rightCol };
+			hash = hashBytes(strip, sizeof(strip), hash);
+		}
+	}
+	return hash;
+}
+
+static unsigned long long hashFingers(int fingerNum, const int* fingers, const int* handHint)
+{
+	unsigned long long hash = hashBytes(&fingerNum, sizeof(int));
+	hash = hashBytes(fingers, 2 * fingerNum * sizeof(int), hash);
+	return fingerNum > 0 ? hashBytes(handHint, 4 * sizeof(int), hash) : hash;
+}
+
+//true tips with a detected finger within TIP_TOLERANCE, scaled to the resolution
+static int foundTips(const Scene& scene, const int* fingers, int fingerNum)
+{
+	int tips[2 * SCENE_MAX_HANDS * SCENE_MAX_FINGERS];
+	int tipNum = sceneFingerTips(&scene.params, tips, SCENE_MAX_HANDS * SCENE_MAX_FINGERS);
+	int tolerance = TIP_TOLERANCE * scene.width / 640, found = 0;
+	for (int k = 0; k < tipNum; k++)
+	{
+		for (int f = 0; f < fingerNum; f++)
+		{
+			int dx = fingers[2 * f] - tips[2 * k], dy = fingers[2 * f + 1] - tips[2 * k + 1];
+			if (dx * dx + dy * dy <= tolerance * tolerance)
+			{
+				found++;
+				break;
+			}
+		}
+	}
+	return found;
+}
+
+static void benchDetector(const Scene& scene, int threadNum, int iterations)
+{
+	int width = scene.width, height = scene.height, depthStride = width, pixelStride = width * 3;
+	ushort* srcDepthPtr = (ushort*)&scene.depth[0];
+	std::vector<byte> image(height * pixelStride);
+	byte* dstPixelPtr = &image[0];
+	int fingers[2 * MAX_FINGERS], handHint[4] = { 0, 0, 0, 0 }, fingerNum = 0;
+
+	void* detector = derivativeFingerDetectorCreate(width, height, depthStride, pixelStride, 10000, scene.params.realWorldXToZ, scene.params.realWorldYToZ, threadNum);
+	derivativeFingerDetectorSetVisualization(detector, 1);
+	DetectorContext* ctx = (DetectorContext*)detector;
+	ctx->outputFlags = OutputNone;
+	ctx->rowStep = 1;
+
+	Timing t = timingInit();
+	for (int run = -1; run < iterations; run++)
+	{
+		timingBegin(t);
+		sobel(ctx, srcDepthPtr, dstPixelPtr, width, height, depthStride, pixelStride);
+		timingEnd(t, run);
+	}
+	unsigned long long hash = hashBytes(ctx->hDerivativeRes, width * height * sizeof(int));
+	report("sobel", scene, t, hashBytes(ctx->vDerivativeRes, width * height * sizeof(int), hash));
+
+	t = timingInit();
+	for (int run = -1; run < iterations; run++)
+	{
+		timingBegin(t);
+		findStrips(ctx, srcDepthPtr, dstPixelPtr, width, height, depthStride, pixelStride, 5, 30, 0, height, 0, width);
+		timingEnd(t, run);
+	}
+	report("findStrips", scene, t, hashStrips(ctx));
+
+	t = timingInit();
+	for (int run = -1; run < iterations; run++)
+	{
+		findStrips(ctx, srcDepthPtr, dstPixelPtr, width, height, depthStride, pixelStride, 5, 30, 0, height, 0, width);
+		timingBegin(t);
+		fingerNum = findFingers(ctx, srcDepthPtr, dstPixelPtr, width, height, depthStride, pixelStride, 20, 150, MAX_FINGERS, fingers, handHint);
+		timingEnd(t, run);
+	}
+	report("findFingers", scene, t, hashFingers(fingerNum, fingers, handHint));
+
+	//the overlay, as a frame with OutputImage leaves it
+	ctx->outputFlags = OutputImage;
+	memset(ctx->tmpPixelBuffer, 0, height * pixelStride);
+	findStrips(ctx, srcDepthPtr, dstPixelPtr, width, height, depthStride, pixelStride, 5, 30, 0, height, 0, width);
+	findFingers(ctx, srcDepthPtr, dstPixelPtr, width, height, depthStride, pixelStride, 20, 150, MAX_FINGERS, fingers, handHint);
+	t = timingInit();
+	for (int run = -1; run < iterations; run++)
+	{
+		timingBegin(t);
+		generateOutputImage(ctx, srcDepthPtr, dstPixelPtr, width, height, depthStride, pixelStride);
+		timingEnd(t, run);
+	}
+	report("generateOutputImage", scene, t, hashBytes(dstPixelPtr, image.size()));
+
+	t = timingInit();
+	for (int run = -1; run < iterations; run++)
+	{
+		timingBegin(t);
+		fingerNum = derivativeFingerDetectorContextWorkEx(detector, srcDepthPtr, NULL, 5, 30, 20, 150, MAX_FINGERS, fingers, handHint, OutputNone);
+		timingEnd(t, run);
+	}
+	report("frame", scene, t, hashFingers(fingerNum, fingers, handHint));
+	printf("%4dx%-4d %2d fingers found %d of them, %d detected\n", width, height, scene.fingerNum, foundTips(scene, fingers, fingerNum), fingerNum);
+
+	derivativeFingerDetectorDestroy(detector);
+}
+
+static bool readGolden(const char* path)
+{
+	FILE* file = fopen(path, "r");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	char line[256];
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		char kernel[64];
+		int width, height, fingerNum;
+		unsigned long long hash;
+		if (line[0] == '#' || sscanf(line, "%63s %dx%d %d %llx", kernel, &width, &height, &fingerNum, &hash) != 5)
+		{
+			continue;
+		}
+		char key[128];
+		sprintf(key, "%s %dx%d %d", kernel, width, height, fingerNum);
+		Golden entry = { key, hash };
+		golden.push_back(entry);
+	}
+	fclose(file);
+	return !golden.empty();
+}
+
+static bool writeGolden(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	fprintf(file, "# microBench output hashes: kernel, widthxheight, fingers, FNV-1a 64\n");
+	for (size_t k = 0; k < measured.size(); k++)
+	{
+		fprintf(file, "%s %016llx\n", measured[k].key.c_str(), measured[k].hash);
+	}
+	return fclose(file) == 0;
+}
+
+int main(int argc, char** argv)
+{
+	int iterations = 100, threadNum = 1;
+	const char* goldenPath = NULL;
+	const char* writePath = NULL;
+	for (int a = 1; a < argc; a++)
+	{
+		if (strcmp(argv[a], "--iterations") == 0 && a + 1 < argc)
+		{
+			iterations = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "--threads") == 0 && a + 1 < argc)
+		{
+			threadNum = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "--golden") == 0 && a + 1 < argc)
+		{
+			goldenPath = argv[++a];
+		}
+		else if (strcmp(argv[a], "--write-golden") == 0 && a + 1 < argc)
+		{
+			writePath = argv[++a];
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--iterations n] [--threads n] [--golden file] [--write-golden file]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (iterations < 1 || threadNum < 1)
+	{
+		fprintf(stderr, "iterations and threads must be positive\n");
+		return 1;
+	}
+	if (goldenPath != NULL && !readGolden(goldenPath))
+	{
+		fprintf(stderr, "can't read the hashes of %s\n", goldenPath);
+		return 1;
+	}
+
+	static const int sizes[2][2] = { { 640, 480 }, { 320, 240 } };
+	static const int fingerNums[4] = { 0, 1, 5, 10 };
+	for (int s = 0; s < 2; s++)
+	{
+		for (int f = 0; f < 4; f++)
+		{
+			Scene scene;
+			buildScene(scene, sizes[s][0], sizes[s][1], fingerNums[f]);
+			benchMorphology(scene, iterations);
+			benchDetector(scene, threadNum, iterations);
+		}
+	}
+
+	if (writePath != NULL && !writeGolden(writePath))
+	{
+		fprintf(stderr, "can't write %s\n", writePath);
+		return 1;
+	}
+	if (goldenPath != NULL)
+	{
+		printf(ok ? "ok\n" : "FAILED\n");
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+//Runs a depth sequence file (depthSequence.h) through the derivative detector with a grid of parameter sets, all
+//threads at once (batchDetector.h), and reports the fingers every set finds and the throughput.
+//
+//	paramSweep <sequence> [--threads n] [--width-min list] [--width-max list] [--length-min list] [--length-max list] [--verify]
+//		--threads		0 (default) takes one per cpu
+//		lists			comma separated millimetres, every combination is a parameter set; the server defaults otherwise
+//		--verify		runs again on one thread and checks that the results are the same
+//
+//Build on Linux from this directory:
+//	g++ -std=c++11 -O2 -pthread -I../KinectGesturesImageProcessorLib paramSweep.cpp ../KinectGesturesImageProcessorLib/*.cpp -o paramSweep
+
+#include "depthSequence.h"
+#include "batchDetector.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+#define MAX_FINGERS 10
+
+static std::vector<double> parseList(const char* text)
+{
+	std::vector<double> values;
+	for (const char* p = text; *p != 0; )
+	{
+		char* end;
+		values.push_back(strtod(p, &end));
+		if (end == p)
+		{
+			values.clear();
+			break;
+		}
+		p = *end == ',' ? end + 1 : end;
+	}
+	return values;
+}
+
+static bool sameResults(const BatchResults& a, const BatchResults& b, int jobNum)
+{
+	for (int k = 0; k < jobNum; k++)
+	{
+		if (a.fingerNum[k] != b.fingerNum[k] || memcmp(a.handHint + 4 * k, b.handHint + 4 * k, 4 * sizeof(int)) != 0 ||
+			memcmp(a.fingers + 2 * MAX_FINGERS * k, b.fingers + 2 * MAX_FINGERS * k, 2 * a.fingerNum[k] * sizeof(int)) != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void run(void* batch, std::vector<ushort*>& frames, std::vector<BatchParams>& params, BatchResults& results,
+				std::vector<int>& fingerNum, std::vector<int>& fingers, std::vector<int>& handHint)
+{
+	int jobNum = (int)(frames.size() * params.size());
+	fingerNum.assign(jobNum, 0);
+	fingers.assign(jobNum * 2 * MAX_FINGERS, 0);
+	handHint.assign(jobNum * 4, 0);
+	results.fingerNum = &fingerNum[0];
+	results.fingers = &fingers[0];
+	results.handHint = &handHint[0];
+	results.frameNanos = NULL;
+	batchDetectorRun(batch, &frames[0], (int)frames.size(), &params[0], (int)params.size(), MAX_FINGERS, &results);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <sequence> [--threads n] [--width-min list] [--width-max list] [--length-min list] [--length-max list] [--verify]\n", argv[0]);
+		return 1;
+	}
+
+	//the server defaults
+	std::vector<double> widthMin(1, 5), widthMax(1, 30), lengthMin(1, 20), lengthMax(1, 150);
+	int threadNum = 0;
+	bool verify = false;
+	for (int i = 2; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--verify") == 0) verify = true;
+		else if (i + 1 >= argc) { fprintf(stderr, "%s takes a value\n", argv[i]); return 1; }
+		else if (strcmp(argv[i], "--threads") == 0) threadNum = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--width-min") == 0) widthMin = parseList(argv[++i]);
+		else if (strcmp(argv[i], "--width-max") == 0) widthMax = parseList(argv[++i]);
+		else if (strcmp(argv[i], "--length-min") == 0) lengthMin = parseList(argv[++i]);
+		else if (strcmp(argv[i], "--length-max") == 0) lengthMax = parseList(argv[++i]);
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	std::vector<BatchParams> params;
+	for (size_t a = 0; a < widthMin.size(); a++)
+		for (size_t b = 0; b < widthMax.size(); b++)
+			for (size_t c = 0; c < lengthMin.size(); c++)
+				for (size_t d = 0; d < lengthMax.size(); d++)
+				{
+					BatchParams p = { widthMin[a], widthMax[b], lengthMin[c], lengthMax[d] };
+					params.push_back(p);
+				}
+	if (params.empty())
+	{
+		fprintf(stderr, "empty parameter list\n");
+		return 1;
+	}
+
+	DepthSequence* sequence = (DepthSequence*)depthSequenceOpen(argv[1]);
+	if (sequence == NULL)
+	{
+		fprintf(stderr, "%s is not a depth sequence\n", argv[1]);
+		return 1;
+	}
+	const DepthSequenceHeader* header = sequence->header;
+	std::vector<ushort*> frames;
+	for (int k = 0; k < header->frameNum; k++)
+	{
+		frames.push_back((ushort*)depthSequenceFrame(sequence, k));
+	}
+	if (frames.empty())
+	{
+		fprintf(stderr, "%s has no frames\n", argv[1]);
+		depthSequenceClose(sequence);
+		return 1;
+	}
+
+	void* batch = batchDetectorCreate(header->width, header->height, header->width, header->deviceMaxDepth, header->realWorldXToZ, header->realWorldYToZ, threadNum);
+	if (batch == NULL)
+	{
+		fprintf(stderr, "out of memory\n");
+		depthSequenceClose(sequence);
+		return 1;
+	}
+
+	BatchResults results;
+	std::vector<int> fingerNum, fingers, handHint;
+	run(batch, frames, params, results, fingerNum, fingers, handHint);
+
+	BatchStats stats;
+	batchDetectorGetStats(batch, &stats);
+	printf("%s: %d frames x %d parameter sets on %d threads, %.1f frames/s, %.2f threads busy on average\n", argv[1],
+		   (int)frames.size(), (int)params.size(), stats.threadNum, stats.jobs / (stats.wallNanos * 1e-9), (double)stats.busyNanos / stats.wallNanos);
+
+	int paramNum = (int)params.size();
+	for (int p = 0; p < paramNum; p++)
+	{
+		int framesWithFingers = 0;
+		long long total = 0;
+		for (size_t k = 0; k < frames.size(); k++)
+		{
+			int n = fingerNum[k * paramNum + p];
+			framesWithFingers += n > 0;
+			total += n;
+		}
+		printf("width %5.1f..%-5.1f length %5.1f..%-5.1f  fingers avg %.2f, frames with fingers %d\n", params[p].fingerWidthMin, params[p].fingerWidthMax,
+			   params[p].fingerLengthMin, params[p].fingerLengthMax, (double)total / frames.size(), framesWithFingers);
+	}
+
+	int status = 0;
+	if (verify)
+	{
+		void* serial = batchDetectorCreate(header->width, header->height, header->width, header->deviceMaxDepth, header->realWorldXToZ, header->realWorldYToZ, 1);
+		BatchResults serialResults;
+		std::vector<int> serialFingerNum, serialFingers, serialHandHint;
+		run(serial, frames, params, serialResults, serialFingerNum, serialFingers, serialHandHint);
+		batchDetectorGetStats(serial, &stats);
+		bool same = sameResults(results, serialResults, (int)(frames.size() * params.size()));
+		printf("one thread: %.1f frames/s, results %s\n", stats.jobs / (stats.wallNanos * 1e-9), same ? "the same" : "DIFFERENT");
+		status = same ? 0 : 1;
+		batchDetectorDestroy(serial);
+	}
+
+	batchDetectorDestroy(batch);
+	depthSequenceClose(sequence);
+	return status;
+}
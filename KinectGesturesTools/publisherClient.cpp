@@ -0,0 +1,322 @@
+//Test client of the binary result publisher (resultPublisher.h).
+//
+//	publisherClient <host> <port> [--frames n]
+//		connects to a running server and prints every packet, stops after n packets if given
+//	publisherClient --loopback [--clients n] [--frames n] [--fps n]
+//		self test without a sensor: publishes n synthetic frames (2000 by default) at n fps (1000 by default) to n
+//		reading clients (4 by default) and one client that never reads, over loopback. Checks that every packet arrives
+//		whole and in order, that the readers get the last frame and that the stalled client is dropped, not waited for.
+//		Exits with 1 on a failure.
+//
+//Build on Linux from this directory:
+//	g++ -std=c++11 -O2 -pthread -I../KinectGesturesImageProcessorLib publisherClient.cpp ../KinectGesturesImageProcessorLib/*.cpp -o publisherClient
+
+#include "resultPublisher.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include <pthread.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define LOOPBACK_QUEUE_BYTES 16384
+#define LOOPBACK_DROP_AFTER 50
+
+typedef struct Reader
+{
+	int socket;
+	long long lastFrame;		//stop after it
+	long long packets, gaps, errors, latest;
+	pthread_t thread;
+} Reader;
+
+static void sleepMillis(int millis)
+{
+	timespec ts = { millis / 1000, (millis % 1000) * 1000000L };
+	nanosleep(&ts, NULL);
+}
+
+static int connectTo(const char* host, int port, int receiveBuffer)
+{
+	addrinfo hints, *result;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	char service[16];
+	sprintf(service, "%d", port);
+	if (getaddrinfo(host, service, &hints, &result) != 0)
+	{
+		return -1;
+	}
+
+	int s = socket(AF_INET, SOCK_STREAM, 0);
+	if (s >= 0 && receiveBuffer > 0)
+	{
+		setsockopt(s, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+	}
+	if (s >= 0 && connect(s, result->ai_addr, result->ai_addrlen) != 0)
+	{
+		close(s);
+		s = -1;
+	}
+	freeaddrinfo(result);
+	return s;
+}
+
+//reads exactly size bytes, false when the connection ends
+static bool readFully(int s, void* buffer, int size)
+{
+	for (int got = 0; got < size; )
+	{
+		int n = (int)recv(s, (char*)buffer + got, size - got, 0);
+		if (n <= 0)
+		{
+			return false;
+		}
+		got += n;
+	}
+	return true;
+}
+
+//one packet into packet, false at the end of the stream or on a malformed header
+static bool readPacket(int s, std::vector<byte>& packet)
+{
+	PublisherPacketHeader header;
+	if (!readFully(s, &header, sizeof(header)))
+	{
+		return false;
+	}
+	if (header.magic != PUBLISHER_MAGIC || header.version != PUBLISHER_VERSION || header.headerSize != sizeof(header) ||
+		header.packetSize != sizeof(header) + header.fingerNum * sizeof(PublisherFinger) + header.eventNum * sizeof(PublisherHandEvent))
+	{
+		fprintf(stderr, "malformed packet header\n");
+		return false;
+	}
+
+	packet.resize(header.packetSize);
+	memcpy(&packet[0], &header, sizeof(header));
+	return readFully(s, &packet[sizeof(header)], header.packetSize - sizeof(header));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//loopback self test, the synthetic frame k has k % 6 fingers at (k % 500 + i, 10 * i) and a hand update every 10 frames
+
+static int syntheticFrame(long long k, int* fingers)
+{
+	int fingerNum = (int)(k % 6);
+	for (int i = 0; i < fingerNum; i++)
+	{
+		fingers[2 * i] = (int)(k % 500) + i;
+		fingers[2 * i + 1] = 10 * i;
+	}
+	return fingerNum;
+}
+
+static bool checkPacket(const std::vector<byte>& packet)
+{
+	const PublisherPacketHeader* header = (const PublisherPacketHeader*)&packet[0];
+	const PublisherFinger* finger = (const PublisherFinger*)(header + 1);
+	const PublisherHandEvent* ev = (const PublisherHandEvent*)(finger + header->fingerNum);
+
+	int expected[2 * PUBLISHER_MAX_FINGERS];
+	if (header->fingerNum != syntheticFrame(header->frame, expected) || header->timestamp != header->frame * 1000 || header->handHint[3] != (int)(header->frame % 7))
+	{
+		return false;
+	}
+	for (int i = 0; i < header->fingerNum; i++)
+	{
+		if (finger[i].x != expected[2 * i] || finger[i].y != expected[2 * i + 1])
+		{
+			return false;
+		}
+	}
+	//events of frames the publisher had no room for come with a later one
+	for (int i = 0; i < header->eventNum; i++)
+	{
+		if (ev[i].type != HandUpdate || ev[i].userId != 1 || ev[i].x % 10 != 0 || ev[i].x > header->frame)
+		{
+			return false;
+		}
+	}
+	return header->frame % 10 != 0 || header->eventNum > 0;
+}
+
+static void* readerProc(void* arg)
+{
+	Reader* reader = (Reader*)arg;
+	std::vector<byte> packet;
+
+	while (reader->latest < reader->lastFrame && readPacket(reader->socket, packet))
+	{
+		const PublisherPacketHeader* header = (const PublisherPacketHeader*)&packet[0];
+		if (header->frame <= reader->latest || !checkPacket(packet))
+		{
+			reader->errors++;
+		}
+		reader->gaps += header->frame > reader->latest + 1 ? 1 : 0;
+		reader->latest = header->frame;
+		reader->packets++;
+	}
+	return NULL;
+}
+
+static int loopback(int clientNum, int frames, int fps)
+{
+	void* publisher = resultPublisherCreate("127.0.0.1", 0, clientNum + 1, LOOPBACK_QUEUE_BYTES, LOOPBACK_DROP_AFTER);
+	if (publisher == NULL)
+	{
+		fprintf(stderr, "could not start the publisher\n");
+		return 1;
+	}
+	int port = resultPublisherGetPort(publisher);
+
+	//the stalled client: a small receive buffer it never reads, the publisher's queue for it fills up soon
+	int stalled = connectTo("127.0.0.1", port, 4096);
+	std::vector<Reader> readers(clientNum);
+	for (int c = 0; c < clientNum; c++)
+	{
+		memset(&readers[c], 0, sizeof(Reader));
+		readers[c].socket = connectTo("127.0.0.1", port, 0);
+		readers[c].lastFrame = frames;
+		if (stalled < 0 || readers[c].socket < 0)
+		{
+			fprintf(stderr, "could not connect to port %d\n", port);
+			return 1;
+		}
+	}
+
+	PublisherStats stats;
+	for (int wait = 0; wait < 1000; wait++)
+	{
+		resultPublisherGetStats(publisher, &stats);
+		if (stats.clients == clientNum + 1)
+		{
+			break;
+		}
+		sleepMillis(1);
+	}
+	for (int c = 0; c < clientNum; c++)
+	{
+		pthread_create(&readers[c].thread, NULL, readerProc, &readers[c]);
+	}
+
+	int fingers[2 * PUBLISHER_MAX_FINGERS];
+	long long streamBytes = 0;
+	for (long long k = 1; k <= frames; k++)
+	{
+		if (k % 10 == 0)
+		{
+			resultPublisherAddHandEvent(publisher, HandUpdate, 1, (int)k, 0, 800);
+		}
+		int handHint[4] = { 0, 0, 0, (int)(k % 7) };
+		int fingerNum = syntheticFrame(k, fingers);
+		streamBytes += sizeof(PublisherPacketHeader) + fingerNum * sizeof(PublisherFinger) + (k % 10 == 0 ? sizeof(PublisherHandEvent) : 0);
+		//a frame the publisher thread had no room for is a gap, only the last one has to make it: the readers wait for it
+		while (resultPublisherPublishFrame(publisher, k, k * 1000, fingers, fingerNum, handHint) != 0 && k == frames)
+		{
+			sleepMillis(1);
+		}
+		sleepMillis(1000 / fps);
+	}
+
+	bool ok = true;
+	for (int c = 0; c < clientNum; c++)
+	{
+		pthread_join(readers[c].thread, NULL);
+		Reader* r = &readers[c];
+		printf("reader %d: %lld packets, %lld gaps, %lld errors, last frame %lld\n", c, r->packets, r->gaps, r->errors, r->latest);
+		ok = ok && r->errors == 0 && r->latest == frames;
+	}
+
+	//before the readers hang up, they'd count as disconnected as well
+	resultPublisherGetStats(publisher, &stats);
+	printf("publisher: %lld published, %lld sent, %lld skipped, %lld overflowed, %lld bytes, %d accepted, %d disconnected\n",
+		   stats.published, stats.sent, stats.skipped, stats.overflowed, stats.bytes, stats.accepted, stats.disconnected);
+	//the kernel buffers on both ends take a few times the queue before the publisher notices anything
+	if (stats.disconnected < 1 && streamBytes > 8 * LOOPBACK_QUEUE_BYTES)
+	{
+		fprintf(stderr, "the stalled client was not dropped\n");
+		ok = false;
+	}
+
+	for (int c = 0; c < clientNum; c++)
+	{
+		close(readers[c].socket);
+	}
+	close(stalled);
+	resultPublisherDestroy(publisher);
+	printf(ok ? "ok\n" : "FAILED\n");
+	return ok ? 0 : 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+
+static int follow(const char* host, int port, int frames)
+{
+	int s = connectTo(host, port, 0);
+	if (s < 0)
+	{
+		fprintf(stderr, "could not connect to %s:%d\n", host, port);
+		return 1;
+	}
+
+	std::vector<byte> packet;
+	for (int k = 0; (frames <= 0 || k < frames) && readPacket(s, packet); k++)
+	{
+		const PublisherPacketHeader* header = (const PublisherPacketHeader*)&packet[0];
+		const PublisherFinger* finger = (const PublisherFinger*)(header + 1);
+		const PublisherHandEvent* ev = (const PublisherHandEvent*)(finger + header->fingerNum);
+
+		printf("frame %lld at %lld: hand hint %d,%d,%d (%d), %d fingers", header->frame, header->timestamp,
+			   header->handHint[0], header->handHint[1], header->handHint[2], header->handHint[3], header->fingerNum);
+		for (int i = 0; i < header->fingerNum; i++)
+		{
+			printf(" (%d,%d)", finger[i].x, finger[i].y);
+		}
+		for (int i = 0; i < header->eventNum; i++)
+		{
+			static const char* names[] = { "?", "create", "update", "destroy" };
+			printf(", hand %s %d at %d,%d,%d", names[ev[i].type <= HandDestroy ? ev[i].type : 0], ev[i].userId, ev[i].x, ev[i].y, ev[i].z);
+		}
+		printf("\n");
+	}
+
+	close(s);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	bool self = argc >= 2 && strcmp(argv[1], "--loopback") == 0;
+	if (argc < 2 || (!self && argc < 3))
+	{
+		fprintf(stderr, "usage: %s <host> <port> [--frames n]\n       %s --loopback [--clients n] [--frames n] [--fps n]\n", argv[0], argv[0]);
+		return 1;
+	}
+
+	int clientNum = 4, frames = self ? 2000 : 0, fps = 1000;
+	for (int i = self ? 2 : 3; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "--clients") == 0) clientNum = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--frames") == 0) frames = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--fps") == 0) fps = atoi(argv[i + 1]);
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if (fps <= 0 || fps > 1000)
+	{
+		fprintf(stderr, "--fps takes 1 to 1000\n");
+		return 1;
+	}
+
+	return self ? loopback(clientNum, frames, fps) : follow(argv[1], atoi(argv[2]), frames);
+}
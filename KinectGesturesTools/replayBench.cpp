@@ -0,0 +1,343 @@
+//Replays a depth sequence file (depthSequence.h) through the finger detectors without a sensor, headless, and reports
+//per frame latency percentiles, throughput and the detected finger counts.
+//
+//	replayBench <sequence> [--threads n] [--repeat n] [--calibration n] [--pyramid level]
+//		--threads		threads of the derivative detector, 1 by default
+//		--repeat		replay the sequence n times, 1 by default
+//		--calibration	first frames averaged into the table of the touch path, 10 by default
+//		--pyramid		compares the pyramid mode of the given level with the full resolution detector instead
+//
+//Two paths are timed:
+//	derivative	derivativeFingerDetectorWork, as MultiTouchTrackerOmni runs it, then the finger tracker on its result
+//	touch		threshold against the table + open + extractPoints, the old MultiTouchTracker path
+//
+//With --pyramid both detectors run every frame without an image, see derivativeFingerDetectorSetPyramid. Every tip of
+//the full resolution detector is matched with the closest pyramid tip within TIP_MATCH_DISTANCE pixels; the error is
+//their distance, the tips without a match are missed and the pyramid tips left over are extra.
+//
+//Build on Linux from this directory:
+//	g++ -std=c++11 -O2 -pthread -I../KinectGesturesImageProcessorLib replayBench.cpp ../KinectGesturesImageProcessorLib/*.cpp -o replayBench
+
+#include "depthSequence.h"
+#include "derivativeFingerDetector.h"
+#include "detectorContext.h"
+#include "fingerTracker.h"
+#include "dip.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#define MAX_FINGERS 10
+
+//the server defaults
+#define FINGER_WIDTH_MIN 5
+#define FINGER_WIDTH_MAX 30
+#define FINGER_LENGTH_MIN 20
+#define FINGER_LENGTH_MAX 150
+#define NOISE_THRESHOLD 3		//millimeters above the table
+#define FINGER_THRESHOLD 20
+#define TOUCH_MIN_AREA 20
+#define REFINE_PADDING 16		//the detector's default
+#define TIP_MATCH_DISTANCE 8	//pixels
+
+typedef struct Stats
+{
+	std::vector<double> latency;		//milliseconds
+	std::vector<int> fingers;
+	double seconds;
+	std::vector<double> trackerLatency;	//microseconds, derivative only
+	int trackIds;
+} Stats;
+
+static double now()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+	int index = (int)(p * (sorted.size() - 1) + 0.5);
+	return sorted[index];
+}
+
+static void report(const char* name, Stats& stats)
+{
+	std::vector<double> sorted = stats.latency;
+	std::sort(sorted.begin(), sorted.end());
+
+	int maxCount = 0;
+	long long total = 0;
+	for (size_t k = 0; k < stats.fingers.size(); k++)
+	{
+		maxCount = std::max(maxCount, stats.fingers[k]);
+		total += stats.fingers[k];
+	}
+
+	printf("%-10s frames %d  p50 %.3f ms  p99 %.3f ms  max %.3f ms  throughput %.1f fps\n", name, (int)sorted.size(),
+		   percentile(sorted, 0.5), percentile(sorted, 0.99), sorted.back(), sorted.size() / stats.seconds);
+	printf("%-10s fingers avg %.2f, frames with n fingers:", "", (double)total / stats.fingers.size());
+	for (int n = 0; n <= maxCount; n++)
+	{
+		printf(" %d:%d", n, (int)std::count(stats.fingers.begin(), stats.fingers.end(), n));
+	}
+	printf("\n");
+
+	if (!stats.trackerLatency.empty())
+	{
+		sorted = stats.trackerLatency;
+		std::sort(sorted.begin(), sorted.end());
+		printf("%-10s tracker p50 %.2f us  p99 %.2f us  max %.2f us, %d finger ids\n", "", percentile(sorted, 0.5), percentile(sorted, 0.99),
+			   sorted.back(), stats.trackIds);
+	}
+}
+
+static void replayDerivative(const DepthSequence* sequence, int threadNum, int repeat, Stats& stats)
+{
+	const DepthSequenceHeader* header = sequence->header;
+	int width = header->width, height = header->height;
+	std::vector<byte> output(width * height * 3);
+	int result[2 * MAX_FINGERS], handHint[4];
+
+	derivativeFingerDetectorInitParallel(NULL, NULL, width, height, width, width * 3, header->deviceMaxDepth, header->realWorldXToZ, header->realWorldYToZ, threadNum);
+	FingerTracker tracker;
+	fingerTrackerInit(&tracker);
+
+	double begin = now();
+	for (int r = 0; r < repeat; r++)
+	{
+		fingerTrackerReset(&tracker);		//the timestamps start over
+		for (int k = 0; k < header->frameNum; k++)
+		{
+			double t0 = now();
+			int fingerNum = derivativeFingerDetectorWork((ushort*)depthSequenceFrame(sequence, k), &output[0], width, height, width, width * 3,
+														 FINGER_WIDTH_MIN, FINGER_WIDTH_MAX, FINGER_LENGTH_MIN, FINGER_LENGTH_MAX, MAX_FINGERS, result, handHint);
+			stats.latency.push_back((now() - t0) * 1000);
+			stats.fingers.push_back(fingerNum);
+
+			double t1 = now();
+			fingerTrackerStep(&tracker, sequence->timestamps[k], result, fingerNum);
+			stats.trackerLatency.push_back((now() - t1) * 1e6);
+		}
+	}
+	stats.seconds = now() - begin;
+	stats.trackIds = tracker.nextId - 1;
+
+	derivativeFingerDetectorDispose();
+}
+
+typedef struct TipError
+{
+	std::vector<double> error;			//pixels, of every matched tip
+	int missed, extra;
+} TipError;
+
+//the full resolution tips greedily matched, closest pair first
+static void matchTips(const int* full, int fullNum, const int* pyramid, int pyramidNum, TipError& tips)
+{
+	bool fullMatched[MAX_FINGERS] = { false }, pyramidMatched[MAX_FINGERS] = { false };
+	int matched = 0;
+	while (true)
+	{
+		int bestF = -1, bestP = -1, bestDist2 = TIP_MATCH_DISTANCE * TIP_MATCH_DISTANCE + 1;
+		for (int f = 0; f < fullNum; f++)
+		{
+			for (int p = 0; p < pyramidNum && !fullMatched[f]; p++)
+			{
+				int dx = full[2 * f] - pyramid[2 * p], dy = full[2 * f + 1] - pyramid[2 * p + 1];
+				if (!pyramidMatched[p] && dx * dx + dy * dy < bestDist2)
+				{
+					bestF = f;
+					bestP = p;
+					bestDist2 = dx * dx + dy * dy;
+				}
+			}
+		}
+		if (bestF < 0)
+		{
+			break;
+		}
+		fullMatched[bestF] = pyramidMatched[bestP] = true;
+		tips.error.push_back(sqrt((double)bestDist2));
+		matched++;
+	}
+	tips.missed += fullNum - matched;
+	tips.extra += pyramidNum - matched;
+}
+
+static void replayPyramid(const DepthSequence* sequence, int threadNum, int repeat, int level, Stats& full, Stats& pyramid, TipError& tips)
+{
+	const DepthSequenceHeader* header = sequence->header;
+	int width = header->width, height = header->height;
+	void* detectors[2];
+	Stats* stats[2] = { &full, &pyramid };
+	for (int d = 0; d < 2; d++)
+	{
+		detectors[d] = derivativeFingerDetectorCreate(width, height, width, width * 3, header->deviceMaxDepth, header->realWorldXToZ, header->realWorldYToZ, threadNum);
+		stats[d]->seconds = 0;
+	}
+	if (derivativeFingerDetectorSetPyramid(detectors[1], level, REFINE_PADDING) < 0)
+	{
+		fprintf(stderr, "pyramid level %d isn't supported at %dx%d\n", level, width, height);
+		exit(1);
+	}
+
+	int result[2][2 * MAX_FINGERS], handHint[4];
+	tips.missed = tips.extra = 0;
+	for (int r = 0; r < repeat; r++)
+	{
+		for (int k = 0; k < header->frameNum; k++)
+		{
+			int fingerNum[2];
+			for (int d = 0; d < 2; d++)
+			{
+				double t0 = now();
+				fingerNum[d] = derivativeFingerDetectorContextWorkEx(detectors[d], (ushort*)depthSequenceFrame(sequence, k), NULL, FINGER_WIDTH_MIN, FINGER_WIDTH_MAX,
+																	 FINGER_LENGTH_MIN, FINGER_LENGTH_MAX, MAX_FINGERS, result[d], handHint, OutputNone);
+				double seconds = now() - t0;
+				stats[d]->latency.push_back(seconds * 1000);
+				stats[d]->fingers.push_back(fingerNum[d]);
+				stats[d]->seconds += seconds;
+			}
+			matchTips(result[0], fingerNum[0], result[1], fingerNum[1], tips);
+		}
+	}
+
+	for (int d = 0; d < 2; d++)
+	{
+		derivativeFingerDetectorDestroy(detectors[d]);
+	}
+}
+
+static void reportTips(const TipError& tips)
+{
+	double sum = 0, maxError = 0;
+	for (size_t k = 0; k < tips.error.size(); k++)
+	{
+		sum += tips.error[k];
+		maxError = std::max(maxError, tips.error[k]);
+	}
+	printf("%-10s tips matched %d  error mean %.2f px  max %.2f px, missed %d, extra %d\n", "", (int)tips.error.size(),
+		   tips.error.empty() ? 0 : sum / tips.error.size(), maxError, tips.missed, tips.extra);
+}
+
+static void replayTouch(const DepthSequence* sequence, int calibrationFrames, int repeat, Stats& stats)
+{
+	const DepthSequenceHeader* header = sequence->header;
+	int width = header->width, height = header->height, size = width * height;
+
+	//the table: average of the valid readings of the first frames
+	std::vector<double> table(size, 0);
+	std::vector<int> samples(size, 0);
+	calibrationFrames = std::min(calibrationFrames, header->frameNum);
+	for (int k = 0; k < calibrationFrames; k++)
+	{
+		const ushort* frame = depthSequenceFrame(sequence, k);
+		for (int p = 0; p < size; p++)
+		{
+			if (frame[p] != 0)
+			{
+				table[p] += frame[p];
+				samples[p]++;
+			}
+		}
+	}
+	for (int p = 0; p < size; p++)
+	{
+		table[p] = samples[p] > 0 ? table[p] / samples[p] : 0;
+	}
+
+	std::vector<byte> src(size), dst(size), switchBuffer(size);
+	int result[2 * MAX_FINGERS];
+
+	double begin = now();
+	for (int r = 0; r < repeat; r++)
+	{
+		for (int k = 0; k < header->frameNum; k++)
+		{
+			const ushort* frame = depthSequenceFrame(sequence, k);
+
+			double t0 = now();
+			for (int p = 0; p < size; p++)
+			{
+				double dist = table[p] - frame[p];
+				src[p] = bwBit(dist >= NOISE_THRESHOLD && dist < FINGER_THRESHOLD);
+			}
+			open(&src[0], &dst[0], width, height, width, &switchBuffer[0]);
+			int fingerNum = extractPoints(&dst[0], &src[0], width, height, width, &switchBuffer[0], MAX_FINGERS, TOUCH_MIN_AREA, result);
+			stats.latency.push_back((now() - t0) * 1000);
+			stats.fingers.push_back(fingerNum);
+		}
+	}
+	stats.seconds = now() - begin;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <sequence> [--threads n] [--repeat n] [--calibration n] [--pyramid level]\n", argv[0]);
+		return 1;
+	}
+
+	int threadNum = 1, repeat = 1, calibrationFrames = 10, pyramidLevel = 0;
+	for (int i = 2; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "--threads") == 0) threadNum = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--repeat") == 0) repeat = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--calibration") == 0) calibrationFrames = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "--pyramid") == 0) pyramidLevel = atoi(argv[i + 1]);
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	DepthSequence* sequence = (DepthSequence*)depthSequenceOpen(argv[1]);
+	if (sequence == NULL)
+	{
+		fprintf(stderr, "%s is not a depth sequence\n", argv[1]);
+		return 1;
+	}
+
+	const DepthSequenceHeader* header = sequence->header;
+	if (header->frameNum == 0)
+	{
+		fprintf(stderr, "%s has no frames\n", argv[1]);
+		depthSequenceClose(sequence);
+		return 1;
+	}
+
+	long long duration = header->frameNum > 1 ? sequence->timestamps[header->frameNum - 1] - sequence->timestamps[0] : 0;
+	printf("%s: %dx%d, %d frames over %.1f s, max depth %d\n", argv[1], header->width, header->height, header->frameNum,
+		   duration * 1e-6, header->deviceMaxDepth);
+
+	if (pyramidLevel > 0)
+	{
+		Stats full, pyramid;
+		TipError tips;
+		replayPyramid(sequence, threadNum, repeat, pyramidLevel, full, pyramid, tips);
+		char name[32];
+		sprintf(name, "pyramid %d", pyramidLevel);
+		report("full", full);
+		report(name, pyramid);
+		reportTips(tips);
+	}
+	else
+	{
+		Stats derivative, touch;
+		replayDerivative(sequence, threadNum, repeat, derivative);
+		replayTouch(sequence, calibrationFrames, repeat, touch);
+		report("derivative", derivative);
+		report("touch", touch);
+	}
+
+	depthSequenceClose(sequence);
+	return 0;
+}
@@ -0,0 +1,235 @@
+//Converts a debug snapshot of the derivative detector (debugCapture.h) into files for a spreadsheet or an image viewer.
+//
+//	snapshotDump <snapshot> [<output prefix>]
+//		writes, next to the snapshot unless a prefix is given:
+//		<prefix>depth.png				16 bit grayscale, millimetres
+//		<prefix>derivativeH.csv			with the derivative frames only, one row of the frame per line
+//		<prefix>derivativeV.csv
+//		<prefix>strips.csv				row, leftCol, rightCol
+//		<prefix>fingers.csv				x, y, then the hand hint
+//		<prefix>image.png				the RGB debug image, when the frame had one
+//
+//Build on Linux from this directory:
+//	g++ -std=c++11 -O2 -I../KinectGesturesImageProcessorLib snapshotDump.cpp -o snapshotDump
+
+#include "debugCapture.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+//---------------------------------------------------------------------------------------------------------------------
+//PNG without a compression library: the image data goes into stored (uncompressed) deflate blocks
+
+static unsigned int crcTable[256];
+
+static void initCrc()
+{
+	for (unsigned int n = 0; n < 256; n++)
+	{
+		unsigned int c = n;
+		for (int k = 0; k < 8; k++)
+		{
+			c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+		}
+		crcTable[n] = c;
+	}
+}
+
+static unsigned int crc(unsigned int c, const byte* data, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		c = crcTable[(c ^ data[i]) & 0xff] ^ (c >> 8);
+	}
+	return c;
+}
+
+static void putBigEndian(std::vector<byte>& out, unsigned int value)
+{
+	out.push_back((byte)(value >> 24));
+	out.push_back((byte)(value >> 16));
+	out.push_back((byte)(value >> 8));
+	out.push_back((byte)value);
+}
+
+static void writeChunk(FILE* file, const char* type, const std::vector<byte>& data)
+{
+	std::vector<byte> chunk;
+	putBigEndian(chunk, (unsigned int)data.size());
+	chunk.insert(chunk.end(), type, type + 4);
+	chunk.insert(chunk.end(), data.begin(), data.end());
+	putBigEndian(chunk, crc(0xffffffffu, &chunk[4], chunk.size() - 4) ^ 0xffffffffu);
+	fwrite(&chunk[0], 1, chunk.size(), file);
+}
+
+//rows: height rows of rowBytes, already in PNG byte order. colorType 0 gray, 2 RGB.
+static bool writePng(const std::string& path, const byte* rows, int width, int height, int rowBytes, int bitDepth, int colorType)
+{
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	static const byte signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	fwrite(signature, 1, 8, file);
+
+	std::vector<byte> header;
+	putBigEndian(header, width);
+	putBigEndian(header, height);
+	header.push_back((byte)bitDepth);
+	header.push_back((byte)colorType);
+	header.push_back(0);	//deflate
+	header.push_back(0);	//adaptive filtering
+	header.push_back(0);	//no interlace
+	writeChunk(file, "IHDR", header);
+
+	//filter type 0 in front of every row
+	std::vector<byte> raw;
+	for (int i = 0; i < height; i++)
+	{
+		raw.push_back(0);
+		raw.insert(raw.end(), rows + (size_t)i * rowBytes, rows + (size_t)(i + 1) * rowBytes);
+	}
+
+	std::vector<byte> zlib;
+	zlib.push_back(0x78);
+	zlib.push_back(0x01);
+	for (size_t pos = 0; pos < raw.size(); )
+	{
+		size_t size = raw.size() - pos < 65535 ? raw.size() - pos : 65535;
+		zlib.push_back(pos + size == raw.size() ? 1 : 0);	//last block
+		zlib.push_back((byte)size);
+		zlib.push_back((byte)(size >> 8));
+		zlib.push_back((byte)~size);
+		zlib.push_back((byte)(~size >> 8));
+		zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + size);
+		pos += size;
+	}
+	unsigned int a = 1, b = 0;		//adler32
+	for (size_t i = 0; i < raw.size(); i++)
+	{
+		a = (a + raw[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	putBigEndian(zlib, (b << 16) | a);
+	writeChunk(file, "IDAT", zlib);
+	writeChunk(file, "IEND", std::vector<byte>());
+
+	return fclose(file) == 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+
+static bool writeCsv(const std::string& path, const int* values, int columns, int rows)
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (file == NULL)
+	{
+		return false;
+	}
+	for (int i = 0; i < rows; i++)
+	{
+		for (int j = 0; j < columns; j++)
+		{
+			fprintf(file, j + 1 < columns ? "%d, " : "%d\n", values[i * columns + j]);
+		}
+	}
+	return fclose(file) == 0;
+}
+
+static bool readAll(FILE* file, void* buffer, size_t size)
+{
+	return size == 0 || fread(buffer, 1, size, file) == size;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <snapshot> [<output prefix>]\n", argv[0]);
+		return 1;
+	}
+
+	std::string prefix = argc > 2 ? argv[2] : std::string(argv[1]) + ".";
+	FILE* file = fopen(argv[1], "rb");
+	if (file == NULL)
+	{
+		fprintf(stderr, "can't open %s\n", argv[1]);
+		return 1;
+	}
+
+	DebugSnapshotHeader header;
+	if (!readAll(file, &header, sizeof(header)) || strcmp(header.magic, DEBUG_SNAPSHOT_MAGIC) != 0 ||
+		header.version != DEBUG_SNAPSHOT_VERSION || header.headerSize != sizeof(header))
+	{
+		fprintf(stderr, "%s is not a debug snapshot\n", argv[1]);
+		fclose(file);
+		return 1;
+	}
+
+	int size = header.width * header.height;
+	std::vector<ushort> depth(size);
+	std::vector<int> hDerivative, vDerivative;
+	std::vector<int> strips(3 * header.stripNum + 1), fingers(2 * header.fingerNum + 1);
+	std::vector<byte> image;
+	bool ok = readAll(file, &depth[0], size * sizeof(ushort));
+	if (header.flags & SnapshotDerivative)
+	{
+		hDerivative.resize(size);
+		vDerivative.resize(size);
+		ok = ok && readAll(file, &hDerivative[0], size * sizeof(int)) && readAll(file, &vDerivative[0], size * sizeof(int));
+	}
+	ok = ok && readAll(file, &strips[0], 3 * header.stripNum * sizeof(int));
+	ok = ok && readAll(file, &fingers[0], 2 * header.fingerNum * sizeof(int));
+	if (header.flags & SnapshotImage)
+	{
+		image.resize(3 * size);
+		ok = ok && readAll(file, &image[0], 3 * size);
+	}
+	fclose(file);
+	if (!ok)
+	{
+		fprintf(stderr, "%s is cut short\n", argv[1]);
+		return 1;
+	}
+
+	printf("%s: %dx%d at %lld, %d fingers, %d strips, hand hint %d,%d,%d (%d)%s%s\n", argv[1], header.width, header.height,
+		   header.timestamp, header.fingerNum, header.stripNum, header.handHint[0], header.handHint[1], header.handHint[2], header.handHint[3],
+		   (header.flags & SnapshotDerivative) ? ", derivative" : "", (header.flags & SnapshotImage) ? ", image" : "");
+
+	initCrc();
+	std::vector<byte> depthRows(2 * size);
+	for (int p = 0; p < size; p++)
+	{
+		depthRows[2 * p] = (byte)(depth[p] >> 8);
+		depthRows[2 * p + 1] = (byte)depth[p];
+	}
+	ok = writePng(prefix + "depth.png", &depthRows[0], header.width, header.height, 2 * header.width, 16, 0);
+	if (header.flags & SnapshotDerivative)
+	{
+		ok = writeCsv(prefix + "derivativeH.csv", &hDerivative[0], header.width, header.height) && ok;
+		ok = writeCsv(prefix + "derivativeV.csv", &vDerivative[0], header.width, header.height) && ok;
+	}
+	ok = writeCsv(prefix + "strips.csv", &strips[0], 3, header.stripNum) && ok;
+	ok = writeCsv(prefix + "fingers.csv", &fingers[0], 2, header.fingerNum) && ok;
+	FILE* hint = fopen((prefix + "fingers.csv").c_str(), "a");
+	ok = hint != NULL && fprintf(hint, "hand hint, %d, %d, %d, %d\n", header.handHint[0], header.handHint[1], header.handHint[2], header.handHint[3]) > 0 && ok;
+	if (hint != NULL)
+	{
+		fclose(hint);
+	}
+	if (header.flags & SnapshotImage)
+	{
+		ok = writePng(prefix + "image.png", &image[0], header.width, header.height, 3 * header.width, 8, 2) && ok;
+	}
+
+	if (!ok)
+	{
+		fprintf(stderr, "could not write all files of %s\n", prefix.c_str());
+		return 1;
+	}
+	return 0;
+}
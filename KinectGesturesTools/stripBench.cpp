@@ -0,0 +1,171 @@
+//Times findStrips and findFingers on the worst case of the strip store: a comb of narrow ridges across the frame,
+//about a strip every 6 columns of every row, so every chain has neighbours to search on both sides. Both linking
+//modes of derivativeFingerDetectorSetLinking run on every comb.
+//
+//	stripBench [--iterations n] [--threads n] [--width n] [--height n]
+//		--iterations	runs of every kernel per comb, 100 by default
+//		--threads		threads of the derivative detector, 1 by default
+//		--width, --height	640x480 by default
+//
+//Combs, ridges of 3 px 100 mm above a table 800 mm away, from row height / 12 to row height * 11 / 12:
+//	continuous		straight ridges, a chain per ridge as long as the comb, too long for a finger
+//	broken			every 3rd row of the ridges missing, chains have to step over the gaps
+//	staggered		the ridges shifted by 2 px every 4 rows, the overlaps change from row to row
+//
+//Exits with 1 when a comb gives fewer strips than a quarter of its ridges per row, then it doesn't test the worst
+//case any more.
+//
+//Build on Linux from this directory:
+//	g++ -std=c++11 -O2 -pthread -I../KinectGesturesImageProcessorLib stripBench.cpp ../KinectGesturesImageProcessorLib/*.cpp -o stripBench
+
+#include "derivativeFingerDetector.h"
+#include "detectorContext.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#define MAX_FINGERS 10
+#define TABLE_DEPTH 800
+#define RIDGE_HEIGHT 100			//millimetres, the edge of a 3 px ridge is 11 times that in the derivative
+#define RIDGE_WIDTH 3				//pixels
+#define RIDGE_PERIOD 6
+#define FINGER_WIDTH_MIN 2			//millimetres, a ridge is about 4 mm across at TABLE_DEPTH
+#define FINGER_WIDTH_MAX 30
+
+typedef enum
+{
+	CombContinuous,
+	CombBroken,
+	CombStaggered,
+	COMB_NUM
+} Comb;
+
+static const char* combNames[COMB_NUM] = { "continuous", "broken", "staggered" };
+static const char* linkingNames[2] = { "first", "best overlap" };
+
+static double now()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void combFrame(ushort* depth, int width, int height, Comb comb)
+{
+	for (int i = 0; i < height; i++)
+	{
+		bool ridges = i >= height / 12 && i < height * 11 / 12 && !(comb == CombBroken && i % 3 == 2);
+		int shift = comb == CombStaggered ? (i / 4) % 3 * 2 : 0;
+		for (int j = 0; j < width; j++)
+		{
+			bool ridge = ridges && (j + shift) % RIDGE_PERIOD < RIDGE_WIDTH;
+			depth[i * width + j] = (ushort)(ridge ? TABLE_DEPTH - RIDGE_HEIGHT : TABLE_DEPTH);
+		}
+	}
+}
+
+//mean milliseconds of a run, run -1 warms up
+typedef struct Timing
+{
+	double strips, fingers, frame;
+} Timing;
+
+int main(int argc, char** argv)
+{
+	int iterations = 100, threadNum = 1, width = 640, height = 480;
+	for (int a = 1; a < argc; a++)
+	{
+		if (strcmp(argv[a], "--iterations") == 0 && a + 1 < argc)
+		{
+			iterations = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "--threads") == 0 && a + 1 < argc)
+		{
+			threadNum = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "--width") == 0 && a + 1 < argc)
+		{
+			width = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "--height") == 0 && a + 1 < argc)
+		{
+			height = atoi(argv[++a]);
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--iterations n] [--threads n] [--width n] [--height n]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (iterations < 1 || threadNum < 1 || width < 2 * RIDGE_PERIOD || height < 12)
+	{
+		fprintf(stderr, "iterations and threads must be positive, the frame at least %dx12\n", 2 * RIDGE_PERIOD);
+		return 1;
+	}
+
+	int depthStride = width, pixelStride = width * 3;
+	std::vector<ushort> depth(width * height);
+	ushort* srcDepthPtr = &depth[0];
+	byte* dstPixelPtr = NULL;
+	int fingers[2 * MAX_FINGERS], handHint[4], fingerNum = 0;
+	bool ok = true;
+
+	for (int c = 0; c < COMB_NUM; c++)
+	{
+		combFrame(srcDepthPtr, width, height, (Comb)c);
+		for (int linking = StripLinkFirst; linking <= StripLinkBestOverlap; linking++)
+		{
+			void* detector = derivativeFingerDetectorCreate(width, height, depthStride, pixelStride, 10000, 1.12, 0.84, threadNum);
+			derivativeFingerDetectorSetLinking(detector, linking);
+			DetectorContext* ctx = (DetectorContext*)detector;
+			ctx->outputFlags = OutputNone;
+			ctx->rowStep = 1;
+			sobel(ctx, srcDepthPtr, dstPixelPtr, width, height, depthStride, pixelStride);
+
+			Timing t = { 0, 0, 0 };
+			for (int run = -1; run < iterations; run++)
+			{
+				double start = now();
+				findStrips(ctx, srcDepthPtr, dstPixelPtr, width, height, depthStride, pixelStride, FINGER_WIDTH_MIN, FINGER_WIDTH_MAX, 0, height, 0, width);
+				double middle = now();
+				fingerNum = findFingers(ctx, srcDepthPtr, dstPixelPtr, width, height, depthStride, pixelStride, 20, 150, MAX_FINGERS, fingers, handHint);
+				double end = now();
+				if (run >= 0)
+				{
+					t.strips += middle - start;
+					t.fingers += end - middle;
+				}
+			}
+
+			int stripSum = 0, stripRows = 0;
+			for (int i = 0; i < height; i++)
+			{
+				stripSum += ctx->stripNum[i];
+				stripRows += ctx->stripNum[i] > 0;
+			}
+			double stripsPerRow = stripRows > 0 ? (double)stripSum / stripRows : 0;
+
+			for (int run = -1; run < iterations; run++)
+			{
+				double start = now();
+				derivativeFingerDetectorContextWorkEx(detector, srcDepthPtr, NULL, FINGER_WIDTH_MIN, FINGER_WIDTH_MAX, 20, 150, MAX_FINGERS,
+													  fingers, handHint, OutputNone);
+				if (run >= 0)
+				{
+					t.frame += now() - start;
+				}
+			}
+			derivativeFingerDetectorDestroy(detector);
+
+			bool worst = stripsPerRow * 4 >= width / RIDGE_PERIOD;
+			ok = ok && worst;
+			printf("%4dx%-4d %-10s %-12s %6.1f strips/row %2d fingers  findStrips %8.4f ms  findFingers %8.4f ms  frame %8.4f ms%s\n",
+				   width, height, combNames[c], linkingNames[linking], stripsPerRow, fingerNum, t.strips * 1000 / iterations,
+				   t.fingers * 1000 / iterations, t.frame * 1000 / iterations, worst ? "" : "  TOO FEW STRIPS");
+		}
+	}
+
+	return ok ? 0 : 1;
+}